@@ -51,3 +51,58 @@ ece391_strncmp (const uint8_t* s1, const uint8_t* s2, uint32_t n)
     return ((int32_t)*s1) - ((int32_t)*s2);
 }
 
+
+/* Convert a number to its ASCII representation, with base "radix" */
+uint8_t*
+ece391_itoa (uint32_t value, uint8_t* buf, int32_t radix)
+{
+    static int8_t lookup[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    uint8_t* newbuf = buf;
+    uint32_t newval = value;
+
+    /* Special case for zero */
+    if (value == 0) {
+	buf[0] = '0';
+	buf[1] = '\0';
+	return buf;
+    }
+
+    /* Lowest place value first, reversed below */
+    while (newval > 0) {
+	*newbuf = lookup[newval % radix];
+	newbuf++;
+	newval /= radix;
+    }
+    *newbuf = '\0';
+
+    return ece391_strrev (buf);
+}
+
+/* In-place string reversal */
+uint8_t*
+ece391_strrev (uint8_t* s)
+{
+    uint8_t tmp;
+    int32_t beg = 0;
+    int32_t end = ece391_strlen (s) - 1;
+
+    while (beg < end) {
+	tmp = s[end];
+	s[end] = s[beg];
+	s[beg] = tmp;
+	beg++;
+	end--;
+    }
+
+    return s;
+}
+
+/* Writes label and then value in the given radix to stdout */
+void
+ece391_print_num (const char* label, uint32_t value, int32_t radix)
+{
+    uint8_t buf[33];
+
+    ece391_fdputs (1, (const uint8_t*)label);
+    ece391_fdputs (1, ece391_itoa (value, buf, radix));
+}
@@ -20,5 +20,22 @@ extern int32_t ece391_close (int32_t fd);
 extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 
+/*
+ * The calls fish uses to run as a real-time thread and time its
+ * frames, see syscalls/ece391syscall.h.
+ */
+typedef struct ece391_timespec {
+    uint32_t sec;
+    uint32_t nsec;
+} ece391_timespec_t;
+
+extern int32_t ece391_kstat (int32_t which, uint32_t* buf, int32_t n);
+extern int32_t ece391_gettime (int32_t clock, ece391_timespec_t* ts);
+extern int32_t ece391_sched_rt (uint32_t period_us, uint32_t budget_us);
+
+#define KSTAT_RT 9
+#define KSTAT_RT_WORDS 3
+#define CLOCK_MONOTONIC 0
+
 #endif /* ECE391SYSCALL_H */
 
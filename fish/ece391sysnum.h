@@ -11,5 +11,8 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_KSTAT 25
+#define SYS_GETTIME 27
+#define SYS_SCHED_RT 29
 
 #endif /* ECE391SYSNUM_H */
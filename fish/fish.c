@@ -5,6 +5,12 @@
 
 #define NULL 0
 #define WAIT 200
+#define BUFSIZE 32
+/* frames come at 32Hz, as a real-time thread fish reserves 4ms of each */
+#define FRAME_HZ 32
+#define FRAME_NS (1000000000 / FRAME_HZ)
+#define RT_PERIOD (1000000 / FRAME_HZ)
+#define RT_BUDGET 4000
 uint8_t *vmem_base_addr;
 uint8_t *mp1_set_video_mode (void);
 void add_frames(uint8_t *, uint8_t *, int32_t);
@@ -20,13 +26,31 @@ extern void mp1_rtc_tasklet(unsigned long trash);
 
 static struct mp1_blink_struct blink_array[80*25];
 
+/* frame timing: frames shown, frames that came more than half a period
+   late, and how far each frame's gap was off FRAME_NS */
+static uint32_t frames, late_frames, jitter_sum_us, jitter_max_ns;
+static ece391_timespec_t last_frame;
+
+static void frame(int32_t rtc_fd);
+static void report(int32_t rt);
+
 int main(void)
 {
-    int rtc_fd, ret_val, i, garbage;
+    int rtc_fd, ret_val, i, rt = 0;
     struct mp1_blink_struct blink_struct;
+    uint8_t args[BUFSIZE];
 
     ece391_memset(blink_array, 0, sizeof(struct mp1_blink_struct)*80*25);
 
+    /* "fish rt" animates as a real-time thread */
+    if(ece391_getargs(args, BUFSIZE) == 0 && ece391_strcmp(args, (uint8_t*)"rt") == 0) {
+        if(ece391_sched_rt(RT_PERIOD, RT_BUDGET) == -1) {
+            ece391_fdputs(1, (uint8_t*)"fish: real-time class refused\n");
+            return -1;
+        }
+        rt = 1;
+    }
+
     if(mp1_set_video_mode() == NULL) {
         return -1;
     }
@@ -39,8 +63,7 @@ int main(void)
     ret_val = ece391_write(rtc_fd, &ret_val, 4);
 
     for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        frame(rtc_fd);
     }
 
     blink_struct.on_char = 'I';
@@ -52,30 +75,73 @@ int main(void)
     mp1_ioctl((unsigned long)&blink_struct, RTC_ADD);
 
     for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        frame(rtc_fd);
     }
 
     mp1_ioctl((40 << 16 | (6*80+60)), RTC_SYNC);
 
     for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        frame(rtc_fd);
     }
 
     blink_struct.location = 60;
     mp1_ioctl(i, RTC_REMOVE);
 
     for(i=0; i<80*25; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        frame(rtc_fd);
     }
 
     ece391_close(rtc_fd);
+    report(rt);
 
     return 0;
 }
 
+/* waits for the next rtc tick, then animates one frame */
+static void
+frame(int32_t rtc_fd)
+{
+    int garbage;
+    ece391_timespec_t now;
+    uint32_t gap, off;
+
+    ece391_read(rtc_fd, &garbage, 4);
+    ece391_gettime(CLOCK_MONOTONIC, &now);
+    if(frames > 0) {
+        gap = (now.sec - last_frame.sec) * 1000000000 + now.nsec - last_frame.nsec;
+        off = gap > FRAME_NS ? gap - FRAME_NS : FRAME_NS - gap;
+        jitter_sum_us += off / 1000;
+        if(off > jitter_max_ns)
+            jitter_max_ns = off;
+        if(gap > FRAME_NS + FRAME_NS / 2)
+            late_frames++;
+    }
+    last_frame = now;
+    frames++;
+
+    mp1_rtc_tasklet(garbage);
+}
+
+/* prints the frame timing, and as a real-time thread the kernel's count
+   of deadline misses */
+static void
+report(int32_t rt)
+{
+    uint32_t stat[KSTAT_RT_WORDS];
+
+    ece391_print_num("frames: ", frames, 10);
+    ece391_print_num("  late: ", late_frames, 10);
+    ece391_print_num("  jitter avg: ", jitter_sum_us / (frames - 1), 10);
+    ece391_print_num("us  max: ", jitter_max_ns / 1000, 10);
+    ece391_fdputs(1, (uint8_t*)"us\n");
+    if(rt && ece391_kstat(KSTAT_RT, stat, KSTAT_RT_WORDS) == KSTAT_RT_WORDS) {
+        ece391_print_num("rt jobs: ", stat[0], 10);
+        ece391_print_num("  deadline misses: ", stat[1], 10);
+        ece391_print_num("  cpu reserved: ", stat[2] / 10000, 10);
+        ece391_fdputs(1, (uint8_t*)"%\n");
+    }
+}
+
 void
 add_frames(uint8_t *f0, uint8_t *f1, int32_t rtc_fd)
 {
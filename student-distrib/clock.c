@@ -0,0 +1,240 @@
+//time keeping: the tsc counts, calibrated once against the PIT, and the
+//cmos clock gives the wall time once at boot
+#include "clock.h"
+#include "rtc.h"
+#include "schedule.h"
+
+uint32_t tsc_khz;
+uint32_t boot_epoch;
+
+//tsc at boot, the monotonic clock counts from there
+static uint64_t tsc_base;
+//ns = cycles * clock_mult >> clock_shift
+static uint32_t clock_mult;
+static int32_t clock_shift;
+//realtime minus monotonic
+static uint64_t wall_offset;
+
+static uint64_t calibrate_run(void);
+static uint8_t cmos_read(uint8_t reg);
+static uint8_t bcd(uint8_t value, uint8_t reg_b);
+static uint32_t read_cmos_clock(void);
+static uint32_t days_since_epoch(int32_t y, int32_t m, int32_t d);
+
+/* clock_init
+ *
+ * DESCRIPTION: measures the tsc against PIT channel 2, starts the monotonic
+ *              clock and reads the wall clock. Called with interrupts off.
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: uses the PC speaker gate with the speaker off
+ */
+void clock_init(void){
+    uint64_t best = 0, run, n = 0;
+    int32_t i;
+
+    //the shortest run had the fewest interruptions by the host
+    for(i = 0; i < CAL_RUNS; i++){
+        run = calibrate_run();
+        if(i == 0 || run < best)
+            best = run;
+    }
+    div64_32(&best, CAL_MS);
+    tsc_khz = best;
+
+    //largest shift whose multiplier still fits in 32 bits
+    for(clock_shift = 32; clock_shift > 0; clock_shift--){
+        n = (uint64_t)NS_PER_MS << clock_shift;
+        div64_32(&n, tsc_khz);
+        if((n >> 32) == 0)
+            break;
+    }
+    clock_mult = n;
+
+    tsc_base = rdtsc64();
+    boot_epoch = read_cmos_clock();
+    wall_offset = (uint64_t)boot_epoch * NS_PER_SEC - clock_ns();
+
+    printf("tsc = %d kHz\n", tsc_khz);
+}
+
+/* calibrate_run
+ *
+ * DESCRIPTION: lets PIT channel 2 count down CAL_MS once
+ * INPUT/OUTPUT: returns the tsc cycles it took
+ * SIDE EFFECTS: none
+ */
+static uint64_t calibrate_run(void){
+    uint32_t latch = PIT_HZ / 1000 * CAL_MS;
+    uint64_t begin;
+
+    //gate on, speaker off
+    outb((inb(PIT_GATE_PORT) & ~PIT_SPEAKER) | PIT_GATE_CH2, PIT_GATE_PORT);
+
+    //mode 0 starts counting once the high byte is in and raises OUT at 0
+    outb(PIT_CH2_ONESHOT, MODE_COMMAND_REG);
+    outb(latch & MASK_FREQ, PIT_CH2_DATA);
+    outb(latch >> 8, PIT_CH2_DATA);
+
+    begin = rdtsc64();
+    while(!(inb(PIT_GATE_PORT) & PIT_CH2_OUT));
+    return rdtsc64() - begin;
+}
+
+/* clock_ns
+ *
+ * DESCRIPTION: monotonic clock
+ * INPUT/OUTPUT: returns ns since clock_init
+ * SIDE EFFECTS: none
+ */
+uint64_t clock_ns(void){
+    return cycles_to_ns(rdtsc64() - tsc_base);
+}
+
+/* cycles_to_ns
+ *
+ * DESCRIPTION: converts tsc cycles without a 64 bit division, the 96 bit
+ *              product is summed in two halves
+ * INPUT/OUTPUT: uint64_t cycles
+ *               returns ns
+ * SIDE EFFECTS: none
+ */
+uint64_t cycles_to_ns(uint64_t cycles){
+    uint64_t lo = (uint64_t)(uint32_t)cycles * clock_mult;
+    uint64_t hi = (uint64_t)(uint32_t)(cycles >> 32) * clock_mult;
+
+    return (lo >> clock_shift) + (hi << (32 - clock_shift));
+}
+
+/* clock_gettime
+ *
+ * DESCRIPTION: reads CLOCK_MONOTONIC, time since boot, or CLOCK_REALTIME,
+ *              seconds since 1970 UTC
+ * INPUT/OUTPUT: int32_t clock
+ *               timespec_t* ts - filled in
+ *               returns 0, -1 on an unknown clock
+ * SIDE EFFECTS: none
+ */
+int32_t clock_gettime(int32_t clock, timespec_t* ts){
+    uint64_t ns;
+
+    if(clock != CLOCK_MONOTONIC && clock != CLOCK_REALTIME)
+        return -1;
+
+    ns = clock_ns();
+    if(clock == CLOCK_REALTIME)
+        ns += wall_offset;
+    ts->nsec = div64_32(&ns, NS_PER_SEC);
+    ts->sec = ns;
+    return 0;
+}
+
+/* div64_32
+ *
+ * DESCRIPTION: 64 by 32 bit division with two divl, the kernel isn't linked
+ *              against libgcc's 64 bit helpers
+ * INPUT/OUTPUT: uint64_t* n - dividend, replaced by the quotient
+ *               uint32_t d - divisor
+ *               returns the remainder
+ * SIDE EFFECTS: none
+ */
+uint32_t div64_32(uint64_t* n, uint32_t d){
+    uint32_t hi = *n >> 32;
+    uint32_t lo = *n;
+    uint32_t q_hi = hi / d;
+    uint32_t rem = hi % d;
+    uint32_t q_lo;
+
+    asm("divl %4" : "=a"(q_lo), "=d"(rem) : "a"(lo), "d"(rem), "rm"(d));
+    *n = ((uint64_t)q_hi << 32) | q_lo;
+    return rem;
+}
+
+/* cmos_read
+ *
+ * DESCRIPTION: reads one cmos register
+ * INPUT/OUTPUT: uint8_t reg
+ *               returns its value
+ * SIDE EFFECTS: none
+ */
+static uint8_t cmos_read(uint8_t reg){
+    outb(CMOS_NMI_OFF | reg, RTC_PORT);
+    return inb(RW_CMOS);
+}
+
+/* bcd
+ *
+ * DESCRIPTION: cmos fields are bcd unless register B says binary
+ * INPUT/OUTPUT: uint8_t value, uint8_t reg_b
+ *               returns value in binary
+ * SIDE EFFECTS: none
+ */
+static uint8_t bcd(uint8_t value, uint8_t reg_b){
+    if(reg_b & CMOS_BINARY)
+        return value;
+    return (value >> 4) * 10 + (value & 0x0F);
+}
+
+/* read_cmos_clock
+ *
+ * DESCRIPTION: reads the cmos date and time, twice in a row until both
+ *              agree so an update in between can't tear it. The cmos is
+ *              taken to keep UTC and a year from 2000 up to 2069 or else
+ *              before 2000.
+ * INPUT/OUTPUT: returns seconds since 1970
+ * SIDE EFFECTS: none
+ */
+static uint32_t read_cmos_clock(void){
+    uint8_t now[6], last[6];
+    uint8_t reg_b, hour;
+    int32_t i, same, year;
+
+    for(i = 0; i < 6; i++)
+        now[i] = 0xFF;
+    do{
+        for(i = 0; i < 6; i++)
+            last[i] = now[i];
+        while(cmos_read(CMOS_REG_A) & CMOS_UPDATING);
+        now[0] = cmos_read(CMOS_SEC);
+        now[1] = cmos_read(CMOS_MIN);
+        now[2] = cmos_read(CMOS_HOUR);
+        now[3] = cmos_read(CMOS_DAY);
+        now[4] = cmos_read(CMOS_MONTH);
+        now[5] = cmos_read(CMOS_YEAR);
+        for(same = 1, i = 0; i < 6; i++)
+            if(now[i] != last[i])
+                same = 0;
+    }while(!same);
+
+    reg_b = cmos_read(CMOS_REG_B);
+    hour = bcd(now[2] & ~CMOS_PM, reg_b);
+    if(!(reg_b & CMOS_24H)){
+        hour %= 12;
+        if(now[2] & CMOS_PM)
+            hour += 12;
+    }
+    year = bcd(now[5], reg_b);
+    year += (year < 70) ? 2000 : 1900;
+
+    return days_since_epoch(year, bcd(now[4], reg_b), bcd(now[3], reg_b)) * SEC_PER_DAY
+        + hour * 3600 + bcd(now[1], reg_b) * 60 + bcd(now[0], reg_b);
+}
+
+/* days_since_epoch
+ *
+ * DESCRIPTION: days from 1970-01-01 to a date, counted in 400 year eras
+ *              that start on March 1st so leap days come last
+ * INPUT/OUTPUT: year, month 1-12, day 1-31
+ *               returns days
+ * SIDE EFFECTS: none
+ */
+static uint32_t days_since_epoch(int32_t y, int32_t m, int32_t d){
+    int32_t era, yoe, doy, doe;
+
+    if(m <= 2)
+        y--;
+    era = y / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
@@ -0,0 +1,66 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "types.h"
+#include "lib.h"
+
+//PIT channel 2, counted down once per calibration run
+#define PIT_HZ 1193182
+#define PIT_CH2_DATA 0x42
+#define PIT_CH2_ONESHOT 0xB0
+#define PIT_GATE_PORT 0x61
+#define PIT_GATE_CH2 0x01
+#define PIT_SPEAKER 0x02
+#define PIT_CH2_OUT 0x20
+#define CAL_MS 50
+#define CAL_RUNS 3
+
+//cmos clock registers, the NMI stays off while one is selected
+#define CMOS_NMI_OFF 0x80
+#define CMOS_SEC 0x00
+#define CMOS_MIN 0x02
+#define CMOS_HOUR 0x04
+#define CMOS_DAY 0x07
+#define CMOS_MONTH 0x08
+#define CMOS_YEAR 0x09
+#define CMOS_REG_A 0x0A
+#define CMOS_REG_B 0x0B
+#define CMOS_UPDATING 0x80
+#define CMOS_BINARY 0x04
+#define CMOS_24H 0x02
+#define CMOS_PM 0x80
+
+#define NS_PER_SEC 1000000000
+#define NS_PER_MS 1000000
+#define SEC_PER_DAY 86400
+
+//clocks gettime reads
+#define CLOCK_MONOTONIC 0
+#define CLOCK_REALTIME 1
+
+typedef struct timespec{
+    uint32_t sec;
+    uint32_t nsec;
+}timespec_t;
+
+//tsc ticks per millisecond, measured at boot
+extern uint32_t tsc_khz;
+//wall clock seconds the cmos gave at boot
+extern uint32_t boot_epoch;
+
+/* rdtsc64
+ * DESCRIPTION: whole 64 bit time stamp counter
+ */
+static inline uint64_t rdtsc64(void){
+    uint64_t t;
+    asm volatile("rdtsc" : "=A"(t));
+    return t;
+}
+
+void clock_init(void);
+uint64_t clock_ns(void);
+uint64_t cycles_to_ns(uint64_t cycles);
+int32_t clock_gettime(int32_t clock, timespec_t* ts);
+uint32_t div64_32(uint64_t* n, uint32_t d);
+
+#endif
@@ -427,27 +427,31 @@ int32_t f_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes){
     }
     //read
     else if(cmd == READ){
-        uint32_t inode = curr_pcb->file_arr[fd].inode;
-        uint32_t offset = curr_pcb->file_arr[fd].position;
+        uint32_t inode = curr_pcb->fd_table[fd].inode;
+        uint32_t offset = curr_pcb->fd_table[fd].position;
         int32_t bytes_read = fread(inode,offset,(int8_t*)buf,nbytes);
         if(bytes_read != -1)
-          curr_pcb->file_arr[fd].position += bytes_read;
+          curr_pcb->fd_table[fd].position += bytes_read;
         return bytes_read;
     }
     //write
     else if(cmd == WRITE){
         //need to find access pcb
-        uint32_t inode = curr_pcb->file_arr[fd].inode;
-        uint32_t offset = curr_pcb->file_arr[fd].position;
+        uint32_t inode = curr_pcb->fd_table[fd].inode;
+        uint32_t offset = curr_pcb->fd_table[fd].position;
         int32_t bytes_written = fread(inode,offset,(int8_t*)buf,nbytes);
         if(bytes_written != -1)
-          curr_pcb->file_arr[fd].position += bytes_written;
+          curr_pcb->fd_table[fd].position += bytes_written;
         return bytes_written;
     }
     //close
     else if(cmd == CLOSE){
         return fclose();
     }
+    //files never block
+    else if(cmd == POLL){
+        return POLLIN;
+    }
     return -1;
 }
 
@@ -465,8 +469,8 @@ int32_t d_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes){
         return dopen();
     }
     else if(cmd == READ){
-        uint32_t idx = curr_pcb->file_arr[fd].position;
-        curr_pcb->file_arr[fd].position++;
+        uint32_t idx = curr_pcb->fd_table[fd].position;
+        curr_pcb->fd_table[fd].position++;
         return dread_idx(idx,(int8_t*)buf);
     }
     else if(cmd == WRITE){
@@ -475,5 +479,8 @@ int32_t d_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes){
     else if(cmd == CLOSE){
         return dclose();
     }
+    else if(cmd == POLL){
+        return POLLIN;
+    }
     return -1;
 }
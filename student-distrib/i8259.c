@@ -10,6 +10,8 @@
 uint8_t master_mask; /* IRQs 0-7 */
 uint8_t slave_mask; /* IRQs 8-15 */
 
+uint32_t irq_count[NUM_IRQS];
+
 /* i8259_init
  *
  * DESCRIPTION: Initializes Master and Slave PICs with four ICWs. Then mask
@@ -98,13 +100,16 @@ disable_irq(uint32_t irq_num)
  *
  * DESCRIPTION: Sends EOI signal to Master and/or Slave PIC
  * INPUT/OUTPUT: irq_num -- number of IRQ pin that's interrupt has finished
- * SIDE EFFECTS: Computer can now receive new interrupt from PIC
+ * SIDE EFFECTS: Computer can now receive new interrupt from PIC, counts the
+ *               interrupt in irq_count
  */
 void
 send_eoi(uint32_t irq_num)
 {
     uint8_t PIC_EOI;
 
+    irq_count[irq_num]++;
+
     // handle irq less than 8 - master
     if(irq_num < 8)
     {
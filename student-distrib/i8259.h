@@ -32,6 +32,11 @@
  * to declare the interrupt finished */
 #define EOI             0x60
 
+#define NUM_IRQS 16
+
+/* Interrupts handled since boot, per IRQ line */
+extern uint32_t irq_count[NUM_IRQS];
+
 /* Externally-visible functions */
 
 /* Initialize both PICs */
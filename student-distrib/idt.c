@@ -1,27 +1,31 @@
 #include "idt.h"
+#include "signal.h"
+#include "trace.h"
+
+static void exception_signal(hw_context_t* ctx, int32_t signum, int8_t* msg);
 
 //static array of all system handlers
 static uint32_t sys_handlers[NUM_SYS_HANDLERS] = {
-    (uint32_t)divide_handler,
-    (uint32_t)debug_handler,
-    (uint32_t)nmi_interrupt_handler,
-    (uint32_t)breakpoint_handler,
-    (uint32_t)overflow_handler,
-    (uint32_t)bound_range_handler,
-    (uint32_t)invalid_opcode_handler,
-    (uint32_t)device_not_avail_handler,
-    (uint32_t)dbl_fault_handler,
-    (uint32_t)coprocess_seg_handler,
-    (uint32_t)inval_tss_handler,
-    (uint32_t)seg_not_pres_handler,
-    (uint32_t)stack_fault_handler,
-    (uint32_t)gen_protect_handler,
-    (uint32_t)page_fault_handler,
+    (uint32_t)divide_wrapper,
+    (uint32_t)debug_wrapper,
+    (uint32_t)nmi_interrupt_wrapper,
+    (uint32_t)breakpoint_wrapper,
+    (uint32_t)overflow_wrapper,
+    (uint32_t)bound_range_wrapper,
+    (uint32_t)invalid_opcode_wrapper,
+    (uint32_t)device_not_avail_wrapper,
+    (uint32_t)dbl_fault_wrapper,
+    (uint32_t)coprocess_seg_wrapper,
+    (uint32_t)inval_tss_wrapper,
+    (uint32_t)seg_not_pres_wrapper,
+    (uint32_t)stack_fault_wrapper,
+    (uint32_t)gen_protect_wrapper,
+    (uint32_t)page_fault_wrapper,
     (uint32_t)exception_handler,//general exception here
-    (uint32_t)float_point_handler,
-    (uint32_t)align_check_handler,
-    (uint32_t)machine_check_handler,
-    (uint32_t)simd_float_point_handler
+    (uint32_t)float_point_wrapper,
+    (uint32_t)align_check_wrapper,
+    (uint32_t)machine_check_wrapper,
+    (uint32_t)simd_float_point_wrapper
 };
 
 
@@ -61,6 +65,11 @@ void init_idt(){
     if(i == SYS_CALL)
       idt[i].dpl = RING3;
 
+    //device interrupts come in through interrupt gates with interrupts
+    //off, only their softirqs run with them on
+    if(i == KEYBOARD || i == RTC || i == PIT)
+      idt[i].reserved3 = 0;
+
     //assign correct handler
     if(i < NUM_SYS_HANDLERS && i != RESERVED)
         SET_IDT_ENTRY(idt[i],sys_handlers[i]);
@@ -83,6 +92,27 @@ void init_idt(){
 
 
 
+/* exception_signal
+ *
+ * DESCRIPTION: Common part of the exception handlers. A fault in user code
+ *              becomes signum, delivered when the exception returns. Without
+ *              a handler, or when the handler itself faults, the task is
+ *              killed after printing msg, as is a task whose system call
+ *              faulted in the kernel.
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
+ *               int32_t signum - DIV_ZERO or SEGFAULT
+ *               int8_t* msg - what the exception is
+ * SIDE EFFECTS: may not return
+ */
+static void exception_signal(hw_context_t* ctx, int32_t signum, int8_t* msg){
+    if((ctx->cs & RING3) != RING3 || curr_pcb->sig_masked || curr_pcb->leader->sig_handler[signum] == NULL){
+        printf(msg);
+        kill_current();
+    }
+
+    signal_send(curr_pcb, signum);
+}
+
 /* exception_handler
  *
  * DESCRIPTION: General exception handler
@@ -98,217 +128,199 @@ void exception_handler(){
  *
  * DESCRIPTION: Handler for Divide Error Exception (#DE)
                 Called upon a divide by 0 or result would overflow
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void divide_handler(){
-    clear();
-    printf("Interrupt 0 - Divide Error Exception\n");
-    while(1);
+void divide_handler(hw_context_t* ctx){
+    exception_signal(ctx, DIV_ZERO, "Interrupt 0 - Divide Error Exception\n");
 }
 
 /* debug_handler
  *
  * DESCRIPTION: A debug exception has been caught
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void debug_handler(){
-    printf("Interrupt 1 - Debug Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void debug_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 1 - Debug Exception\n");
 }
 
 /* nmi_interrupt_handler
  *
  * DESCRIPTION: A non maskeable interrupt has been generated
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void nmi_interrupt_handler(){
-    printf("Interrupt 2 - Nonmaskable Interrupt\n");
-    system_handler(SYS_HALT,256,0,0);
+void nmi_interrupt_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 2 - Nonmaskable Interrupt\n");
 }
 
 /* breakpoint_handler
  *
  * DESCRIPTION: Breakpoint instruction was executed
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void breakpoint_handler(){
-    printf("Interrupt 3 - Breakpoint Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void breakpoint_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 3 - Breakpoint Exception\n");
 }
 
 /* overflow_handler
  *
  * DESCRIPTION: Overflow occured wtih arithmetic
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void overflow_handler(){
-    printf("Interrupt 4 - Overflow Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void overflow_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 4 - Overflow Exception\n");
 }
 
 /* bound_range_handler
  *
  * DESCRIPTION: Attempted to access index out of bounds
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void bound_range_handler(){
-    printf("Interrupt 5 - BOUND Range Exceeded\n");
-    system_handler(SYS_HALT,256,0,0);
+void bound_range_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 5 - BOUND Range Exceeded\n");
 }
 
 /* invalid_opcode_handler
  *
  * DESCRIPTION: Processor attempted to execute an invalid
                 instruction
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void invalid_opcode_handler(){
-    printf("Interrupt 6 - Invalid Opcode\n");
-    system_handler(SYS_HALT,256,0,0);
+void invalid_opcode_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 6 - Invalid Opcode\n");
 }
 
 /* device_not_avail_handler
  *
  * DESCRIPTION: Processor executed instructions hardware
                 unable to finish
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void device_not_avail_handler(){
-    printf("Interrupt 7 - Device Not Available\n");
-    system_handler(SYS_HALT,256,0,0);
+void device_not_avail_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 7 - Device Not Available\n");
 }
 
 /* dbl_fault_handler
  *
  * DESCRIPTION: Second exception generated while first exception
                 being handled
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void dbl_fault_handler(){
-    printf("Interrupt 8 - Double Fault\n");
-    system_handler(SYS_HALT,256,0,0);
+void dbl_fault_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 8 - Double Fault\n");
 }
 
 /* coprocess_seg_handler
  *
  * DESCRIPTION: Detected a page or segment violation
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void coprocess_seg_handler(){
-    printf("Interrupt 9 - Coprocessor Segment Overrun\n");
-    system_handler(SYS_HALT,256,0,0);
+void coprocess_seg_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 9 - Coprocessor Segment Overrun\n");
 }
 
 /* inval_tss_handler
  *
  * DESCRIPTION: Error occured with TSS
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void inval_tss_handler(){
-    printf("Interrupt 10 - Invalid TSS\n");
-    system_handler(SYS_HALT,256,0,0);
+void inval_tss_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 10 - Invalid TSS\n");
 }
 
 /* set_not_pres_handler
  *
  * DESCRIPTION: Attempts to access an invalid segment
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void seg_not_pres_handler(){
-    printf("Interrupt 11 - Segment Not Present\n");
-    system_handler(SYS_HALT,256,0,0);
+void seg_not_pres_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 11 - Segment Not Present\n");
 }
 
 /* stack_fault_handler
  *
  * DESCRIPTION: Limit violation regarded with the stack or
                 not present stack segment
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void stack_fault_handler(){
-    printf("Interrupt 12 - Stack Fault Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void stack_fault_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 12 - Stack Fault Exception\n");
 }
 
 /* gen_protect_handler
  *
  * DESCRIPTION: One of many general protection violations
                 RTDC
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void gen_protect_handler(){
-    printf("Interrupt 13 - General Protection Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void gen_protect_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 13 - General Protection Exception\n");
 }
 
 /*  page_fault_handler
  *
  * DESCRIPTION: Processor detected error regarding pages
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void page_fault_handler(){
-    //clear();
-    printf("Interrupt 14 - Page-Fault Exception\n");
-    //while(1);
-    system_handler(SYS_HALT,256,0,0);
+void page_fault_handler(hw_context_t* ctx){
+    uint32_t cr2;
+
+    asm volatile("movl %%cr2, %0" : "=r"(cr2));
+    TRACE_EVENT(TR_PAGE_FAULT, cr2, ctx->eip, ctx->err_code, 0);
+    exception_signal(ctx, SEGFAULT, "Interrupt 14 - Page-Fault Exception\n");
 }
 
 /* float_point_handler
  *
  * DESCRIPTION: Floating point error occured
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void float_point_handler(){
-    printf("Interrupt 16 - x87 FPU Floating-Point Error\n");
-    system_handler(SYS_HALT,256,0,0);
+void float_point_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 16 - x87 FPU Floating-Point Error\n");
 }
 
 /* align_check_handler
  *
  * DESCRIPTION: Detected unaligned memory when supposed to
                 be aligned
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void align_check_handler(){
-    printf("Interrupt 17 - Alignment Check Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void align_check_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 17 - Alignment Check Exception\n");
 }
 
 /* machine_check_handler
  *
  * DESCRIPTION: Internal machine error or bus error
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void machine_check_handler(){
-    printf("Interrupt 18 - Machine-Check Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void machine_check_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 18 - Machine-Check Exception\n");
 }
 
 /* simd_float_point_handler
  *
  * DESCRIPTION: SIMD floating point exception
- * INPUT/OUTPUT: none
+ * INPUT/OUTPUT: hw_context_t* ctx - registers at the fault
  * SIDE EFFECTS: none
  */
-void simd_float_point_handler(){
-    printf("Interrupt 19 - SIMD Floating-Point Exception\n");
-    system_handler(SYS_HALT,256,0,0);
+void simd_float_point_handler(hw_context_t* ctx){
+    exception_signal(ctx, SEGFAULT, "Interrupt 19 - SIMD Floating-Point Exception\n");
 }
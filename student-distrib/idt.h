@@ -25,48 +25,50 @@
 #define READY 1
 #define NOT 0
 
+struct hw_context;
+
 extern void init_idt();
 
 
 
 void exception_handler();
 
-void divide_handler();
+void divide_handler(struct hw_context* ctx);
 
-void debug_handler();
+void debug_handler(struct hw_context* ctx);
 
-void nmi_interrupt_handler();
+void nmi_interrupt_handler(struct hw_context* ctx);
 
-void breakpoint_handler();
+void breakpoint_handler(struct hw_context* ctx);
 
-void overflow_handler();
+void overflow_handler(struct hw_context* ctx);
 
-void bound_range_handler();
+void bound_range_handler(struct hw_context* ctx);
 
-void invalid_opcode_handler();
+void invalid_opcode_handler(struct hw_context* ctx);
 
-void device_not_avail_handler();
+void device_not_avail_handler(struct hw_context* ctx);
 
-void dbl_fault_handler();
+void dbl_fault_handler(struct hw_context* ctx);
 
-void coprocess_seg_handler();
+void coprocess_seg_handler(struct hw_context* ctx);
 
-void inval_tss_handler();
+void inval_tss_handler(struct hw_context* ctx);
 
-void seg_not_pres_handler();
+void seg_not_pres_handler(struct hw_context* ctx);
 
-void stack_fault_handler();
+void stack_fault_handler(struct hw_context* ctx);
 
-void gen_protect_handler();
+void gen_protect_handler(struct hw_context* ctx);
 
-void page_fault_handler();
+void page_fault_handler(struct hw_context* ctx);
 
-void float_point_handler();
+void float_point_handler(struct hw_context* ctx);
 
-void align_check_handler();
+void align_check_handler(struct hw_context* ctx);
 
-void machine_check_handler();
+void machine_check_handler(struct hw_context* ctx);
 
-void simd_float_point_handler();
+void simd_float_point_handler(struct hw_context* ctx);
 
 #endif
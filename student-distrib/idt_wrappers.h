@@ -1,6 +1,8 @@
 #ifndef IDT_WRAP
 #define IDT_WRAP
 
+#include "types.h"
+
 extern void keyboard_handler_wrapper();
 
 extern void rtc_handler_wrapper();
@@ -8,4 +10,29 @@ extern void rtc_handler_wrapper();
 extern void system_handler_wrapper();
 
 extern void pit_handler_wrapper();
+
+//exception entries, each calls the matching handler in idt.c
+extern void divide_wrapper();
+extern void debug_wrapper();
+extern void nmi_interrupt_wrapper();
+extern void breakpoint_wrapper();
+extern void overflow_wrapper();
+extern void bound_range_wrapper();
+extern void invalid_opcode_wrapper();
+extern void device_not_avail_wrapper();
+extern void dbl_fault_wrapper();
+extern void coprocess_seg_wrapper();
+extern void inval_tss_wrapper();
+extern void seg_not_pres_wrapper();
+extern void stack_fault_wrapper();
+extern void gen_protect_wrapper();
+extern void page_fault_wrapper();
+extern void float_point_wrapper();
+extern void align_check_wrapper();
+extern void machine_check_wrapper();
+extern void simd_float_point_wrapper();
+
+extern void context_switch(uint32_t* save_esp, uint32_t new_esp);
+
+extern void task_start();
 #endif
@@ -0,0 +1,137 @@
+//synchronous call/reply ipc, messages are the two words in ecx and edx
+#include "ipc.h"
+
+static void deliver(process_control_block_t* from, process_control_block_t* to);
+
+/* ipc_call
+ *
+ * DESCRIPTION: sends the caller's ecx/edx to task dest and sleeps until it
+ *              replies. If dest is already waiting the message is written
+ *              straight into its registers and the cpu is handed to it.
+ * INPUT/OUTPUT: int32_t dest - slot of the server, as returned by spawn or
+ *                              thread_create
+ *               returns 0 with the reply in ecx/edx, -1 if dest is bad or
+ *               halts before replying
+ * SIDE EFFECTS: blocks
+ */
+int32_t ipc_call(int32_t dest){
+    uint32_t flags;
+    int32_t ret;
+    process_control_block_t* server;
+
+    if(dest < 0 || dest >= KTHREAD_SLOT || dest == curr_pcb->slot)
+        return -1;
+
+    cli_and_save(flags);
+    if(tasks->task[dest].in_use != ON){
+        restore_flags(flags);
+        return -1;
+    }
+    server = &tasks->task[dest].proc;
+    curr_pcb->ipc_peer = dest;
+
+    if(server->ipc_state == IPC_RECV){
+        deliver(curr_pcb,server);
+        server->ipc_state = IPC_NONE;
+        server->ipc_peer = curr_pcb->slot;
+        curr_pcb->ipc_state = IPC_CALL;
+        task_handoff(server);
+    }
+    else{
+        //server is busy, it finds us when it next waits
+        curr_pcb->ipc_state = IPC_SEND;
+    }
+
+    while(curr_pcb->ipc_state != IPC_NONE)
+        task_block();
+
+    ret = (curr_pcb->ipc_peer == IPC_DEAD) ? -1 : 0;
+    restore_flags(flags);
+    return ret;
+}
+
+/* ipc_reply_wait
+ *
+ * DESCRIPTION: replies with the caller's ecx/edx to client, then waits for
+ *              the next call. Blocking hands the cpu straight to the client
+ *              that was just answered.
+ * INPUT/OUTPUT: int32_t client - task to answer, -1 to only wait
+ *               returns the slot of the next caller with its message in
+ *               ecx/edx
+ * SIDE EFFECTS: blocks, a reply to a task that is no longer calling us is
+ *               dropped
+ */
+int32_t ipc_reply_wait(int32_t client){
+    uint32_t flags;
+    int32_t i;
+    process_control_block_t* answered = NULL;
+    process_control_block_t* sender;
+
+    cli_and_save(flags);
+
+    if(client >= 0 && client < MAX_TASKS && tasks->task[client].in_use == ON){
+        sender = &tasks->task[client].proc;
+        if(sender->ipc_state == IPC_CALL && sender->ipc_peer == curr_pcb->slot){
+            deliver(curr_pcb,sender);
+            sender->ipc_state = IPC_NONE;
+            answered = sender;
+        }
+    }
+
+    //take a caller that queued up while we were busy
+    for(i = 0; i < MAX_TASKS; i++){
+        sender = &tasks->task[i].proc;
+        if(tasks->task[i].in_use == ON && sender->ipc_state == IPC_SEND
+            && sender->ipc_peer == curr_pcb->slot){
+            deliver(sender,curr_pcb);
+            sender->ipc_state = IPC_CALL;
+            if(answered != NULL)
+                task_wake(answered);
+            restore_flags(flags);
+            return i;
+        }
+    }
+
+    curr_pcb->ipc_state = IPC_RECV;
+    if(answered != NULL)
+        task_handoff(answered);
+    while(curr_pcb->ipc_state == IPC_RECV)
+        task_block();
+
+    restore_flags(flags);
+    return curr_pcb->ipc_peer;
+}
+
+/* ipc_abort
+ *
+ * DESCRIPTION: a task is going away, everyone calling it gets -1
+ * INPUT/OUTPUT: process_control_block_t* pcb - halting task
+ * SIDE EFFECTS: wakes callers
+ */
+void ipc_abort(process_control_block_t* pcb){
+    int32_t i;
+    process_control_block_t* caller;
+
+    pcb->ipc_state = IPC_NONE;
+    for(i = 0; i < MAX_TASKS; i++){
+        caller = &tasks->task[i].proc;
+        if(tasks->task[i].in_use == ON && caller->ipc_peer == pcb->slot
+            && (caller->ipc_state == IPC_SEND || caller->ipc_state == IPC_CALL)){
+            caller->ipc_state = IPC_NONE;
+            caller->ipc_peer = IPC_DEAD;
+            task_wake(caller);
+        }
+    }
+}
+
+/* deliver
+ *
+ * DESCRIPTION: copies the message registers of one task blocked in a system
+ *              call into the saved registers of another
+ * INPUT/OUTPUT: process_control_block_t* from, process_control_block_t* to
+ * SIDE EFFECTS: to sees the words in ecx/edx when its system call returns
+ */
+static void deliver(process_control_block_t* from, process_control_block_t* to){
+    USER_FRAME(to)->ecx = USER_FRAME(from)->ecx;
+    USER_FRAME(to)->edx = USER_FRAME(from)->edx;
+}
@@ -0,0 +1,20 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include "types.h"
+#include "lib.h"
+#include "sys_handlers.h"
+
+#define IPC_NONE 0
+#define IPC_SEND 1
+#define IPC_CALL 2
+#define IPC_RECV 3
+#define IPC_DEAD -1
+
+struct pcb;
+
+int32_t ipc_call(int32_t dest);
+int32_t ipc_reply_wait(int32_t client);
+void ipc_abort(struct pcb* pcb);
+
+#endif
@@ -0,0 +1,101 @@
+//interrupts off tracer. cli, cli_and_save, sti and restore_flags in lib.h,
+//the IRQ entries and the returns to user space report every change of the
+//interrupt flag here, and the longest sections are kept with the sites that
+//opened and closed them. Nothing in here may use those macros.
+#include "irqtrace.h"
+#include "lib.h"
+
+irqsoff_t irqsoff_top[IRQSOFF_TOP];
+
+//set once the kernel first turns interrupts on, boot runs with them off
+static int32_t irqsoff_on;
+//an interrupts off section is being timed
+static int32_t irqsoff_open;
+static uint32_t irqsoff_stamp;
+static uint32_t irqsoff_eip;
+
+static void irqsoff_record(uint32_t cycles, uint32_t on_eip);
+
+/* irqsoff_init
+ *
+ * DESCRIPTION: starts tracing, called right after the kernel first enables
+ *              interrupts
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void irqsoff_init(void){
+    int32_t i;
+
+    for(i = 0; i < IRQSOFF_TOP; i++){
+        irqsoff_top[i].cycles = 0;
+        irqsoff_top[i].off_eip = 0;
+        irqsoff_top[i].on_eip = 0;
+    }
+    irqsoff_open = 0;
+    irqsoff_on = 1;
+}
+
+/* trace_irqs_off
+ *
+ * DESCRIPTION: called right after interrupts went off, opens a section at
+ *              the caller unless one is open already
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void trace_irqs_off(void){
+    if(!irqsoff_on || irqsoff_open)
+        return;
+    asm volatile("rdtsc" : "=a"(irqsoff_stamp) : : "edx");
+    irqsoff_eip = (uint32_t)__builtin_return_address(0);
+    irqsoff_open = 1;
+}
+
+/* trace_irqs_on
+ *
+ * DESCRIPTION: called right before interrupts go back on, closes the open
+ *              section at the caller
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void trace_irqs_on(void){
+    uint32_t end;
+
+    if(!irqsoff_open)
+        return;
+    asm volatile("rdtsc" : "=a"(end) : : "edx");
+    irqsoff_open = 0;
+    irqsoff_record(end - irqsoff_stamp, (uint32_t)__builtin_return_address(0));
+}
+
+/* irqsoff_record
+ *
+ * DESCRIPTION: keeps a section if it is among the IRQSOFF_TOP longest. A
+ *              pair of sites already in the table only keeps its longest.
+ * INPUT/OUTPUT: uint32_t cycles - length of the section
+ *               uint32_t on_eip - site that closed it
+ * SIDE EFFECTS: none
+ */
+static void irqsoff_record(uint32_t cycles, uint32_t on_eip){
+    irqsoff_t tmp;
+    int32_t i;
+
+    if(cycles <= irqsoff_top[IRQSOFF_TOP - 1].cycles)
+        return;
+
+    for(i = 0; i < IRQSOFF_TOP - 1; i++){
+        if(irqsoff_top[i].off_eip == irqsoff_eip && irqsoff_top[i].on_eip == on_eip)
+            break;
+    }
+    if(cycles <= irqsoff_top[i].cycles)
+        return;
+    irqsoff_top[i].cycles = cycles;
+    irqsoff_top[i].off_eip = irqsoff_eip;
+    irqsoff_top[i].on_eip = on_eip;
+
+    //move it up to its place
+    for(; i > 0 && irqsoff_top[i].cycles > irqsoff_top[i - 1].cycles; i--){
+        tmp = irqsoff_top[i];
+        irqsoff_top[i] = irqsoff_top[i - 1];
+        irqsoff_top[i - 1] = tmp;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef IRQTRACE_H
+#define IRQTRACE_H
+
+//0 compiles the interrupts off tracer out of cli, sti and the flags macros
+#define IRQSOFF_TRACE 1
+
+//longest interrupts off sections kept, one per pair of sites
+#define IRQSOFF_TOP 8
+//words kstat copies out per section: cycles, eip of the cli and of the sti
+#define IRQSOFF_WORDS 3
+
+#ifndef ASM
+
+#include "types.h"
+
+typedef struct irqsoff{
+    uint32_t cycles;
+    uint32_t off_eip;
+    uint32_t on_eip;
+}irqsoff_t;
+
+//longest first, read with kstat
+extern irqsoff_t irqsoff_top[IRQSOFF_TOP];
+
+void irqsoff_init(void);
+void trace_irqs_off(void);
+void trace_irqs_on(void);
+
+#endif /* ASM */
+
+#endif
@@ -12,11 +12,63 @@
 #include "fs.h"
 #include "sys_handlers.h"
 #include "sys_handler_helper.h"
+#include "pipe.h"
+#include "shm.h"
+#include "kmem.h"
+#include "clock.h"
+#include "timer.h"
+#include "softirq.h"
+#include "worker.h"
+#include "serial.h"
 
 /* Macros. */
 /* Check if the bit BIT in FLAGS is set. */
 #define CHECK_FLAG(flags,bit)   ((flags) & (1 << (bit)))
 
+/* Reads the number of terminals from "consoles=N" on the GRUB kernel line,
+   anything missing or out of range gives DEFAULT_TERMINALS. */
+static int32_t
+boot_terminals (const int8_t* cmdline)
+{
+	int32_t n = 0;
+
+	while (*cmdline != '\0' && strncmp (cmdline, "consoles=", 9) != 0)
+		cmdline++;
+	if (*cmdline == '\0')
+		return DEFAULT_TERMINALS;
+
+	for (cmdline += 9; *cmdline >= '0' && *cmdline <= '9'; cmdline++)
+		n = n * 10 + (*cmdline - '0');
+	if (n < 1 || n > MAX_TERMINALS)
+		return DEFAULT_TERMINALS;
+	return n;
+}
+
+/* "nohz=off" on the GRUB kernel line keeps the PIT at a fixed 100Hz tick,
+   for comparing against the one-shot PIT. */
+static int32_t
+boot_nohz (const int8_t* cmdline)
+{
+	while (*cmdline != '\0' && strncmp (cmdline, "nohz=", 5) != 0)
+		cmdline++;
+	if (*cmdline == '\0')
+		return 1;
+	return strncmp (cmdline + 5, "off", 3) != 0;
+}
+
+/* "softirq=off" on the GRUB kernel line runs bottom halves and worker jobs
+   inside the hard interrupt with interrupts off, for comparing the
+   interrupts off windows. */
+static int32_t
+boot_softirq (const int8_t* cmdline)
+{
+	while (*cmdline != '\0' && strncmp (cmdline, "softirq=", 8) != 0)
+		cmdline++;
+	if (*cmdline == '\0')
+		return 1;
+	return strncmp (cmdline + 8, "off", 3) != 0;
+}
+
 /* Check if MAGIC is valid and print the Multiboot information structure
    pointed by ADDR. */
 void
@@ -50,8 +102,16 @@ entry (unsigned long magic, unsigned long addr)
 		printf ("boot_device = 0x%#x\n", (unsigned) mbi->boot_device);
 
 	/* Is the command line passed? */
-	if (CHECK_FLAG (mbi->flags, 2))
+	num_terminals = DEFAULT_TERMINALS;
+	if (CHECK_FLAG (mbi->flags, 2)) {
 		printf ("cmdline = %s\n", (char *) mbi->cmdline);
+		num_terminals = boot_terminals ((int8_t *) mbi->cmdline);
+		nohz = boot_nohz ((int8_t *) mbi->cmdline);
+		softirq_on = boot_softirq ((int8_t *) mbi->cmdline);
+	}
+	printf ("terminals = %d\n", num_terminals);
+	printf ("nohz = %d\n", nohz);
+	printf ("softirq = %d\n", softirq_on);
 
 	if (CHECK_FLAG (mbi->flags, 3)) {
 		int mod_count = 0;
@@ -160,24 +220,51 @@ entry (unsigned long magic, unsigned long addr)
  	/* Init the PIC */
 	i8259_init();
 
+	/* No bottom halves yet, the drivers register theirs */
+	softirq_init();
+
 	/* Initialize RTC and Keyboard */
 	keyboard_init();
 
 	rtc_init();
 
+	/* COM1, profiles and traces are written out there */
+	serial_init();
+
 	/* Initialize paging */
 	paging_init();
 
 	/* Initialize PIT */
-	//pit_init();
+	pit_init();
+
+	/* Calibrate the TSC and read the wall clock */
+	clock_init();
+
+	/* Start the kernel timer wheel */
+	timer_init();
+
+	/* Initialize pipes */
+	pipe_init();
+
+	/* Initialize shared memory */
+	shm_init();
+
+	/* Initialize the kernel heap, terminals take their buffers from it */
+	kmem_init();
 
 	init_kernel_memory();
+
+	/* Start the worker thread, it needs the task slots */
+	worker_init();
 	/* Enable interrupts */
 	/* Do not enable the following until after you have set up your
 	 * IDT correctly otherwise QEMU will triple fault and simple close
 	 * without showing you any output */
 	printf("Enabling Interrupts\n");
 	sti();
+
+	/* Time every interrupts off section from here on */
+	irqsoff_init();
 //  print_all_files();
 //	read_file_by_name("shell");
 //	read_file_by_index();
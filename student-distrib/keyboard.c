@@ -3,9 +3,12 @@
 #include "keyboard.h"
 #include "lib.h"
 #include "sys_handler_helper.h"
+#include "kmem.h"
+#include "signal.h"
+#include "softirq.h"
 
 
-static uint8_t keyboard_input_make_array[47] = {
+static uint8_t keyboard_input_make_array[NUM_KEYS] = {
 
     0x1E, 0x30, 0x2E, 0x20, 0x12, 0x21,     // A,B,C,D,E,F
     0x22, 0x23, 0x17, 0x24, 0x25, 0x26,     // G,H,I,J,K,L
@@ -18,7 +21,7 @@ static uint8_t keyboard_input_make_array[47] = {
 };
 
 //ascii values for the lower case numbers and symbols
-static uint8_t ascii_val[47] = {
+static uint8_t ascii_val[NUM_KEYS] = {
 
     'a', 'b', 'c', 'd', 'e', 'f',
     'g', 'h', 'i', 'j', 'k', 'l',
@@ -32,7 +35,7 @@ static uint8_t ascii_val[47] = {
 };
 
 //ascii values for the upper case numbers and symbols
-static uint8_t ascii_val_upper[47] = {
+static uint8_t ascii_val_upper[NUM_KEYS] = {
 
     'A', 'B', 'C', 'D', 'E', 'F',
     'G', 'H', 'I', 'J', 'K', 'L',
@@ -45,7 +48,7 @@ static uint8_t ascii_val_upper[47] = {
 };
 
 //ascii value table for shift pressed symbols and upper case letters
-static uint8_t ascii_val_shift[47] = {
+static uint8_t ascii_val_shift[NUM_KEYS] = {
 
     'A', 'B', 'C', 'D', 'E', 'F',
     'G', 'H', 'I', 'J', 'K', 'L',
@@ -58,7 +61,7 @@ static uint8_t ascii_val_shift[47] = {
 
 };
 
-static uint8_t ascii_val_caps_shift[47] = {
+static uint8_t ascii_val_caps_shift[NUM_KEYS] = {
 
     'a', 'b', 'c', 'd', 'e', 'f',
     'g', 'h', 'i', 'j', 'k', 'l',
@@ -70,9 +73,6 @@ static uint8_t ascii_val_caps_shift[47] = {
     ':', '"', '<', '>', '?'
 
 };
-//keyboard buffer
-volatile uint8_t line_char_buffer[BUFFER_SIZE];
-
 //flags for important keys
 uint32_t capslock_flag;
 uint32_t shift_flag;
@@ -82,24 +82,100 @@ uint32_t enter_flag;
 uint32_t back_flag;
 uint32_t first_flag;
 
-//keeps track of the last active keyboard buffer index
-int buffIdx;
+//input of a terminal, made the first time the terminal is used. Keys only
+//ever go to the terminal on screen, so a background terminal's line being
+//typed just waits in edit.
+typedef struct line_state{
+    //lines entered and not read yet, each ends in a newline. cbreak mode
+    //queues single chars here instead
+    uint8_t queue[INPUT_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    //lines, chars or events queued, readers sleep on it
+    int32_t ready;
+    //line being typed
+    uint8_t edit[BUFFER_SIZE];
+    int32_t edit_len;
+    //KBD_COOKED, KBD_CBREAK or KBD_RAW, and the process that set it
+    int32_t mode;
+    struct pcb* mode_owner;
+    //raw mode presses and releases
+    key_event_t events[EVENT_QUEUE_SIZE];
+    //lines, chars or events ever queued and the irq stamps of the latest
+    uint32_t units;
+    uint32_t stamps[EVENT_QUEUE_SIZE];
+}line_state_t;
+
+static line_state_t* lines[MAX_TERMINALS];
+
+//lines lost to a full queue
+uint32_t input_dropped;
+
+//scan codes from the handler, waiting for the bottom half
+static volatile uint8_t scan_ring[SCAN_RING_SIZE];
+static volatile uint32_t scan_stamp_lo[SCAN_RING_SIZE];
+static volatile uint32_t scan_stamp_hi[SCAN_RING_SIZE];
+static volatile uint32_t scan_head;
+static volatile uint32_t scan_tail;
+uint32_t scan_dropped;
+
+//cycles the latest handlers and bottom halves took, read with kstat
+uint32_t kbd_irq_cycles[KBD_SAMPLES];
+uint32_t kbd_irq_count;
+uint32_t kbd_bh_cycles[KBD_SAMPLES];
+uint32_t kbd_bh_count;
+
+//cycles from the keyboard irq to the read that took the key
+uint32_t kbd_read_cycles[KBD_SAMPLES];
+uint32_t kbd_read_count;
+
+//irq stamp of the key the bottom half is on
+static uint32_t key_stamp_lo;
+static uint32_t key_stamp_hi;
+
+//set by an 0xE0 prefix for the next raw event
+static uint8_t key_extended;
+
+//ascii value of every make code, indexed by KEYMAP_SHIFT | KEYMAP_CAPS
+static uint8_t keymap[KEYMAP_STATES][KEYMAP_SIZE];
+
+static void latch_line(line_state_t* line);
+static int32_t fkey_number(uint8_t keyboard_read);
+static void keyboard_bottom_half(void);
+static int32_t keyboard_key(uint8_t keyboard_read);
+static int32_t raw_key(line_state_t* line, uint8_t keyboard_read);
+static uint8_t key_ascii(uint8_t code);
+static int32_t cbreak_char(uint8_t c);
+static void unit_queued(line_state_t* line);
+static void unit_read(line_state_t* line);
+static void flush_input(line_state_t* line);
 
 
 
 /* keyboard_init
  *
- * DESCRIPTION: Enables keyboard IRQ on PIC
+ * DESCRIPTION: Enables keyboard IRQ on PIC, spreads the ascii tables out
+ *              into keymap
  * INPUT/OUTPUT: none
  * SIDE EFFECTS: none
  */
 void keyboard_init(void)
 {
+    int32_t i;
+
+    for(i = 0; i < NUM_KEYS; i++){
+      keymap[0][keyboard_input_make_array[i]] = ascii_val[i];
+      keymap[KEYMAP_CAPS][keyboard_input_make_array[i]] = ascii_val_upper[i];
+      keymap[KEYMAP_SHIFT][keyboard_input_make_array[i]] = ascii_val_shift[i];
+      keymap[KEYMAP_SHIFT | KEYMAP_CAPS][keyboard_input_make_array[i]] = ascii_val_caps_shift[i];
+    }
+
+    open_softirq(KEYBOARD_SOFTIRQ, keyboard_bottom_half);
+
     // enable the IRQ on PIC associated with keyboard
     enable_irq(KEYBOARD_IRQ_NUM);
 
-    //initialize the flags and the buffIdx
-    buffIdx = -1;
+    //initialize the flags
     capslock_flag = 0;
     shift_flag = 0;
     ctrl_flag = 0;
@@ -112,31 +188,102 @@ void keyboard_init(void)
 /* keyboard_handler
  *
  * DESCRIPTION: Handler called by IDT in response to a keyboard interrupt.
- *              Reads in make code of key from port, loops through an array to
- *              find the corresponding index for the appropriate Ascii value, and
- *              then puts the ascii value to screen.
+ *              Only queues the scan code on scan_ring and counts its own
+ *              cycles, the keys are handled by keyboard_bottom_half in the
+ *              keyboard softirq with interrupts back on.
  * INPUT/OUTPUT: none
  * SIDE EFFECTS: Sends EOI to PIC(S)
  */
 void keyboard_handler()
 {
-    /*
-        1) create the mapping mechanism
-        2) call end of interrupt signal
-    */
+    uint32_t begin, begin_hi, end;
+    uint8_t keyboard_read;
+
+    asm volatile("rdtsc" : "=a"(begin), "=d"(begin_hi));
 
-    //wrap in critical section
-    uint32_t f;
-    cli_and_save(f);
+    // take in the port value holding the make code for letter
+    keyboard_read = inb(KEYBOARD_BUFFER_PORT);
+
+    //the handler is the only producer, a full ring drops the key
+    if (scan_head - scan_tail < SCAN_RING_SIZE) {
+      scan_ring[scan_head % SCAN_RING_SIZE] = keyboard_read;
+      scan_stamp_lo[scan_head % SCAN_RING_SIZE] = begin;
+      scan_stamp_hi[scan_head % SCAN_RING_SIZE] = begin_hi;
+      asm volatile("" : : : "memory");
+      scan_head++;
+    }
+    else
+      scan_dropped++;
 
     //end of interrupt signal
     send_eoi(KEYBOARD_IRQ_NUM);
+    raise_softirq(KEYBOARD_SOFTIRQ);
+
+    asm volatile("rdtsc" : "=a"(end) : : "edx");
+    kbd_irq_cycles[kbd_irq_count % KBD_SAMPLES] = end - begin;
+    kbd_irq_count++;
+}
+
+/* keyboard_bottom_half
+ *
+ * DESCRIPTION: The keyboard softirq, handles every scan code on scan_ring
+ *              with interrupts on. Softirqs run with preemption off, so the
+ *              echo can't be moved to another task's console halfway
+ *              through. An Alt+Fn is handed to the worker thread.
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+static void keyboard_bottom_half(void)
+{
+    uint32_t begin, end;
     uint8_t keyboard_read;
+    int32_t prev_console, i;
+    int32_t term = -1;
+
+    asm volatile("rdtsc" : "=a"(begin) : : "edx");
+
+    //echo goes to the terminal on screen, not the interrupted task's
+    prev_console = console_route(curr_terminal);
+
+    //the handler only writes scan_head, only this loop writes scan_tail
+    while (scan_tail != scan_head) {
+      keyboard_read = scan_ring[scan_tail % SCAN_RING_SIZE];
+      key_stamp_lo = scan_stamp_lo[scan_tail % SCAN_RING_SIZE];
+      key_stamp_hi = scan_stamp_hi[scan_tail % SCAN_RING_SIZE];
+      scan_tail++;
+      if ((i = keyboard_key(keyboard_read)) != -1)
+        term = i;
+    }
 
+    console_route(prev_console);
 
-    // take in the port value holding the make code for letter
-    keyboard_read = inb(KEYBOARD_BUFFER_PORT);
+    //switching terminals is too long for a softirq
+    if (term != -1)
+      switch_terminal_later(term);
+
+    asm volatile("rdtsc" : "=a"(end) : : "edx");
+    kbd_bh_cycles[kbd_bh_count % KBD_SAMPLES] = end - begin;
+    kbd_bh_count++;
+}
 
+/* keyboard_key
+ *
+ * DESCRIPTION: acts on one scan code
+ * INPUT/OUTPUT: keyboard_read - scan code
+ *               returns the terminal an Alt+Fn asked for, -1 for other keys
+ * SIDE EFFECTS: echoes to the console output is routed to
+ */
+static int32_t keyboard_key(uint8_t keyboard_read)
+{
+    line_state_t* line = lines[curr_terminal];
+
+    if (line->mode == KBD_RAW)
+      return raw_key(line, keyboard_read);
+
+    //any other key press leaves the scrollback view
+    if (!(keyboard_read & KEY_BREAK) && (keyboard_read != PGUP_PRESS) && (keyboard_read != PGDN_PRESS)
+        && (keyboard_read != LSHIFT_PRESS) && (keyboard_read != RSHIFT_PRESS))
+      scrollback_end();
 
     //choose what to do with the scan code imported from the keyboard port
     if (keyboard_read == SPACE_PRESS)
@@ -151,17 +298,14 @@ void keyboard_handler()
       AltStatus(keyboard_read);
     else if ((keyboard_read == L_CLEAR) && (ctrl_flag == 1))
       clearScreen();
-    else if ((keyboard_read == F2_PRESS) && (alt_flag == 1) && (ctrl_flag == 0) && (shift_flag == 0)){
-        restore_flags(f);
-        switch_terminal(SHELL1);
-    }
-    else if ((keyboard_read == F1_PRESS) && (alt_flag == 1) && (ctrl_flag == 0) && (shift_flag == 0)){
-        restore_flags(f);
-        switch_terminal(SHELL0);
-    }
-    else if ((keyboard_read == F3_PRESS) && (alt_flag == 1) && (ctrl_flag == 0) && (shift_flag == 0)){
-        restore_flags(f);
-        switch_terminal(SHELL2);
+    else if ((keyboard_read == C_INTR) && (ctrl_flag == 1))
+      signal_interrupt(curr_terminal);
+    else if ((keyboard_read == PGUP_PRESS) && (shift_flag == 1))
+      scrollback(SCROLLBACK_PAGE);
+    else if ((keyboard_read == PGDN_PRESS) && (shift_flag == 1))
+      scrollback(-SCROLLBACK_PAGE);
+    else if ((fkey_number(keyboard_read) != -1) && (alt_flag == 1) && (ctrl_flag == 0) && (shift_flag == 0)){
+      return fkey_number(keyboard_read);
     }
     else if ((keyboard_read == LSHIFT_PRESS) || (keyboard_read == LSHIFT_RELEASE) || (keyboard_read == RSHIFT_PRESS) || (keyboard_read == RSHIFT_RELEASE))
       LRshift(keyboard_read);
@@ -172,8 +316,109 @@ void keyboard_handler()
     else
       keyboardBuff(keyboard_read);
 
-    restore_flags(f);
-    return;
+    return -1;
+}
+
+/* raw_key
+ * inputs: input of the terminal on screen, scan code
+ * outputs: the terminal an Alt+Fn asked for, -1 for other keys
+ * side effects: wakes readers and pollers of the terminal
+ * function: raw mode hands every press and release to the reader as a
+ *           key_event_t, nothing is echoed. Modifiers are still followed so
+ *           Alt+Fn keeps switching terminals.
+ */
+static int32_t raw_key(line_state_t* line, uint8_t keyboard_read){
+  key_event_t* ev;
+  uint8_t code = keyboard_read & ~KEY_BREAK;
+
+  if (keyboard_read == KEY_EXTENDED) {
+    key_extended = KEY_MOD_EXTENDED;
+    return -1;
+  }
+
+  if (code == CTRL_PRESS)
+    CtrlStatus(keyboard_read);
+  else if (code == ALT_PRESS)
+    AltStatus(keyboard_read);
+  else if ((code == LSHIFT_PRESS) || (code == RSHIFT_PRESS))
+    LRshift(keyboard_read);
+  else if (keyboard_read == CAPS)
+    caps_on();
+  else if ((fkey_number(keyboard_read) != -1) && (alt_flag == 1) && (ctrl_flag == 0) && (shift_flag == 0))
+    return fkey_number(keyboard_read);
+
+  if (line->ready == EVENT_QUEUE_SIZE) {
+    input_dropped++;
+    key_extended = 0;
+    return -1;
+  }
+
+  ev = &line->events[line->units % EVENT_QUEUE_SIZE];
+  ev->tsc_lo = key_stamp_lo;
+  ev->tsc_hi = key_stamp_hi;
+  ev->scancode = code;
+  ev->pressed = !(keyboard_read & KEY_BREAK);
+  ev->ascii = key_extended ? 0 : key_ascii(code);
+  ev->mods = key_extended | (shift_flag ? KEY_MOD_SHIFT : 0) | (ctrl_flag ? KEY_MOD_CTRL : 0)
+    | (alt_flag ? KEY_MOD_ALT : 0) | (capslock_flag ? KEY_MOD_CAPS : 0);
+  key_extended = 0;
+
+  unit_queued(line);
+  return -1;
+}
+
+/* key_ascii
+ * inputs: make code
+ * outputs: the char the key types with the current shift and caps lock, 0
+ *          for keys that type none
+ * side effects: none
+ * function: lookup for raw events
+ */
+static uint8_t key_ascii(uint8_t code){
+  if (code == SPACE_PRESS)
+    return ' ';
+  if (code == ENTER_PRESS)
+    return '\n';
+  if (code == BKSP)
+    return '\b';
+  return keymap[(shift_flag ? KEYMAP_SHIFT : 0) | (capslock_flag ? KEYMAP_CAPS : 0)][code];
+}
+
+/* cbreak_char
+ * inputs: char a key typed
+ * outputs: 1 if the terminal on screen is in cbreak mode and took the char,
+ *          else 0
+ * side effects: wakes readers and pollers of the terminal
+ * function: cbreak mode queues every char for the reader as it is typed,
+ *           nothing is echoed or edited
+ */
+static int32_t cbreak_char(uint8_t c){
+  line_state_t* line = lines[curr_terminal];
+
+  if (line->mode != KBD_CBREAK)
+    return 0;
+
+  if (line->head - line->tail == INPUT_QUEUE_SIZE) {
+    input_dropped++;
+    return 1;
+  }
+  line->queue[line->head++ % INPUT_QUEUE_SIZE] = c;
+  unit_queued(line);
+  return 1;
+}
+
+/* fkey_number
+ * inputs: keyboard scan code
+ * outputs: 0 for F1 up to 11 for F12, -1 for any other key
+ * side effects: none
+ * function: Alt+Fn switches to terminal n-1
+ */
+static int32_t fkey_number(uint8_t keyboard_read){
+  if (keyboard_read >= F1_PRESS && keyboard_read <= F10_PRESS)
+    return keyboard_read - F1_PRESS;
+  if (keyboard_read == F11_PRESS || keyboard_read == F12_PRESS)
+    return keyboard_read - F11_PRESS + 10;
+  return -1;
 }
 
 /* void keyboardBuff
@@ -184,51 +429,20 @@ void keyboard_handler()
               and also output it onto the terminal screen
 */
 void keyboardBuff(uint8_t keyboard_read) {
+  uint8_t c;
+  line_state_t* line = lines[curr_terminal];
 
   //return if buffer overflow
-  if(buffIdx == BUFFER_MAX_INDEX)
+  if(line->edit_len == BUFFER_MAX_INDEX + 1 || (keyboard_read & KEY_BREAK))
     return;
 
-  int i;
-
-  //add char to the buffer based on the scancode
-  for(i = 0; i < 47; i++)
-  {
-    if(keyboard_read == keyboard_input_make_array[i])
-      {
-        //if (line_char_buffer[buffIdx] != ' ') {
-            //increment buffer index if adding character
-            buffIdx++;
-          //check caps lock to choose correct ascii table to draw from
-          if((capslock_flag == 1) && (shift_flag == 1)) {
-            line_char_buffer[buffIdx] = ascii_val_caps_shift[i];
-            putc(line_char_buffer[buffIdx]);
-            break;
-          }
-          else if(capslock_flag == 1) {
-            line_char_buffer[buffIdx] = ascii_val_upper[i];
-            putc(line_char_buffer[buffIdx]);
-            break;
-          }
-          //check for shift to choose correct ascii table to draw from
-          else if (shift_flag == 1) {
-            line_char_buffer[buffIdx] = ascii_val_shift[i];
-            putc(line_char_buffer[buffIdx]);
-            break;
-          }
-          else {
-            //if neither shift or caps lock is selected, choose appropraite ascii table
-            line_char_buffer[buffIdx] = ascii_val[i];
-            putc(line_char_buffer[buffIdx]);
-            break;
-          }
-      //  }
-
-      }
-  }
-
-  return;
+  //caps lock and shift pick the table
+  c = keymap[(shift_flag ? KEYMAP_SHIFT : 0) | (capslock_flag ? KEYMAP_CAPS : 0)][keyboard_read];
+  if(c == 0 || cbreak_char(c))
+    return;
 
+  line->edit[line->edit_len++] = c;
+  putc(c);
 }
 
 /* void space_press
@@ -238,16 +452,19 @@ void keyboardBuff(uint8_t keyboard_read) {
  * function: handler for when the space bar is clicked
  */
 void space_press(){
+    line_state_t* line = lines[curr_terminal];
+
+    if(cbreak_char(' '))
+      return;
 
     //check for buffer overflow and handle apporpriately
-    if(buffIdx == BUFFER_MAX_INDEX  ){
+    if(line->edit_len == BUFFER_MAX_INDEX + 1){
       return;
     }
-    buffIdx++;
 
     //print and add space to buffer and screen
     putc(' ');
-    line_char_buffer[buffIdx] = ' ';
+    line->edit[line->edit_len++] = ' ';
     return;
 }
 
@@ -260,27 +477,70 @@ void space_press(){
 void enter_press(){
   enter_flag = 1;
 
-  int32_t i;
-  buffIdx = -1;
-  if (line_char_buffer[0] == '\0') {
-      for(i = 0; i < BUFFER_SIZE; i++){
-          line_char_buffer[i] = '\0';
-      }
-      buffIdx++;
-      line_char_buffer[buffIdx] = '\n';
-      //print newline
+  if(cbreak_char('\n'))
+    return;
 
-        putc('\n');
+  //hand the line to a reader before the buffer is reused
+  latch_line(lines[curr_terminal]);
 
-      return;
-  }
-  else {
-    for(i = 0; i < BUFFER_SIZE; i++){
-        line_char_buffer[i] = '\0';
-    }
-    putc('\n');
+  clear_buffer();
+  putc('\n');
+}
+
+/* void latch_line
+ * inputs: input of the terminal on screen
+ * outputs: none
+ * side effects: wakes readers and pollers of that terminal
+ * function: queues the typed line plus a newline behind the lines not read
+ *           yet, a line that doesn't fit is dropped
+ */
+static void latch_line(line_state_t* line){
+  int32_t i;
+
+  if (INPUT_QUEUE_SIZE - (line->head - line->tail) < line->edit_len + 1) {
+    input_dropped++;
     return;
   }
+
+  for (i = 0; i < line->edit_len; i++)
+    line->queue[line->head++ % INPUT_QUEUE_SIZE] = line->edit[i];
+  line->queue[line->head++ % INPUT_QUEUE_SIZE] = '\n';
+  unit_queued(line);
+}
+
+/* void unit_queued
+ * inputs: input of the terminal on screen
+ * outputs: none
+ * side effects: wakes readers and pollers of that terminal
+ * function: counts a line, char or event just queued and keeps the irq
+ *           stamp of the key that finished it
+ */
+static void unit_queued(line_state_t* line){
+  line->stamps[line->units % EVENT_QUEUE_SIZE] = key_stamp_lo;
+  line->units++;
+  line->ready++;
+
+  wake_up((uint32_t)&line->ready);
+  poll_wake();
+}
+
+/* void unit_read
+ * inputs: input of the reader's terminal
+ * outputs: none
+ * side effects: none
+ * function: counts the oldest line, char or event as read and samples how
+ *           long ago its key came in, unless EVENT_QUEUE_SIZE newer ones
+ *           wrote over its stamp
+ */
+static void unit_read(line_state_t* line){
+  uint32_t now;
+
+  if (line->ready <= EVENT_QUEUE_SIZE) {
+    asm volatile("rdtsc" : "=a"(now) : : "edx");
+    kbd_read_cycles[kbd_read_count % KBD_SAMPLES] = now - line->stamps[(line->units - line->ready) % EVENT_QUEUE_SIZE];
+    kbd_read_count++;
+  }
+  line->ready--;
 }
 
 /* void enter_release
@@ -300,11 +560,15 @@ void enter_release(){
  * function: handler for when the backspace is clicked
  */
 void bksp_handler() {
+  line_state_t* line = lines[curr_terminal];
+
+  if(cbreak_char('\b'))
+    return;
+
   //check to see that buffer is not empty
-  if(buffIdx == -1)
+  if(line->edit_len == 0)
     return;
-  line_char_buffer[buffIdx] = '\0';
-  buffIdx--;
+  line->edit[--line->edit_len] = '\0';
   //this function deletes last drawn char
   backspace();
   return;
@@ -381,32 +645,30 @@ void clearScreen() {
   //set cursor to top left
   resetCursor();
 
-  clear_buffer();
-
   //pass empty
-  line_char_buffer[0] = '\n';
-  buffIdx = QUIT;
+  clear_buffer();
+  latch_line(lines[curr_terminal]);
   return;
 }
 
 /* void get_buf_idx
  * inputs: none
- * outputs: buffIdx
+ * outputs: index of the last char typed on the terminal on screen, -1 if none
  * side effects: none
- * function: getter function to get buffIdx
+ * function: getter function to get the buffer index
  */
 int get_buf_idx(){
-    return buffIdx;
+    return lines[curr_terminal]->edit_len - 1;
 }
 
 /* void set_buf_idx
  * inputs: int32_t index
  * outputs: none
- * side effects: changes buffIdx
+ * side effects: changes the buffer index of the terminal on screen
  * function: used to change buffer index
  */
 void set_buf_idx(int32_t index){
-  buffIdx = index;
+  lines[curr_terminal]->edit_len = index + 1;
 }
 
 /* keyboard_open
@@ -440,58 +702,76 @@ int32_t keyboard_write(){
 }
 
 /* keyboard_read
- * input: the buffer to write to, bytes to write
- * output: the total number of bytes written
- * side effects: writes to a buffer whatever is in the keyboard buffer
- * function: takes the keyboard buffer and copies whatever is in it to a different
- *            buffer passed in by the function
- */
-int32_t keyboard_read(char* buf, uint32_t byte_count){
-    //dont let inside if buffer is empty
-    while(buffIdx == -1);
-    int i;
-    //loop until user presses enter
-  //  if(buffIdx != -2){
-        do{
-            for(i=0;i<byte_count;i++){
-                buf[i] = line_char_buffer[i];
-            }
-            if (buffIdx == QUIT)
-              enter_flag = 1;
-        }while(enter_flag == 0);
-  //  }
-
-
-    //empty buffer is being passed
-    if (line_char_buffer[0] == '\n') {
-      buf[0] = '\0';
-      line_char_buffer[0] = '\0';
-      buffIdx = -1;
-      enter_flag = 0;
-      return 0;//i+1
+ * input: fd, the buffer to write to, bytes to write
+ * output: the total number of bytes written, -1 if the fd is O_NONBLOCK and
+ *         no line is waiting or a signal came first
+ * side effects: sleeps until input is queued on the reader's terminal
+ * function: hands the oldest queued line, newline included, to the reader.
+ *           An empty line reads as 0 bytes, what doesn't fit in buf is
+ *           dropped with the rest of the line. In cbreak mode it hands over
+ *           the chars typed so far, in raw mode as many whole key_event_t
+ *           as fit.
+ */
+int32_t keyboard_read(uint32_t fd, int8_t* buf, uint32_t byte_count){
+    uint32_t flags;
+    line_state_t* line = lines[curr_pcb->term];
+    uint32_t n = 0;
+    uint8_t c;
+
+    if (line->mode == KBD_RAW && byte_count < sizeof(key_event_t))
+      return -1;
+
+    cli_and_save(flags);
+    while (!line->ready) {
+      if ((curr_pcb->fd_table[fd].mode & O_NONBLOCK) || signal_pending(curr_pcb)) {
+        restore_flags(flags);
+        return -1;
+      }
+      sleep_on((uint32_t)&line->ready);
     }
 
-    // if the command is "exit", do not add new line character at the end of the string
-    if (strncmp(buf,"exit",4) == 0) {
-      first_flag = 1;
-      return i + 1;
+    if (line->mode == KBD_RAW) {
+      while (line->ready && n + sizeof(key_event_t) <= byte_count) {
+        memcpy(buf + n, &line->events[(line->units - line->ready) % EVENT_QUEUE_SIZE], sizeof(key_event_t));
+        n += sizeof(key_event_t);
+        unit_read(line);
+      }
+      restore_flags(flags);
+      return n;
     }
 
-
-    int j;
-    j = 0;
-
-    // loop through to find null terminating character
-    while (buf[j] != '\0') {
-      j++;
+    if (line->mode == KBD_CBREAK) {
+      while (line->ready && n < byte_count) {
+        buf[n++] = line->queue[line->tail++ % INPUT_QUEUE_SIZE];
+        unit_read(line);
+      }
+      restore_flags(flags);
+      return n;
     }
 
-    // fill null terminating space in buffer with nl char
-     buf[j] = '\n';
-
+    while ((c = line->queue[line->tail++ % INPUT_QUEUE_SIZE]) != '\n') {
+      if (n < byte_count)
+        buf[n++] = c;
+    }
+    if (n > 0 && n < byte_count)
+      buf[n++] = '\n';
+    //callers treat the buffer as a string
+    if (n < byte_count)
+      buf[n] = '\0';
+    unit_read(line);
+
+    restore_flags(flags);
+    return n;
+}
 
-    // return # of bytes
-    return j+1;//i+2
+/* keyboard_poll
+ * input: none
+ * output: POLLIN if a line is waiting on the caller's terminal, else 0
+ * side effects: none
+ * function: readiness for poll
+ */
+int32_t keyboard_poll(){
+    return lines[curr_pcb->term]->ready ? POLLIN : 0;
 }
 
 /* keyboard_driver
@@ -508,7 +788,7 @@ int32_t keyboard_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t byte_coun
         return keyboard_open();
     }
     else if(cmd == READ){
-        return keyboard_read((int8_t*)buf,byte_count);
+        return keyboard_read(fd,(int8_t*)buf,byte_count);
     }
     else if(cmd == WRITE){
         return keyboard_write();
@@ -516,13 +796,85 @@ int32_t keyboard_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t byte_coun
     else if(cmd == CLOSE){
         return keyboard_close();
     }
+    else if(cmd == POLL){
+        return keyboard_poll();
+    }
+    else if(cmd == IOCTL){
+        return keyboard_ioctl(byte_count,(uint32_t)buf);
+    }
     return -1;
 }
 
+/* keyboard_ioctl
+ * input: request - KBD_SETMODE or KBD_GETMODE
+ *        arg - KBD_COOKED, KBD_CBREAK or KBD_RAW for KBD_SETMODE
+ * output: the mode for KBD_GETMODE, 0 for KBD_SETMODE, -1 on a bad request
+ * side effects: KBD_SETMODE drops the input queued so far
+ * function: sets how the caller's terminal hands input to readers. The
+ *           mode goes back to KBD_COOKED when the process that set it halts.
+ */
+int32_t keyboard_ioctl(uint32_t request, uint32_t arg){
+    uint32_t flags;
+    line_state_t* line = lines[curr_pcb->term];
+
+    if (request == KBD_GETMODE)
+      return line->mode;
+    if (request != KBD_SETMODE || arg > KBD_RAW)
+      return -1;
+
+    cli_and_save(flags);
+    line->mode = arg;
+    line->mode_owner = curr_pcb->leader;
+    //what was queued was meant for the old mode
+    flush_input(line);
+    restore_flags(flags);
+    return 0;
+}
+
+/* keyboard_release
+ * input: process that is halting
+ * output: none
+ * side effects: may drop queued input
+ * function: puts its terminal back in KBD_COOKED if the process changed
+ *           the mode, so the shell gets lines again
+ */
+void keyboard_release(struct pcb* pcb){
+    line_state_t* line = lines[pcb->term];
+
+    if (line->mode_owner != pcb)
+      return;
+    line->mode = KBD_COOKED;
+    line->mode_owner = NULL;
+    flush_input(line);
+}
+
+/* flush_input
+ * input: input of a terminal
+ * output: none
+ * side effects: none
+ * function: drops queued lines, chars and events and the line being typed
+ */
+static void flush_input(line_state_t* line){
+    line->head = 0;
+    line->tail = 0;
+    line->ready = 0;
+    line->edit_len = 0;
+}
+
+/* keyboard_session
+ * input: terminal being used for the first time
+ * output: 0 on success, -1 if the heap is out of room
+ * side effects: none
+ * function: makes the terminal's input state
+ */
+int32_t keyboard_session(int32_t term){
+    if (lines[term] == NULL)
+      lines[term] = kmalloc(sizeof(line_state_t));
+    return lines[term] == NULL ? -1 : 0;
+}
+
 void clear_buffer(){
-  int32_t i;
-  for(i = 0; i < BUFFER_SIZE; i++){
-    line_char_buffer[i] = '\0';
-  }
-  buffIdx = -1;
+  line_state_t* line = lines[curr_terminal];
+  memset(line->edit, 0, BUFFER_SIZE);
+  line->edit_len = 0;
 }
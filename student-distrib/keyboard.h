@@ -16,6 +16,10 @@
 #define BKSP 0x0E
 #define SCROLL_UP 0x48
 #define SCROLL_DOWN 0x50
+#define PGUP_PRESS 0x49
+#define PGDN_PRESS 0x51
+#define KEY_BREAK 0x80
+#define SCROLLBACK_PAGE 24
 #define LSHIFT_PRESS 0x2A
 #define LSHIFT_RELEASE 0xAA
 #define RSHIFT_PRESS 0x36
@@ -25,15 +29,56 @@
 #define ALT_PRESS 0x38
 #define ALT_RELEASE 0xB8
 #define F1_PRESS 0x3B
-#define F2_PRESS 0x3C
-#define F3_PRESS 0x3D
+#define F10_PRESS 0x44
+#define F11_PRESS 0x57
+#define F12_PRESS 0x58
 #define L_CLEAR   0x26
+#define C_INTR    0x2E
 #define ENTER_PRESS 0x1C
 #define ENTER_RELEASE 0x9C
 #define SPACE_PRESS 0x39
 #define BUFFER_MAX_INDEX 127
 #define BUFFER_SIZE 129
+#define INPUT_QUEUE_SIZE 1024
 #define QUIT -2
+#define NUM_KEYS 47
+#define KEYMAP_SIZE 128
+#define KEYMAP_STATES 4
+#define KEYMAP_CAPS 1
+#define KEYMAP_SHIFT 2
+#define SCAN_RING_SIZE 64
+#define KBD_SAMPLES 16
+#define KEY_EXTENDED 0xE0
+#define EVENT_QUEUE_SIZE 64
+
+//keyboard ioctl requests and modes
+#define KBD_SETMODE 1
+#define KBD_GETMODE 2
+#define KBD_COOKED 0
+#define KBD_CBREAK 1
+#define KBD_RAW 2
+
+//key_event_t mods
+#define KEY_MOD_SHIFT 0x01
+#define KEY_MOD_CTRL 0x02
+#define KEY_MOD_ALT 0x04
+#define KEY_MOD_CAPS 0x08
+#define KEY_MOD_EXTENDED 0x10
+
+//a press or release read in raw mode
+typedef struct key_event{
+    //tsc when the keyboard irq came in
+    uint32_t tsc_lo;
+    uint32_t tsc_hi;
+    //scan code without the release bit
+    uint8_t scancode;
+    uint8_t pressed;
+    //char the key types, 0 if none
+    uint8_t ascii;
+    uint8_t mods;
+}key_event_t;
+
+struct pcb;
 
 
 extern void keyboard_init(void);
@@ -53,13 +98,24 @@ extern void clearScreen();
 extern int get_buf_idx();
 extern void set_buf_idx(int32_t index);
 extern void clear_buffer();
+int32_t keyboard_session(int32_t term);
+int32_t keyboard_ioctl(uint32_t request, uint32_t arg);
+void keyboard_release(struct pcb* pcb);
 
 int32_t keyboard_open();
 int32_t keyboard_close();
-int32_t keyboard_read(int8_t* buf, uint32_t byte_count);
+int32_t keyboard_read(uint32_t fd, int8_t* buf, uint32_t byte_count);
+int32_t keyboard_poll();
 int32_t keyboard_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t byte_count);
 
-volatile extern uint8_t line_char_buffer[BUFFER_SIZE];
+extern uint32_t input_dropped;
+extern uint32_t scan_dropped;
+extern uint32_t kbd_irq_cycles[KBD_SAMPLES];
+extern uint32_t kbd_irq_count;
+extern uint32_t kbd_bh_cycles[KBD_SAMPLES];
+extern uint32_t kbd_bh_count;
+extern uint32_t kbd_read_cycles[KBD_SAMPLES];
+extern uint32_t kbd_read_count;
 
 
 #endif
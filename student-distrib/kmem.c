@@ -0,0 +1,107 @@
+//kernel heap for buffers that only some configurations need, first fit over
+//a bitmap of 64 byte blocks
+#include "kmem.h"
+
+static uint32_t kheap_map[KHEAP_BLOCKS / 32];
+static uint32_t kheap_used;
+
+static int32_t block_taken(int32_t b);
+static void mark_blocks(int32_t first, int32_t count, int32_t taken);
+
+/* kmem_init
+ *
+ * DESCRIPTION: marks the whole heap free, paging_init maps it
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void kmem_init(void){
+    int32_t i;
+    for(i = 0; i < KHEAP_BLOCKS / 32; i++)
+        kheap_map[i] = 0;
+    kheap_used = 0;
+}
+
+/* kmalloc
+ *
+ * DESCRIPTION: takes the first run of free blocks that fits, a page or more
+ *              is page aligned
+ * INPUT/OUTPUT: uint32_t size - bytes wanted
+ *               returns zeroed memory, NULL if the heap is full
+ * SIDE EFFECTS: none
+ */
+void* kmalloc(uint32_t size){
+    uint32_t flags;
+    int32_t count, step, first, i;
+    void* addr;
+
+    if(size == 0 || size > KHEAP_SIZE)
+        return NULL;
+    count = (size + KHEAP_BLOCK - 1) / KHEAP_BLOCK;
+    step = (count >= KHEAP_PAGE_BLOCKS) ? KHEAP_PAGE_BLOCKS : 1;
+
+    cli_and_save(flags);
+    for(first = 0; first + count <= KHEAP_BLOCKS; first += step){
+        for(i = 0; i < count; i++){
+            if(block_taken(first + i))
+                break;
+        }
+        if(i == count)
+            break;
+        //a single block run can skip past the taken one
+        if(step == 1)
+            first += i;
+    }
+    if(first + count > KHEAP_BLOCKS){
+        restore_flags(flags);
+        return NULL;
+    }
+    mark_blocks(first, count, 1);
+    kheap_used += count * KHEAP_BLOCK;
+    restore_flags(flags);
+
+    addr = (void*)(KHEAP_BASE + first * KHEAP_BLOCK);
+    memset(addr, 0, count * KHEAP_BLOCK);
+    return addr;
+}
+
+/* kfree
+ *
+ * DESCRIPTION: gives back what kmalloc returned for the same size
+ * INPUT/OUTPUT: void* addr, uint32_t size
+ * SIDE EFFECTS: none
+ */
+void kfree(void* addr, uint32_t size){
+    uint32_t flags;
+    int32_t count = (size + KHEAP_BLOCK - 1) / KHEAP_BLOCK;
+
+    if(addr == NULL)
+        return;
+    cli_and_save(flags);
+    mark_blocks(((uint32_t)addr - KHEAP_BASE) / KHEAP_BLOCK, count, 0);
+    kheap_used -= count * KHEAP_BLOCK;
+    restore_flags(flags);
+}
+
+/* kmem_used
+ *
+ * DESCRIPTION: bytes handed out, in whole blocks
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+uint32_t kmem_used(void){
+    return kheap_used;
+}
+
+static int32_t block_taken(int32_t b){
+    return kheap_map[b >> 5] & (1 << (b & 31));
+}
+
+static void mark_blocks(int32_t first, int32_t count, int32_t taken){
+    int32_t b;
+    for(b = first; b < first + count; b++){
+        if(taken)
+            kheap_map[b >> 5] |= 1 << (b & 31);
+        else
+            kheap_map[b >> 5] &= ~(1 << (b & 31));
+    }
+}
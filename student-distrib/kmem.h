@@ -0,0 +1,22 @@
+#ifndef KMEM_H
+#define KMEM_H
+
+#include "types.h"
+#include "lib.h"
+
+//4MB after the shm segments, mapped for the kernel only
+#define KHEAP_BASE 0x3000000
+#define KHEAP_SIZE 0x400000
+#define KHEAP_PDE (KHEAP_BASE >> 22)
+//allocations are rounded up to whole blocks, the ones of a page or more
+//start on a page
+#define KHEAP_BLOCK 64
+#define KHEAP_BLOCKS (KHEAP_SIZE / KHEAP_BLOCK)
+#define KHEAP_PAGE_BLOCKS (4096 / KHEAP_BLOCK)
+
+void kmem_init(void);
+void* kmalloc(uint32_t size);
+void kfree(void* addr, uint32_t size);
+uint32_t kmem_used(void);
+
+#endif
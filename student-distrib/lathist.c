@@ -0,0 +1,106 @@
+//log2 latency histograms of the IRQ handlers and of context switches, in
+//tsc cycles. The IRQ wrappers in idt_wrappers.S time the handler call and
+//switch_to times itself up to where the next task resumes.
+#include "lathist.h"
+#include "sys_handlers.h"
+#include "i8259.h"
+
+#if LAT_HIST
+uint32_t lat_switch_stamp;
+
+static lat_hist_t lat[LAT_SOURCES];
+
+static void lat_record(int32_t src, uint32_t cycles);
+
+/* lat_irq
+ *
+ * DESCRIPTION: called by the IRQ wrappers after the handler, with
+ *              interrupts off
+ * INPUT/OUTPUT: uint32_t vec - interrupt vector
+ *               uint32_t cycles - how long the handler took
+ * SIDE EFFECTS: none
+ */
+void lat_irq(uint32_t vec, uint32_t cycles){
+    lat_record(vec - ICW2_MASTER, cycles);
+}
+
+/* lat_switch_end
+ *
+ * DESCRIPTION: called by switch_to in the task that was switched to, once
+ *              context_switch returned there. A task's first run starts
+ *              somewhere else and isn't counted.
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void lat_switch_end(void){
+    uint32_t end;
+
+    asm volatile("rdtsc" : "=a"(end) : : "edx");
+    lat_record(LAT_SWITCH, end - lat_switch_stamp);
+}
+
+/* lat_record
+ *
+ * DESCRIPTION: counts one latency in its log2 bucket
+ * INPUT/OUTPUT: int32_t src - histogram
+ *               uint32_t cycles - latency
+ * SIDE EFFECTS: none
+ */
+static void lat_record(int32_t src, uint32_t cycles){
+    lat_hist_t* h;
+    uint32_t b = 0;
+
+    if(src < 0 || src >= LAT_SOURCES)
+        return;
+    h = &lat[src];
+
+    if(cycles)
+        asm("bsrl %1, %0" : "=r"(b) : "rm"(cycles));
+    h->buckets[b]++;
+    if(h->count == 0 || cycles < h->min)
+        h->min = cycles;
+    if(cycles > h->max)
+        h->max = cycles;
+    h->count++;
+}
+#endif
+
+/* lathist
+ *
+ * DESCRIPTION: Copies a latency histogram to user space: how many were
+ *              counted, the shortest, the longest and the LAT_BUCKETS log2
+ *              buckets. Sources 0 to 15 are the IRQ lines, LAT_SWITCH is
+ *              the context switch and LAT_RESET clears every histogram.
+ * INPUT/OUTPUT: int32_t src - histogram
+ *               uint32_t* buf - user buffer for n words
+ *               returns how many words were copied, -1 on a bad argument or
+ *               if the kernel was built without LAT_HIST
+ * SIDE EFFECTS: none
+ */
+int32_t lathist(int32_t src, uint32_t* buf, int32_t n){
+#if LAT_HIST
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if(src == LAT_RESET){
+        memset(lat, 0, sizeof(lat));
+        restore_flags(flags);
+        return 0;
+    }
+    restore_flags(flags);
+
+    if(src < 0 || src >= LAT_SOURCES || n < 0)
+        return -1;
+    if((uint32_t)buf < USER || (uint32_t)buf >= OOB || n > (int32_t)((OOB - (uint32_t)buf) / 4))
+        return -1;
+    if(n > LAT_WORDS)
+        n = LAT_WORDS;
+
+    cli_and_save(flags);
+    memcpy(buf, &lat[src], n * 4);
+    restore_flags(flags);
+    return n;
+#else
+    return -1;
+#endif
+}
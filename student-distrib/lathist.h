@@ -0,0 +1,45 @@
+#ifndef LATHIST_H
+#define LATHIST_H
+
+//0 compiles the latency histograms out, with every rdtsc feeding them
+#define LAT_HIST 1
+
+//one histogram per IRQ line for its handler and one for context switches
+#define LAT_SWITCH 16
+#define LAT_SOURCES 17
+//bucket b counts latencies from 2^b to 2^(b+1) - 1 cycles, bucket 0 also 0
+#define LAT_BUCKETS 32
+//words lathist copies out: count, min, max and the buckets
+#define LAT_WORDS (3 + LAT_BUCKETS)
+//lathist source that clears every histogram
+#define LAT_RESET -1
+
+#ifndef ASM
+
+#include "types.h"
+#include "lib.h"
+
+typedef struct lat_hist{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t buckets[LAT_BUCKETS];
+}lat_hist_t;
+
+#if LAT_HIST
+//tsc low word at the start of the latest context switch
+extern uint32_t lat_switch_stamp;
+#define LAT_SWITCH_BEGIN() asm volatile("rdtsc" : "=a"(lat_switch_stamp) : : "edx")
+#define LAT_SWITCH_END() lat_switch_end()
+#else
+#define LAT_SWITCH_BEGIN() do{}while(0)
+#define LAT_SWITCH_END() do{}while(0)
+#endif
+
+void lat_irq(uint32_t vec, uint32_t cycles);
+void lat_switch_end(void);
+int32_t lathist(int32_t src, uint32_t* buf, int32_t n);
+
+#endif /* ASM */
+
+#endif
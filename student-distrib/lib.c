@@ -3,52 +3,124 @@
  */
 
 #include "lib.h"
+#include "kmem.h"
 #define VIDEO 0xB8000
 #define NUM_COLS 80
 #define NUM_ROWS 25
 #define ATTRIB 0x7
+#define BLANK(c) (((c)->attrib << 8) | ' ')
+//a console scrolls down through this many rows of its cell buffer before
+//its screen is copied back to the top
+#define RING_ROWS 51
+#define DIRTY_WORDS ((RING_ROWS + 31) / 32)
+#define RING_BYTES (RING_ROWS*NUM_COLS*2)
+//text memory has room for VGA_SLOTS consoles, 2 pages (8KB) each, laid out
+//like their cell buffer so scrolling there is a CRTC start address write.
+//Consoles take turns in slot id % VGA_SLOTS.
+#define VGA_SLOTS 3
+#define RING_CELLS 0x1000
+//the scrollback view is drawn in the page after the last slot
+#define VIEW_CELL (VGA_SLOTS*RING_CELLS)
+#define HIST_ROWS 200
+#define HIST_BYTES (HIST_ROWS*NUM_COLS*2)
+#define CRTC_INDEX 0x3D4
+#define CRTC_DATA 0x3D5
+#define CRTC_START_HI 0x0C
+#define CRTC_START_LO 0x0D
+#define CRTC_CURSOR_HI 0x0E
+#define CRTC_CURSOR_LO 0x0F
+//cell (x, y) of a console's screen in its cell buffer
+#define CELL(c, x, y) ((c)->cells + ((c)->top_row + (y))*NUM_COLS + (x))
+//text memory cell showing the top left corner of a console's screen
+#define SLOT_CELL(c) ((c)->slot*RING_CELLS + (c)->top_row*NUM_COLS)
+#define MARK_DIRTY(c, row) ((c)->dirty[(row) >> 5] |= 1 << ((row) & 31))
+#define HIST_ROW(c, i) ((c)->history + (i)*NUM_COLS)
+
+//everything a terminal writes goes to its console, whether it is shown or not
+typedef struct console{
+    int x;
+    int y;
+    uint16_t attrib;
+    //RING_ROWS rows, the screen is the NUM_ROWS from top_row down
+    uint16_t* cells;
+    int top_row;
+    //ring rows written since they were last copied to text memory
+    uint32_t dirty[DIRTY_WORDS];
+    //where in text memory the console is shown
+    int slot;
+    //a program draws into the screen through vidmap
+    int mapped;
+    //HIST_ROWS rows scrolled off the top
+    uint16_t* history;
+    int hist_head;
+    int hist_count;
+}console_t;
 
-static int screen_x;
-static int screen_y;
 static char* video_mem = (char *)VIDEO;
+//the boot console exists before the heap does
+static uint16_t boot_cells[RING_ROWS*NUM_COLS] __attribute__((aligned (4096)));
+static uint16_t boot_history[HIST_ROWS*NUM_COLS];
+//the others are made by console_create, cells is NULL until then
+static console_t consoles[MAX_CONSOLES] = {
+    {0, 0, ATTRIB, boot_cells, 0, {0}, 0, 0, boot_history, 0, 0}
+};
+//console whose rows text memory holds in each slot
+static console_t* slot_owner[VGA_SLOTS] = {consoles};
+//console of the running task, all output goes there
+static console_t* con = consoles;
+//console on the screen
+static console_t* shown = consoles;
+//rows the scrollback view is moved up by, 0 shows the live screen
+static int view_rows;
+//start address the CRTC was last given
+static int crtc_start;
+
+static void set_start(int cell);
+static void show_cursor(void);
+static void flush(console_t* c);
+static void render(console_t* c);
+static void ring_rewind(console_t* c);
+static void advance(console_t* c, int rows);
 
 /* int coordReturn(int coord);
 *       Inputs: 0 or 1 depending if user wants the x coordinate
 *               or y coordinate
-*       Return Value: screen_x or screen_y
-*       Function: Getter function for screen_x and screen_y coordinate
+*       Return Value: x or y of the current screen's cursor
+*       Function: Getter function for the x and y coordinate
 * */
 int coordReturn(int coord) {
   if (coord)
-    return screen_x;
-  return screen_y;
+    return con->x;
+  return con->y;
 }
 /*
 * void clear(void);
 *   Inputs: void
 *   Return Value: none
-*	Function: Clears video memory
+*	Function: Clears the screen of the running task's console
 */
 
 void
 clear(void)
 {
-    int32_t i;
-    for(i=0; i<NUM_ROWS*NUM_COLS; i++) {
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
-    }
+    int i;
+
+    if(con == shown)
+        view_rows = 0;
+    con->top_row = 0;
+    memset_word(CELL(con, 0, 0), BLANK(con), NUM_ROWS*NUM_COLS);
+    for(i = 0; i < NUM_ROWS; i++)
+        MARK_DIRTY(con, i);
+    render(con);
 }
 
 void
 clear_line(void)
 {
-  int32_t i;
-  for (i = screen_y*NUM_COLS; i<(screen_y+1)*NUM_COLS; i++) {
-    *(uint8_t *)(video_mem + (i << 1)) = ' ';
-    *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
-  }
-  screen_x = 0;
+  memset_word(CELL(con, 0, con->y), BLANK(con), NUM_COLS);
+  MARK_DIRTY(con, con->top_row + con->y);
+  render(con);
+  con->x = 0;
 }
 
 /* Standard printf().
@@ -209,33 +281,7 @@ puts(int8_t* s)
 void
 putc(uint8_t c)
 {
-    //if you are in the bottom right, you need to scroll
-    if(screen_x == NUM_COLS-1 && screen_y == NUM_ROWS-1)
-      terminal_scroll();
-    if(c == '\n' || c == '\r') {
-        //if enter is called from bottom, scroll is needed
-        if(screen_y == NUM_ROWS-1)
-          terminal_scroll();
-        //set new screen x and y on enter key
-        else{
-          screen_y++;
-          screen_x=0;
-        }
-    } else {
-        //if the right side is reached, you want to wrap to the next line
-        if(screen_x == NUM_COLS-1){
-          screen_y++;
-          screen_x = 0;
-        }
-        //write teh character to the screen
-        *(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1)) = c;
-        *(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1) + 1) = ATTRIB;
-        screen_x++;
-        screen_x %= NUM_COLS;
-        screen_y = (screen_y + (screen_x / NUM_COLS)) % NUM_ROWS;
-    }
-    //helper function to place the blinking cursor at screen x and y
-    placeCursor(screen_x, screen_y);
+    putc_buf(&c, 1);
 }
 
 /*
@@ -244,35 +290,355 @@ putc(uint8_t c)
  * Outputs: none
  * Side effects: scrolls screen down and erases top line
  *                and also clears bottom line
- * Function: scrolls the screen when bounds are exited
+ * Function: scrolls the screen by one line, the top line goes to the
+ *           scrollback history
 */
 void terminal_scroll(){
-    int new_dest, origin;
-    int x,y;
-
-    //go through each row and column and copt over the video memory from the
-    //old dest to the new dest, it is similar to shifting up video memory by a
-    //row
-    for(y=0;y<NUM_ROWS-1;y++){
-      for(x=0;x<NUM_COLS;x++){
-        origin = (y+1)*NUM_COLS + x;
-        new_dest = y*NUM_COLS + x;
-        //write to video memory
-        *(uint8_t *)(video_mem + (new_dest << 1)) = *(uint8_t *)(video_mem + (origin << 1));
-      }
+    if(con->top_row + NUM_ROWS >= RING_ROWS)
+        ring_rewind(con);
+    memset_word(CELL(con, 0, NUM_ROWS), BLANK(con), NUM_COLS);
+    MARK_DIRTY(con, con->top_row + NUM_ROWS);
+    advance(con, 1);
+    render(con);
+    placeCursor(0, NUM_ROWS-1);
+}
+
+/*
+ * void putc_buf(const uint8_t* buf, uint32_t n);
+ *   Inputs: buf - characters to print, n - how many
+ *   Return Value: void
+ *   Function: Same output as calling putc on every byte, into the console of
+ *             the running task. Text is drawn into the cell buffer below the
+ *             screen as char/attribute runs and the screen is moved down over
+ *             it, so rows are never moved one at a time. The screen is copied
+ *             back to the top once the buffer runs out. If the console is
+ *             shown, only the rows that changed are copied to text memory,
+ *             once at the end.
+ */
+void
+putc_buf(const uint8_t* buf, uint32_t n)
+{
+    uint32_t i = 0, start, k;
+    int x = con->x;
+    int y = con->y;
+    int limit, bottom, shift, newline;
+    uint16_t* cell;
+
+    while(i < n){
+        if(con->top_row + NUM_ROWS >= RING_ROWS)
+            ring_rewind(con);
+        //last screen row the ring has room for
+        limit = RING_ROWS - 1 - con->top_row;
+        bottom = NUM_ROWS - 1;
+
+        while(i < n){
+            newline = (buf[i] == '\n' || buf[i] == '\r');
+            //last column is never written, a character there wraps first
+            if(newline || x == NUM_COLS-1){
+                if(y == limit)
+                    break;
+                y++;
+                x = 0;
+                //rows below the screen still hold the ring's last lap
+                if(y > bottom){
+                    memset_word(CELL(con, 0, y), BLANK(con), NUM_COLS);
+                    MARK_DIRTY(con, con->top_row + y);
+                    bottom = y;
+                }
+                if(newline){
+                    i++;
+                    continue;
+                }
+            }
+
+            start = i;
+            while(i < n && buf[i] != '\n' && buf[i] != '\r' && x + (int)(i - start) < NUM_COLS-1)
+                i++;
+            cell = CELL(con, x, y);
+            for(k = start; k < i; k++)
+                *cell++ = (con->attrib << 8) | buf[k];
+            MARK_DIRTY(con, con->top_row + y);
+            x += i - start;
+        }
+
+        shift = y - (NUM_ROWS-1);
+        if(shift > 0){
+            advance(con, shift);
+            y -= shift;
+        }
+    }
+
+    render(con);
+    placeCursor(x, y);
+}
+
+/*
+ * set_start
+ * Inputs: cell - text memory cell to show in the top left corner
+ * Outputs: none
+ * Side effects: reprograms the CRTC, unless the scrollback view is up
+ * Function: hardware scrolling
+ */
+static void set_start(int cell){
+    if(view_rows && cell != VIEW_CELL)
+        return;
+    if(cell == crtc_start)
+        return;
+    crtc_start = cell;
+    outb(CRTC_START_HI, CRTC_INDEX);
+    outb((cell >> 8) & 0xFF, CRTC_DATA);
+    outb(CRTC_START_LO, CRTC_INDEX);
+    outb(cell & 0xFF, CRTC_DATA);
+}
+
+/*
+ * flush
+ * Inputs: c - console
+ * Outputs: none
+ * Side effects: modifies video memory
+ * Function: copies the screen rows written since the last flush from the
+ *           cell buffer to the same rows of the console's text memory,
+ *           rows off the screen are rewritten before they come back on it
+ */
+static void flush(console_t* c){
+    int r, row;
+    uint16_t* slot = (uint16_t*)video_mem + c->slot*RING_CELLS;
+
+    for(r = 0; r < NUM_ROWS; r++){
+        row = c->top_row + r;
+        if(c->dirty[row >> 5] & (1 << (row & 31)))
+            memcpy(slot + row*NUM_COLS, c->cells + row*NUM_COLS, NUM_COLS*2);
     }
+    for(r = 0; r < DIRTY_WORDS; r++)
+        c->dirty[r] = 0;
+}
 
-    //clear the bottom row
-    for(x=0;x<NUM_COLS;x++){
-      new_dest = NUM_COLS*(NUM_ROWS-1) + x;
-      *(uint8_t *)(video_mem + (new_dest << 1)) = ' ';
+/*
+ * render
+ * Inputs: c - console that was written to
+ * Outputs: none
+ * Side effects: modifies video memory, reprograms the CRTC
+ * Function: brings the screen up to date if c is shown, a console in the
+ *           background keeps its dirty rows until it is shown. Showing a
+ *           console in a slot another one used last redraws the screen.
+ */
+static void render(console_t* c){
+    int r;
+
+    if(c != shown)
+        return;
+    //the slot held another console's rows
+    if(slot_owner[c->slot] != c){
+        slot_owner[c->slot] = c;
+        for(r = 0; r < NUM_ROWS; r++)
+            MARK_DIRTY(c, c->top_row + r);
     }
+    flush(c);
+    set_start(SLOT_CELL(c));
+}
 
-    //set the cursor to the bottom row
-    screen_y = NUM_ROWS-1;
-    screen_x = 0;
-    placeCursor(screen_x,screen_y);
+/*
+ * advance
+ * Inputs: c - console, rows - how far to scroll, the rows below the screen
+ *         are drawn
+ * Outputs: none
+ * Side effects: rows leaving the top go to the console's history
+ * Function: moves the screen down the ring
+ */
+static void advance(console_t* c, int rows){
+    int i;
+
+    for(i = 0; i < rows; i++){
+        memcpy(HIST_ROW(c, c->hist_head), CELL(c, 0, i), NUM_COLS*2);
+        c->hist_head = (c->hist_head + 1) % HIST_ROWS;
+    }
+    c->hist_count += rows;
+    if(c->hist_count > HIST_ROWS)
+        c->hist_count = HIST_ROWS;
+
+    c->top_row += rows;
+}
 
+/*
+ * ring_rewind
+ * Inputs: c - console
+ * Outputs: none
+ * Side effects: none
+ * Function: copies the screen back to the top of the ring, happens once
+ *           every RING_ROWS - NUM_ROWS lines of output
+ */
+static void ring_rewind(console_t* c){
+    int i;
+
+    if(c->top_row == 0)
+        return;
+    memcpy(c->cells, CELL(c, 0, 0), NUM_ROWS*NUM_COLS*2);
+    c->top_row = 0;
+    for(i = 0; i < NUM_ROWS; i++)
+        MARK_DIRTY(c, i);
+}
+
+/*
+ * console_create
+ * Inputs: id - console to make
+ * Outputs: 0 on success, -1 if the heap is out of room
+ * Side effects: none
+ * Function: consoles past the boot one get their cell buffer and history
+ *           the first time their terminal is used
+ */
+int console_create(int id){
+    console_t* c = &consoles[id];
+
+    if(c->cells != NULL)
+        return 0;
+    c->history = kmalloc(HIST_BYTES);
+    if(c->history == NULL)
+        return -1;
+    c->cells = kmalloc(RING_BYTES);
+    if(c->cells == NULL){
+        kfree(c->history, HIST_BYTES);
+        c->history = NULL;
+        return -1;
+    }
+    c->attrib = ATTRIB;
+    c->slot = id % VGA_SLOTS;
+    return 0;
+}
+
+/*
+ * console_route
+ * Inputs: id - console output goes to from now on
+ * Outputs: the console it went to before
+ * Side effects: none
+ * Function: the scheduler routes output to the console of the task it
+ *           switches to, the keyboard echoes on the shown one
+ */
+int console_route(int id){
+    int prev = con - consoles;
+    con = &consoles[id];
+    return prev;
+}
+
+/*
+ * screen_select
+ * Inputs: id - console to show
+ * Outputs: none
+ * Side effects: leaves the scrollback view, reprograms the CRTC
+ * Function: a console keeps its slot of text memory while no other console
+ *           uses it, so switching only copies the rows that changed while it
+ *           was in the background and moves the start address and cursor
+ *           over to it
+ */
+void screen_select(int id){
+    scrollback_end();
+    shown = &consoles[id];
+    render(shown);
+    show_cursor();
+}
+
+/*
+ * screen_map
+ * Inputs: none
+ * Outputs: address of the page holding the screen
+ * Side effects: none
+ * Function: for programs that draw into the screen through vidmap, they
+ *           expect it at the start of a page. They draw into the cell
+ *           buffer, which is redrawn every tick while shown.
+ */
+uint32_t screen_map(void){
+    ring_rewind(con);
+    con->mapped = 1;
+    render(con);
+    placeCursor(con->x, con->y);
+    return (uint32_t)con->cells;
+}
+
+/*
+ * screen_unmap
+ * Inputs: none
+ * Outputs: none
+ * Side effects: none
+ * Function: a process of the console halted, drawing through vidmap is over
+ */
+void screen_unmap(void){
+    con->mapped = 0;
+}
+
+/*
+ * screen_tick
+ * Inputs: none
+ * Outputs: none
+ * Side effects: modifies video memory
+ * Function: called every PIT tick, shows what was drawn through vidmap
+ */
+void screen_tick(void){
+    int r;
+
+    if(!shown->mapped)
+        return;
+    for(r = 0; r < NUM_ROWS; r++)
+        MARK_DIRTY(shown, shown->top_row + r);
+    render(shown);
+}
+
+/*
+ * screen_mapped
+ * Inputs: none
+ * Outputs: 1 if the shown console is drawn through vidmap
+ * Side effects: none
+ * Function: a nohz pit keeps ticking for screen_tick while this is set
+ */
+int screen_mapped(void){
+    return shown->mapped;
+}
+
+/*
+ * scrollback
+ * Inputs: rows - how far to move the view up, negative moves it down
+ * Outputs: none
+ * Side effects: reprograms the CRTC
+ * Function: shift+pgup/pgdn. The view of the shown console is put together
+ *           from its history and screen in a page of its own, the screen
+ *           keeps taking output underneath.
+ */
+void scrollback(int rows){
+    int r, s, count = shown->hist_count;
+    uint16_t* view = (uint16_t*)video_mem + VIEW_CELL;
+    uint16_t* src;
+
+    view_rows += rows;
+    if(view_rows > count)
+        view_rows = count;
+    if(view_rows <= 0){
+        scrollback_end();
+        return;
+    }
+
+    //history and screen read as one sequence of count + NUM_ROWS rows
+    for(r = 0; r < NUM_ROWS; r++){
+        s = count - view_rows + r;
+        if(s < count)
+            src = HIST_ROW(shown, (shown->hist_head - count + s + HIST_ROWS) % HIST_ROWS);
+        else
+            src = CELL(shown, 0, s - count);
+        memcpy(view + r*NUM_COLS, src, NUM_COLS*2);
+    }
+    set_start(VIEW_CELL);
+}
+
+/*
+ * scrollback_end
+ * Inputs: none
+ * Outputs: none
+ * Side effects: reprograms the CRTC
+ * Function: back to the live screen
+ */
+void scrollback_end(void){
+    if(view_rows == 0)
+        return;
+    view_rows = 0;
+    set_start(SLOT_CELL(shown));
+    show_cursor();
 }
 
 /* void backspace
@@ -285,37 +651,56 @@ void terminal_scroll(){
  */
  void backspace(){
    //go to previous line if all the way on left of screen
-   if(screen_x == 0){
-    screen_y = screen_y-1;
-    screen_x = NUM_COLS-1;
+   if(con->x == 0){
+    con->y = con->y-1;
+    con->x = NUM_COLS-1;
   }else{
     //go back on character
-   screen_x--;
+   con->x--;
   }
   //write a space over the character to "delete" it from screen
-   *(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1)) = ' ';
-   placeCursor(screen_x, screen_y);
+   *CELL(con, con->x, con->y) = BLANK(con);
+   MARK_DIRTY(con, con->top_row + con->y);
+   render(con);
+   placeCursor(con->x, con->y);
  }
 
  /* void placeCursor
   * inputs: x coord, y coord
   * outputs: none
   * side effects: changes spot of blinking cursor on screen
-  * function: helper function to schange the spot of the blinking cursor
+  * function: helper function to schange the spot of the blinking cursor,
+  *           the hardware one only follows the shown console
   */
 void placeCursor(int x, int y){
 
-  screen_x = x;
-  screen_y = y;
+  con->x = x;
+  con->y = y;
+
+  if(con == shown)
+    show_cursor();
+}
+
+/* void show_cursor
+ * inputs: none
+ * outputs: none
+ * side effects: moves the hardware cursor
+ * function: puts the blinking cursor at the shown console's position
+ */
+static void show_cursor(void){
+
+  //the view has no cursor, it comes back with the live screen
+  if(view_rows)
+    return;
 
-  unsigned short position=(y*NUM_COLS) + x;
+  unsigned short position=SLOT_CELL(shown) + shown->y*NUM_COLS + shown->x;
 
   // cursor LOW port to vga INDEX register
-  outb(0x0F, 0x3D4);
-  outb((unsigned char)(position&0xFF), 0x3D5);
+  outb(CRTC_CURSOR_LO, CRTC_INDEX);
+  outb((unsigned char)(position&0xFF), CRTC_DATA);
   // cursor HIGH port to vga INDEX register
-  outb(0x0E, 0x3D4);
-  outb((unsigned char )((position>>8)&0xFF), 0x3D5);
+  outb(CRTC_CURSOR_HI, CRTC_INDEX);
+  outb((unsigned char )((position>>8)&0xFF), CRTC_DATA);
 
   return;
 }
@@ -328,8 +713,8 @@ void placeCursor(int x, int y){
  */
 void resetCursor() {
   //update screen x and y
-  screen_x = 0;
-  screen_y = 0;
+  con->x = 0;
+  con->y = 0;
   //place new cursor
   placeCursor(0,0);
   return;
@@ -699,6 +1084,10 @@ test_interrupts(void)
 {
 	int32_t i;
 	for (i=0; i < NUM_ROWS*NUM_COLS; i++) {
-		video_mem[i<<1]++;
+		(*(uint8_t*)CELL(con, i, 0))++;
+	}
+	for (i=0; i < NUM_ROWS; i++) {
+		MARK_DIRTY(con, con->top_row + i);
 	}
+	render(con);
 }
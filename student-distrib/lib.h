@@ -6,13 +6,29 @@
 #define _LIB_H
 
 #include "types.h"
+#include "irqtrace.h"
+
+//most terminals there can be, each has a console of its own
+#define MAX_CONSOLES 12
+//interrupt flag in EFLAGS
+#define EFLAGS_IF 0x200
 
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
+void putc_buf(const uint8_t* buf, uint32_t n);
 void backspace();
 void resetCursor();
 void placeCursor(int x, int y);
 void terminal_scroll();
+int console_create(int id);
+int console_route(int id);
+void screen_select(int id);
+uint32_t screen_map(void);
+void screen_unmap(void);
+void screen_tick(void);
+int screen_mapped(void);
+void scrollback(int rows);
+void scrollback_end(void);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
 int8_t *strrev(int8_t* s);
@@ -103,6 +119,17 @@ do {                                    \
 			: "memory", "cc" );         \
 } while(0)
 
+/* With IRQSOFF_TRACE every change of the interrupt flag is reported to
+ * the interrupts off tracer, right after interrupts go off and right
+ * before they go back on */
+#if IRQSOFF_TRACE
+#define TRACE_IRQS_OFF() trace_irqs_off()
+#define TRACE_IRQS_ON() trace_irqs_on()
+#else
+#define TRACE_IRQS_OFF() do {} while(0)
+#define TRACE_IRQS_ON() do {} while(0)
+#endif
+
 /* Clear interrupt flag - disables interrupts on this processor */
 #define cli()                           \
 do {                                    \
@@ -111,6 +138,7 @@ do {                                    \
 			:                       \
 			: "memory", "cc"        \
 			);                      \
+	TRACE_IRQS_OFF();               \
 } while(0)
 
 /* Save flags and then clear interrupt flag
@@ -125,6 +153,7 @@ do {                                    \
 			:                       \
 			: "memory", "cc"        \
 			);                      \
+	TRACE_IRQS_OFF();               \
 } while(0)
 /* Save flags
  * Saves the EFLAGS register into the variable "flags"*/
@@ -141,6 +170,7 @@ do {                                    \
 /* Set interrupt flag - enable interrupts on this processor */
 #define sti()                           \
 do {                                    \
+	TRACE_IRQS_ON();                \
 	asm volatile("sti"                  \
 			:                       \
 			:                       \
@@ -153,6 +183,8 @@ do {                                    \
  * after a cli_and_save_flags(flags) */
 #define restore_flags(flags)            \
 do {                                    \
+	if ((flags) & EFLAGS_IF)        \
+		TRACE_IRQS_ON();            \
 	asm volatile("pushl %0      \n      \
 			popfl"                  \
 			:                       \
@@ -1,5 +1,6 @@
 // this is going to be the paging.c file
 #include "paging.h"
+#include "kmem.h"
 
 /* paging_init
  *
@@ -38,18 +39,20 @@ void paging_init(void)
     entry |= SRWON;
     page_directory[1] = entry;
 
+    // the kernel heap, another 4MB page only the kernel sees
+    page_directory[KHEAP_PDE] = KHEAP_BASE | SRWON;
+
     // fill the page tables so that pages are properly initialized
     for(i = 0; i < DIRECTORY_SIZE; i++){
         page_table[i] = RW;
     }
 
     // properly handle the video memory segment
-    entry = VIDEO;
-    entry |= RWON;
-    page_table[VIDEO >> 12] = entry;
-    page_table[(VIDEO >> 12) + 1] = BACKUP0 | RWON;
-    page_table[(VIDEO >> 12) + 2] = BACKUP1 | RWON;
-    page_table[(VIDEO >> 12) + 3] = BACKUP2 | RWON;
+    for(i = 0; i < VIDEO_PAGES; i++){
+        entry = VIDEO + i * PAGE_SIZE;
+        entry |= RWON;
+        page_table[(VIDEO >> 12) + i] = entry;
+    }
 
 
     // enable paging used the appropriate control registers
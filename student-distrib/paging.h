@@ -9,9 +9,9 @@
 #define DIRECTORY_SIZE 1024
 #define PAGE_SIZE (DIRECTORY_SIZE * 4)
 #define VIDEO 0xB8000
-#define BACKUP0 0xB9000
-#define BACKUP1 0xBA000
-#define BACKUP2 0xBB000
+//text memory is 8 pages, 2 for each terminal's screen, then the scrollback
+//view page and a spare one
+#define VIDEO_PAGES 8
 #define KERNEL 0x400000
 
 #define RW 0x02
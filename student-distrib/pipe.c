@@ -0,0 +1,240 @@
+//kernel pipes, a bounded ring buffer shared by a read end and a write end
+#include "pipe.h"
+#include "signal.h"
+
+static pipe_t pipes[MAX_PIPES];
+
+static int32_t pipe_read(pipe_t* p, uint8_t* buf, int32_t nbytes, int32_t nonblock);
+static int32_t pipe_write(pipe_t* p, const uint8_t* buf, int32_t nbytes, int32_t nonblock);
+static int32_t pipe_close(pipe_t* p, int32_t end);
+static int32_t pipe_poll(pipe_t* p, int32_t end);
+
+/* pipe_init
+ *
+ * DESCRIPTION: marks every pipe as free
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void pipe_init(void){
+    int32_t i;
+    for(i = 0; i < MAX_PIPES; i++){
+        pipes[i].readers = 0;
+        pipes[i].writers = 0;
+    }
+}
+
+/* pipe_create
+ *
+ * DESCRIPTION: takes a free pipe, a pipe is free once both ends are closed
+ * INPUT/OUTPUT: int32_t size - capacity in bytes, 0 or too big means PIPE_BUF_MAX
+ *               returns pipe number, -1 if all pipes are in use
+ * SIDE EFFECTS: pipe starts with one reader and one writer
+ */
+int32_t pipe_create(int32_t size){
+    int32_t i;
+    uint32_t flags;
+    cli_and_save(flags);
+
+    for(i = 0; i < MAX_PIPES; i++){
+        if(pipes[i].readers == 0 && pipes[i].writers == 0)
+            break;
+    }
+    if(i == MAX_PIPES){
+        restore_flags(flags);
+        return -1;
+    }
+
+    if(size <= 0 || size > PIPE_BUF_MAX)
+        size = PIPE_BUF_MAX;
+    pipes[i].size = size;
+    pipes[i].head = 0;
+    pipes[i].count = 0;
+    pipes[i].readers = 1;
+    pipes[i].writers = 1;
+
+    restore_flags(flags);
+    return i;
+}
+
+/* pipe_ref
+ *
+ * DESCRIPTION: one more fd refers to this end, used by dup2 and by children
+ *              inheriting stdin/stdout
+ * INPUT/OUTPUT: int32_t pipe_num, int32_t end
+ * SIDE EFFECTS: none
+ */
+void pipe_ref(int32_t pipe_num, int32_t end){
+    uint32_t flags;
+    cli_and_save(flags);
+    if(end == PIPE_READ_END)
+        pipes[pipe_num].readers++;
+    else
+        pipes[pipe_num].writers++;
+    restore_flags(flags);
+}
+
+/* pipe_driver
+ *
+ * DESCRIPTION: fd table entry for both ends, inode holds the pipe number
+ *              and position holds which end the fd is
+ * INPUT/OUTPUT: uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes
+ *               returns -1 on the wrong end or an unknown command
+ * SIDE EFFECTS: read and write block unless the fd is O_NONBLOCK
+ */
+int32_t pipe_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes){
+    pipe_t* p = &pipes[curr_pcb->fd_table[fd].inode];
+    int32_t end = curr_pcb->fd_table[fd].position;
+    int32_t nonblock = curr_pcb->fd_table[fd].mode & O_NONBLOCK;
+
+    if(cmd == OPEN){
+        return 0;
+    }
+    else if(cmd == READ){
+        if(end != PIPE_READ_END)
+            return -1;
+        return pipe_read(p,(uint8_t*)buf,(int32_t)nbytes,nonblock);
+    }
+    else if(cmd == WRITE){
+        if(end != PIPE_WRITE_END)
+            return -1;
+        return pipe_write(p,(const uint8_t*)buf,(int32_t)nbytes,nonblock);
+    }
+    else if(cmd == CLOSE){
+        return pipe_close(p,end);
+    }
+    else if(cmd == POLL){
+        return pipe_poll(p,end);
+    }
+    return -1;
+}
+
+/* pipe_read
+ *
+ * DESCRIPTION: sleeps until there is data, then copies out whatever is there
+ * INPUT/OUTPUT: returns bytes read, 0 once the pipe is empty and every writer
+ *               has closed, -1 if it is empty and nonblock is set or a
+ *               signal came first
+ * SIDE EFFECTS: wakes blocked writers
+ */
+static int32_t pipe_read(pipe_t* p, uint8_t* buf, int32_t nbytes, int32_t nonblock){
+    int32_t first;
+    uint32_t flags;
+
+    if(nbytes <= 0)
+        return 0;
+
+    cli_and_save(flags);
+    while(p->count == 0){
+        if(p->writers == 0){
+            restore_flags(flags);
+            return 0;
+        }
+        if(nonblock || signal_pending(curr_pcb)){
+            restore_flags(flags);
+            return -1;
+        }
+        sleep_on((uint32_t)&p->readers);
+    }
+
+    if(nbytes > p->count)
+        nbytes = p->count;
+    //data may wrap around the end of the ring
+    first = p->size - p->head;
+    if(first > nbytes)
+        first = nbytes;
+    memcpy(buf,p->buf + p->head,first);
+    memcpy(buf + first,p->buf,nbytes - first);
+    p->head = (p->head + nbytes) % p->size;
+    p->count -= nbytes;
+
+    wake_up((uint32_t)&p->writers);
+    poll_wake();
+    restore_flags(flags);
+    return nbytes;
+}
+
+/* pipe_write
+ *
+ * DESCRIPTION: copies all of buf in, sleeping whenever the pipe is full
+ * INPUT/OUTPUT: returns bytes written, -1 if nothing could be written because
+ *               every reader has closed, or because the pipe is full and
+ *               nonblock is set or a signal came first
+ * SIDE EFFECTS: wakes blocked readers after each chunk
+ */
+static int32_t pipe_write(pipe_t* p, const uint8_t* buf, int32_t nbytes, int32_t nonblock){
+    int32_t done = 0;
+    int32_t n, tail, first;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    while(done < nbytes){
+        if(p->readers == 0){
+            restore_flags(flags);
+            return done ? done : -1;
+        }
+        if(p->count == p->size){
+            if(nonblock || signal_pending(curr_pcb)){
+                restore_flags(flags);
+                return done ? done : -1;
+            }
+            sleep_on((uint32_t)&p->writers);
+            continue;
+        }
+
+        //fill as much of the free space as we can in one go
+        n = p->size - p->count;
+        if(n > nbytes - done)
+            n = nbytes - done;
+        tail = (p->head + p->count) % p->size;
+        first = p->size - tail;
+        if(first > n)
+            first = n;
+        memcpy(p->buf + tail,buf + done,first);
+        memcpy(p->buf,buf + done + first,n - first);
+        p->count += n;
+        done += n;
+        wake_up((uint32_t)&p->readers);
+        poll_wake();
+    }
+
+    restore_flags(flags);
+    return done;
+}
+
+/* pipe_close
+ *
+ * DESCRIPTION: drops one reference to an end, the other side is woken so it
+ *              can see EOF or a broken pipe
+ * INPUT/OUTPUT: returns 0
+ * SIDE EFFECTS: none
+ */
+static int32_t pipe_close(pipe_t* p, int32_t end){
+    uint32_t flags;
+    cli_and_save(flags);
+
+    if(end == PIPE_READ_END){
+        p->readers--;
+        wake_up((uint32_t)&p->writers);
+    }
+    else{
+        p->writers--;
+        wake_up((uint32_t)&p->readers);
+    }
+    poll_wake();
+
+    restore_flags(flags);
+    return 0;
+}
+
+/* pipe_poll
+ *
+ * DESCRIPTION: readiness of one end, a read end with no writers left is
+ *              readable since read returns EOF right away
+ * INPUT/OUTPUT: returns POLLIN, POLLOUT or 0
+ * SIDE EFFECTS: none
+ */
+static int32_t pipe_poll(pipe_t* p, int32_t end){
+    if(end == PIPE_READ_END)
+        return (p->count > 0 || p->writers == 0) ? POLLIN : 0;
+    return (p->count < p->size || p->readers == 0) ? POLLOUT : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "types.h"
+#include "lib.h"
+#include "sys_handlers.h"
+
+#define MAX_PIPES 8
+#define PIPE_BUF_MAX 4096
+#define PIPE_READ_END 0
+#define PIPE_WRITE_END 1
+
+typedef struct pipe{
+    uint8_t buf[PIPE_BUF_MAX];
+    int32_t size;
+    int32_t head;
+    int32_t count;
+    int32_t readers;
+    int32_t writers;
+}pipe_t;
+
+void pipe_init(void);
+int32_t pipe_create(int32_t size);
+void pipe_ref(int32_t pipe_num, int32_t end);
+int32_t pipe_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes);
+
+#endif
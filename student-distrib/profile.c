@@ -0,0 +1,150 @@
+//statistical profiler. While it runs the pit also fires at the sampling
+//rate and every sample keeps the eip the interrupt stopped, user or kernel.
+//Stopping it writes the samples to the serial port, profsym.sh turns them
+//into a flat profile against bootimg and the program binaries.
+#include "profile.h"
+#include "schedule.h"
+#include "softirq.h"
+#include "clock.h"
+#include "kmem.h"
+#include "serial.h"
+
+uint64_t prof_due;
+
+static prof_sample_t* prof_buf;
+static uint32_t prof_count;
+static uint32_t prof_dropped;
+static uint32_t prof_period;
+static uint32_t prof_hz;
+//a run was started and not written out yet
+static int32_t prof_busy;
+
+static void prof_write(void);
+
+/* prof_tick
+ *
+ * DESCRIPTION: called by the pit handler with interrupts off once prof_due
+ *              has passed, takes one sample of the interrupted code. A late
+ *              tick still takes only one, the missed ones are skipped.
+ * INPUT/OUTPUT: uint64_t now - clock_ns() time of the interrupt
+ * SIDE EFFECTS: none
+ */
+void prof_tick(uint64_t now){
+    hw_context_t* ctx = irq_regs;
+    prof_sample_t* s;
+
+    do{
+        prof_due += prof_period;
+    }while(prof_due <= now);
+
+    if(prof_count >= PROF_SAMPLES){
+        prof_dropped++;
+        return;
+    }
+    s = &prof_buf[prof_count++];
+    s->eip = ctx->eip;
+    if(ctx->cs == USER_CS)
+        memcpy(s->name, curr_pcb->leader->name, PROG_NAME);
+    else
+        s->name[0] = '\0';
+}
+
+/* profile
+ *
+ * DESCRIPTION: hz starts a run sampling hz times a second, PROF_STOP ends
+ *              it and writes the samples to the serial port. With
+ *              nohz=off the pit only fires every 10ms, faster rates take at
+ *              most one sample a tick.
+ * INPUT/OUTPUT: uint32_t hz - PROF_MIN_HZ to PROF_MAX_HZ or PROF_STOP
+ *               returns 0 once started, the number of samples written once
+ *               stopped, -1 for a bad rate, when starting a second run or
+ *               stopping none, or if the buffer can't be had
+ * SIDE EFFECTS: stopping busy waits on the serial port
+ */
+int32_t profile(uint32_t hz){
+    uint32_t flags;
+    prof_sample_t* buf;
+    int32_t count;
+
+    if(hz == PROF_STOP){
+        cli_and_save(flags);
+        if(!prof_busy || prof_due == 0){
+            restore_flags(flags);
+            return -1;
+        }
+        prof_due = 0;
+        restore_flags(flags);
+
+        //nothing touches the buffer now
+        prof_write();
+        count = prof_count;
+        kfree(prof_buf, PROF_SAMPLES * sizeof(prof_sample_t));
+        prof_busy = 0;
+        return count;
+    }
+
+    if(hz < PROF_MIN_HZ || hz > PROF_MAX_HZ)
+        return -1;
+    cli_and_save(flags);
+    if(prof_busy){
+        restore_flags(flags);
+        return -1;
+    }
+    prof_busy = 1;
+    restore_flags(flags);
+
+    buf = kmalloc(PROF_SAMPLES * sizeof(prof_sample_t));
+    if(buf == NULL){
+        prof_busy = 0;
+        return -1;
+    }
+
+    cli_and_save(flags);
+    prof_buf = buf;
+    prof_count = 0;
+    prof_dropped = 0;
+    prof_hz = hz;
+    prof_period = NS_PER_SEC / hz;
+    prof_due = clock_ns() + prof_period;
+    tick_program();
+    restore_flags(flags);
+    return 0;
+}
+
+/* prof_write
+ *
+ * DESCRIPTION: writes the run to the serial port, a header, a line a
+ *              sample and an end marker:
+ *                  profile hz <hz> samples <n> dropped <d>
+ *                  k <eip>
+ *                  u <eip> <program>
+ *                  profile end
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: busy waits on the serial port
+ */
+static void prof_write(void){
+    int8_t num[PROF_DIGITS];
+    uint32_t i;
+
+    serial_puts("profile hz ");
+    serial_puts(itoa(prof_hz, num, 10));
+    serial_puts(" samples ");
+    serial_puts(itoa(prof_count, num, 10));
+    serial_puts(" dropped ");
+    serial_puts(itoa(prof_dropped, num, 10));
+    serial_putc('\n');
+
+    for(i = 0; i < prof_count; i++){
+        if(prof_buf[i].name[0] == '\0'){
+            serial_puts("k ");
+            serial_hex(prof_buf[i].eip);
+        }else{
+            serial_puts("u ");
+            serial_hex(prof_buf[i].eip);
+            serial_putc(' ');
+            serial_puts(prof_buf[i].name);
+        }
+        serial_putc('\n');
+    }
+    serial_puts("profile end\n");
+}
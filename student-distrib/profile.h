@@ -0,0 +1,29 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+#include "sys_handlers.h"
+
+//samples one run keeps, the ones after that are only counted
+#define PROF_SAMPLES 8192
+//sampling rates profile accepts, in Hz
+#define PROF_MIN_HZ 10
+#define PROF_MAX_HZ 10000
+//profile argument that stops the run and writes it out
+#define PROF_STOP 0
+//a decimal word and its null
+#define PROF_DIGITS 11
+
+typedef struct prof_sample{
+    uint32_t eip;
+    //program that was running in user space, empty for the kernel
+    int8_t name[PROG_NAME];
+}prof_sample_t;
+
+//clock_ns() time the next sample is due, 0 while not profiling
+extern uint64_t prof_due;
+
+void prof_tick(uint64_t now);
+int32_t profile(uint32_t hz);
+
+#endif
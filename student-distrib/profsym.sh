@@ -0,0 +1,67 @@
+#!/bin/sh
+# Turns a profile the kernel wrote to the serial port into a flat profile,
+# hottest functions first. Kernel samples are looked up in bootimg, samples
+# taken in a program in syscalls/<name>.exe or fish/<name>.exe.
+#
+# usage: ./profsym.sh <serial log> [functions to show]
+#   run qemu with -serial file:prof.log, then "prof 1000 <command>" in the
+#   os, then ./profsym.sh prof.log
+
+if [ $# -lt 1 ]; then
+echo "usage: $0 <serial log> [functions to show]"
+exit 1
+fi
+
+LOG=$1
+TOP=${2:-30}
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf $TMP' EXIT
+
+# only the last run in the log, one address file per binary
+awk -v tmp="$TMP" '
+{ sub(/\r$/, "") }
+$1 == "profile" && $2 == "hz" { run++; next }
+$1 == "k" { print run, $2 > (tmp "/samples") }
+$1 == "u" { print run, $2, $3 > (tmp "/samples") }
+END { print run > (tmp "/runs") }
+' "$LOG"
+if [ ! -s $TMP/samples ]; then
+echo "no samples in $LOG"
+exit 1
+fi
+awk -v last=$(cat $TMP/runs) -v tmp="$TMP" '
+$1 == last { print $2 > (tmp "/addr." (NF == 3 ? $3 : "kernel")) }
+' $TMP/samples
+TOTAL=$(cat $TMP/addr.* | wc -l)
+
+# addresses are 8 hex digits like nm prints them, so they sort and compare
+# as strings, the x keeps awk from reading one like 004e1234 as a number.
+# Each sample goes to the closest function at or below it.
+for f in $TMP/addr.*; do
+name=${f##*/addr.}
+if [ $name = kernel ]; then
+bin=$DIR/bootimg
+elif [ -f $DIR/../syscalls/$name.exe ]; then
+bin=$DIR/../syscalls/$name.exe
+else
+bin=$DIR/../$name/$name.exe
+fi
+if [ ! -f $bin ]; then
+sed "s/.*/$name:?/" $f
+continue
+fi
+LC_ALL=C nm -n $bin | awk '$2 ~ /^[tTwW]$/ { print $1, $3 }' > $TMP/syms
+LC_ALL=C sort $f | awk -v name=$name '
+NR == FNR { addr[n] = "x" $1; sym[n++] = $2; next }
+{
+    while (i < n && addr[i] <= "x" $1)
+        i++
+    print name ":" (i > 0 ? sym[i - 1] : "?")
+}
+' $TMP/syms -
+done | sort | uniq -c | sort -rn | head -n $TOP |
+awk -v total=$TOTAL '
+BEGIN { printf "%d samples\n", total }
+{ printf "%7d %5.1f%%  %s\n", $1, 100 * $1 / total, $2 }
+'
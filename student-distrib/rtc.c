@@ -1,33 +1,53 @@
 #include "rtc.h"
+#include "signal.h"
 
 uint8_t cur_val;
 uint8_t disp_handler;
 
+//the hardware always runs at RTC_HW_HZ, every rtc fd has its own virtual
+//rate in rtc_divider and rtc_due
+
+//interrupts since boot
+static volatile uint32_t rtc_ticks;
+
+//earliest tick a reader or poller waits for, the handler only wakes them
+//then instead of on every interrupt
+static uint32_t rtc_next_wake;
+static int32_t rtc_wake_pending;
+
+//test_rtc prints every disp_divider interrupts
+static int32_t disp_divider;
+
+//open rtc fds, the periodic interrupt only runs while there are any
+static int32_t rtc_users;
+
+static int32_t rtc_divider(int32_t freq);
+static void rtc_wake_at(uint32_t due);
+static void rtc_periodic(int32_t on);
+
 /* rtc_init
  *
- * DESCRIPTION: Initializes RTC and enables its respective IRQ on the PIC
- *              Enables bit 6 in status register b to turn on periodic interrupts
+ * DESCRIPTION: Initializes RTC and enables its respective IRQ on the PIC.
+ *              Periodic interrupts stay off until the first rtc fd opens.
  *
  * INPUT/OUTPUT: none
- * SIDE EFFECTS: Rewrites few bits in status registers A and B to enable periodic interrupts and set rate
+ * SIDE EFFECTS: Rewrites few bits in status register A to set rate
  */
 void rtc_init(void) {
   uint32_t flags;
   cli_and_save(flags);
 
-  outb(STAT_REG_B, RTC_PORT);             // Select status register B and disable NMI
-  cur_val = inb(RW_CMOS);                 // load cur_val with value in status register B
-  outb(STAT_REG_B, RTC_PORT);             // reset the index back into RTC_PORT
-  outb(cur_val | ENABLE_BIT_SIX, RW_CMOS);  // "OR" current value with 0x40 and write into CMOS port
-
   /* need to figure out how to change rate, am working on that */
   outb(STAT_REG_A, RTC_PORT);             // Select status register A and disable NMI
   cur_val = inb(RW_CMOS);                 // load cur_val with value in status register A
   outb(STAT_REG_A, RTC_PORT);             // reset the index back into RTC_PORT
   outb((cur_val & PORTANDER) | RATE, RW_CMOS);
 
-  int_flag = 0;
   disp_handler = 0;
+  disp_divider = 1;
+  rtc_ticks = 0;
+  rtc_wake_pending = 0;
+  rtc_users = 0;
 
   enable_irq(RTC_IRQ_NUM);                // enable on PIC
 
@@ -40,7 +60,9 @@ void rtc_init(void) {
  *              is called by IDT and handles RTC interrupts
  *
  * INPUT/OUTPUT: none
- * SIDE EFFECTS: Clears content in register C to enable new interrupts. Send EOI to PIC
+ * SIDE EFFECTS: Clears content in register C to enable new interrupts. Send EOI to PIC.
+ *               Wakes rtc readers and pollers once the earliest tick one of
+ *               them waits for is due.
  */
 void rtc_handler() {
 
@@ -48,95 +70,201 @@ void rtc_handler() {
   outb(STAT_REG_C,RTC_PORT);
   inb(RW_CMOS);
 
-  if(disp_handler) putc('1');
-  if(int_flag == 0)
-    int_flag = 1;
-  else
-    int_flag = 0;
+  rtc_ticks++;
+  if(disp_handler && rtc_ticks % disp_divider == 0) putc('1');
+
+  if(rtc_wake_pending && (int32_t)(rtc_ticks - rtc_next_wake) >= 0){
+    rtc_wake_pending = 0;
+    wake_up((uint32_t)&rtc_ticks);
+    poll_wake();
+  }
   send_eoi(RTC_IRQ_NUM);
 
 }
 
+/* rtc_wake_at
+ *
+ * DESCRIPTION: asks the handler for a wake up at interrupt count due, called
+ *              with interrupts off before sleeping or polling
+ *
+ * INPUT/OUTPUT: input - interrupt count
+ * SIDE EFFECTS: none
+ */
+static void rtc_wake_at(uint32_t due)
+{
+    if(!rtc_wake_pending || (int32_t)(due - rtc_next_wake) < 0){
+        rtc_next_wake = due;
+        rtc_wake_pending = 1;
+    }
+}
+
+/* rtc_periodic
+ *
+ * DESCRIPTION: turns the periodic interrupt on or off through bit 6 of
+ *              status register b
+ *
+ * INPUT/OUTPUT: input - 1 for on
+ * SIDE EFFECTS: none
+ */
+static void rtc_periodic(int32_t on)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+
+    outb(STAT_REG_B, RTC_PORT);
+    cur_val = inb(RW_CMOS);
+    outb(STAT_REG_B, RTC_PORT);
+    if(on)
+        outb(cur_val | ENABLE_BIT_SIX, RW_CMOS);
+    else
+        outb(cur_val & ~ENABLE_BIT_SIX, RW_CMOS);
+
+    restore_flags(flags);
+}
+
+/* rtc_ref
+ *
+ * DESCRIPTION: one more open rtc fd, the first starts the interrupt. Also
+ *              called when an fd entry is copied.
+ *
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: may enable periodic interrupts
+ */
+void rtc_ref(void)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+    if(rtc_users++ == 0)
+        rtc_periodic(1);
+    restore_flags(flags);
+}
+
 /* open_rtc
  *
  * DESCRIPTION: Opens RTC driver
  *
- * INPUT/OUTPUT: input - filename
+ * INPUT/OUTPUT: input - file descriptor
                  output - return 0
- * SIDE EFFECTS: Sets frequency to 2Hz
+ * SIDE EFFECTS: Sets the fd's frequency to 2Hz
  */
-int32_t open_rtc()
+int32_t open_rtc(uint32_t fd)
 {
-    // Set frequency to 2Hz
-    set_freq(HZ2);
+    file_descriptor_structure_t* file = &curr_pcb->fd_table[fd];
+
+    // Set frequency to 2Hz, first tick one period from now
+    file->rtc_divider = rtc_divider(HZ2);
+    file->rtc_due = rtc_ticks + file->rtc_divider;
+    rtc_ref();
 
     return 0;
 }
 
 /* read_rtc
  *
- * DESCRIPTION: Waits until interrupt is finished before resetting flag
+ * DESCRIPTION: Sleeps until the fd's next tick. A reader that comes late
+ *              skips the ticks it missed, like it would on the hardware, so
+ *              ticks stay on the fd's own grid.
  *
  * INPUT/OUTPUT: inputs - file descriptor
-                          buffer
-                          number of bytes to be read
-                 outputs - return 0
- * SIDE EFFECTS: Sets interrupt flag
+                 outputs - return 0, -1 if the fd is O_NONBLOCK and its next
+                           tick isn't due yet or a signal came first
+ * SIDE EFFECTS: none
  */
-int32_t read_rtc()
+int32_t read_rtc(uint32_t fd)
 {
-    //Create local flag variable to check for changes in global
-    uint8_t local_flag = int_flag;
+    uint32_t flags;
+    file_descriptor_structure_t* file = &curr_pcb->fd_table[fd];
 
-    // Wait for interrupts to be finished
-    while(local_flag == int_flag)
+    cli_and_save(flags);
+    while((int32_t)(rtc_ticks - file->rtc_due) < 0)
     {
-        //wait for interrupt handler to finish
+        if((file->mode & O_NONBLOCK) || signal_pending(curr_pcb)){
+            restore_flags(flags);
+            return -1;
+        }
+        rtc_wake_at(file->rtc_due);
+        sleep_on((uint32_t)&rtc_ticks);
     }
+    file->rtc_due += ((rtc_ticks - file->rtc_due) / file->rtc_divider + 1) * file->rtc_divider;
+    restore_flags(flags);
 
     return 0;
 }
 
+/* poll_rtc
+ *
+ * DESCRIPTION: readable once the fd's next tick is due
+ *
+ * INPUT/OUTPUT: inputs - file descriptor
+                 outputs - POLLIN or 0
+ * SIDE EFFECTS: a poller that has to wait gets woken at the tick
+ */
+int32_t poll_rtc(uint32_t fd)
+{
+    uint32_t flags;
+    file_descriptor_structure_t* file = &curr_pcb->fd_table[fd];
+    int32_t ready;
+
+    cli_and_save(flags);
+    ready = (int32_t)(rtc_ticks - file->rtc_due) >= 0;
+    if(!ready)
+        rtc_wake_at(file->rtc_due);
+    restore_flags(flags);
+
+    return ready ? POLLIN : 0;
+}
+
 /* write_rtc
  *
- * DESCRIPTION: Sets the frequency of the RTC
+ * DESCRIPTION: Sets the frequency of an rtc fd, other fds keep theirs
  *
  * INPUT/OUTPUT: inputs - file descriptor
                           buffer
-                          number of bytes to be read
-                 outputs - return -1 if write can't be performed
-                           return number of bytes if write is successful
- * SIDE EFFECTS: Sets frequency
+                          nbytes - has to be 4
+                 outputs - return -1 if write can't be performed, nbytes
+                           isn't 4 or the frequency isn't a power of 2
+                           from 2 to 1024
+                           return 0 if write is successful
+ * SIDE EFFECTS: the fd's next tick is one new period from now
  */
-int32_t write_rtc(const int32_t* buf)
+int32_t write_rtc(uint32_t fd, const int32_t* buf, int32_t nbytes)
 {
-    int32_t write_freq;
+    uint32_t flags;
+    file_descriptor_structure_t* file = &curr_pcb->fd_table[fd];
+    int32_t divider;
 
     // If number of bytes is not 4 or buffer is null, return -1
-    if(buf == NULL)
+    if(buf == NULL || nbytes != BYTE4)
         return -1;
 
-    write_freq = *(buf);
+    divider = rtc_divider(*buf);
+    if(divider == -1)
+        return -1;
 
-    // Set the frequency
-    set_freq(write_freq);
+    cli_and_save(flags);
+    file->rtc_divider = divider;
+    file->rtc_due = rtc_ticks + divider;
+    restore_flags(flags);
 
     return 0;
 }
 
 /* close_rtc
  *
- * DESCRIPTION: RTC frequency gets reset
+ * DESCRIPTION: Closes RTC driver, the hardware rate stays the same
  *
  * INPUT/OUTPUT: input - file descriptor
                  output - return 0
- * SIDE EFFECTS: None
+ * SIDE EFFECTS: the last close stops the periodic interrupt, an idle
+ *               machine gets no rtc interrupts
  */
 int32_t close_rtc()
 {
-    // Set frequency to 2Hz
-    set_freq(HZ2);
-
+    uint32_t flags;
+    cli_and_save(flags);
+    if(--rtc_users == 0)
+        rtc_periodic(0);
+    restore_flags(flags);
     return 0;
 }
 
@@ -151,86 +279,38 @@ int32_t close_rtc()
  */
 int32_t rtc_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes){
     if(cmd == OPEN){
-        return open_rtc();
+        return open_rtc(fd);
     }
     else if(cmd == READ){
-        return read_rtc();
+        return read_rtc(fd);
     }
     else if(cmd == WRITE){
-        return write_rtc((const int32_t*)buf);
+        return write_rtc(fd,(const int32_t*)buf,(int32_t)nbytes);
     }
     else if(cmd == CLOSE){
         return close_rtc();
     }
+    else if(cmd == POLL){
+        return poll_rtc(fd);
+    }
     return -1;
 }
 
 
-/* set_freq
+/* rtc_divider
  *
- * DESCRIPTION: Changes the frequency of RTC
+ * DESCRIPTION: How many hardware interrupts make one tick at a frequency
  *
- * INPUT/OUTPUT: input - new frequency
- * SIDE EFFECTS: Sets frequency, however is clipped at 1024 Hz
+ * INPUT/OUTPUT: input - frequency in Hz
+                 output - RTC_HW_HZ / freq, -1 unless freq is a power of 2
+                          from 2 to 1024
+ * SIDE EFFECTS: None
  */
-void set_freq(int32_t freq)
+static int32_t rtc_divider(int32_t freq)
 {
-    uint8_t new_freq, old_freq;
-
-    // Save old frequency value
-    outb(STAT_REG_A, RTC_PORT);
-    old_freq = inb(RW_CMOS);
-
-    // Using the new rate, determine which register A code needs to be used
-    switch(freq)
-    {
-        case HZ2:
-            new_freq = FREQ2;
-            break;
-
-        case HZ4:
-            new_freq = FREQ4;
-            break;
-
-        case HZ8:
-            new_freq = FREQ8;
-            break;
-
-        case HZ16:
-            new_freq = FREQ16;
-            break;
-
-        case HZ32:
-            new_freq = FREQ32;
-            break;
-
-        case HZ64:
-            new_freq = FREQ64;
-            break;
-
-        case HZ128:
-            new_freq = FREQ128;
-            break;
-
-        case HZ256:
-            new_freq = FREQ256;
-            break;
-
-        case HZ512:
-            new_freq = FREQ512;
-            break;
-
-        case HZ1024:
-            new_freq = FREQ1024;
-            break;
-
-        default:
-            return;
-    }
-
-    // Write the new frequency to the appropriate port
-    outb(STAT_REG_A, RTC_PORT);
-    outb((old_freq & PORTANDER) | new_freq, RW_CMOS);
+    if(freq < HZ2 || freq > RTC_HW_HZ || (freq & (freq - 1)) != 0)
+        return -1;
+    return RTC_HW_HZ / freq;
 }
 
 /* test_rtc
@@ -244,14 +324,16 @@ void test_rtc(){
     int i,key;
     int freq[10] = {2,4,8,16,32,64,128,256,512,1024}; // Test each frequency value
     disp_handler = 1;
+    rtc_ref();
     clear();
     resetCursor();
     // Test each frequency using enter button as progression to next frequency
     for(i = 0; i < 10; i++){
         key = get_buf_idx();
-        write_rtc(&freq[i]);
+        disp_divider = rtc_divider(freq[i]);
         while(key == get_buf_idx());
         bksp_handler();
     }
+    close_rtc();
     disp_handler = 0;
 }
@@ -16,7 +16,6 @@
 #define STAT_REG_C  0x8C
 #define ENABLE_BIT_SIX  0x40
 #define RTC_IRQ_NUM 8
-#define RATE 14
 #define PORTANDER 0xF0
 #define BYTE4 4
 #define HZ2 2
@@ -29,30 +28,23 @@
 #define HZ256 256
 #define HZ512 512
 #define HZ1024 1024
-#define FREQ2 0x0F
-#define FREQ4 0x0E
-#define FREQ8 0x0D
-#define FREQ16 0x0C
-#define FREQ32 0x0B
-#define FREQ64 0x0A
-#define FREQ128 0x09
-#define FREQ256 0x08
-#define FREQ512 0x07
 #define FREQ1024 0x06
+//rate the hardware always runs at, fds divide it down
+#define RTC_HW_HZ HZ1024
+#define RATE FREQ1024
 
 extern void rtc_init(void);
 extern void rtc_handler();
 
-uint8_t int_flag;
-
-int32_t open_rtc();
-int32_t read_rtc();
-int32_t write_rtc(const int32_t* buf);
+void rtc_ref(void);
+int32_t open_rtc(uint32_t fd);
+int32_t read_rtc(uint32_t fd);
+int32_t poll_rtc(uint32_t fd);
+int32_t write_rtc(uint32_t fd, const int32_t* buf, int32_t nbytes);
 int32_t close_rtc();
 
 
 int32_t rtc_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes);
-void set_freq(int32_t freq);
 
 
 void test_rtc();
@@ -1,13 +1,53 @@
 //this is for code for scheduler
 #include "schedule.h"
+#include "shm.h"
+#include "signal.h"
+#include "softirq.h"
+#include "lathist.h"
+#include "profile.h"
+#include "trace.h"
 
-uint32_t sched_vid_backups[] = {BACKUP0,BACKUP1,BACKUP2};
+//set while schedule() is waiting for a task to become runnable
+static volatile int32_t idling;
+
+//tasks sleeping in poll, they share one wait channel
+static int32_t poll_waiters;
+
+volatile uint32_t pit_ticks;
+uint32_t pit_stamp;
+int32_t nohz = 1;
+uint64_t idle_cycles;
+int32_t need_resched;
+uint32_t rt_util;
+
+//clock_ns() time the one-shot pit fires at, 0 once it fired
+static uint64_t tick_due;
+//the pit fires earlier than tick_due, for a profiling sample
+static int32_t tick_prof;
+//the programmed event is no time slice, a task that wakes has to bring the
+//next one in
+static int32_t tick_long;
+
+//ticks don't switch tasks while this is nonzero
+static volatile int32_t preempt_count;
+
+static int32_t pick_next(void);
+static void switch_to(process_control_block_t* next);
+static void pit_oneshot(uint64_t due, uint64_t now);
+static void tick_arm(uint64_t now);
+static void rt_release(process_control_block_t* pcb, uint64_t now);
+static void rt_charge(process_control_block_t* pcb, uint64_t now);
+static void rt_job_done(process_control_block_t* pcb);
+static void rt_expired(uint32_t data);
+static uint32_t rt_ppm(uint32_t period_us, uint32_t budget_us);
+static void tick_softirq(void);
 
 /*pit_init
 * input - none
 * outpt - none
 * side effects - enables pit interrpts on PIC
-* description - initializes PIT for scheduler
+* description - initializes PIT for scheduler, with nohz the first tick is
+*               a one-shot and every interrupt programs the next
 */
 void pit_init(void)
 {
@@ -19,7 +59,7 @@ void pit_init(void)
 
     int32_t i;
 
-    outb(PIT_MODE_3, MODE_COMMAND_REG);
+    outb(nohz ? PIT_ONESHOT : PIT_MODE_3, MODE_COMMAND_REG);
     outb(DIV_100HZ & MASK_FREQ, PIT_0_DATA_PORT);
     outb(DIV_100HZ >> 8, PIT_0_DATA_PORT);
 
@@ -27,115 +67,679 @@ void pit_init(void)
     enable_irq(PIT_IRQ_NUM);
     for(i = 0; i < SCHED_SIZE; i++){
         schedule_arr[i] = NULL;
-        new_process[i] = 1;
     }
 
     curr = 0;
+    idling = 0;
+    poll_waiters = 0;
+    pit_ticks = 0;
+    preempt_count = 0;
+    idle_cycles = 0;
+    tick_due = 0;
+    tick_prof = 0;
+    tick_long = 0;
+    need_resched = 0;
+    rt_util = 0;
+    open_softirq(TIMER_SOFTIRQ, tick_softirq);
 }
 
 
 /*pit_handler
 * input - none
 * outpt - none
-* side effects - context switch to next scheduled process
-* description - is used to implement round robin scheduling
+* side effects - asks for a context switch to the next scheduled process
+* description - is used to implement round robin scheduling, the switch
+*               happens in irq_exit. The due timers run in the timer
+*               softirq, which also programs the next interrupt. Until it
+*               does, a one-shot one time slice away keeps the pit going.
+*               An interrupt that only came for a profiling sample takes it
+*               and leaves the time slice and the timers alone.
 */
 void pit_handler()
 {
+    uint64_t now;
+
+    asm volatile("rdtsc" : "=a"(pit_stamp) : : "edx");
+
     send_eoi(PIT_IRQ_NUM);
-    if(!setup)
+    pit_ticks++;
+    now = clock_ns();
+    if(setup && schedule_arr[curr_pcb->slot] == curr_pcb)
+        rt_charge(curr_pcb, now);
+    if(prof_due && now >= prof_due)
+        prof_tick(now);
+    if(nohz){
+        if(tick_prof && now < tick_due){
+            tick_arm(now);
+            return;
+        }
+        tick_due = now + TICK_NS;
+        tick_arm(now);
+    }
+    raise_softirq(TIMER_SOFTIRQ);
+    if(setup)
+        need_resched = 1;
+}
+
+/*preempt_disable / preempt_enable
+* input - none
+* outpt - none
+* side effects - none
+* description - keeps the timer from switching away from code that runs with
+*               interrupts on but must finish on the task it started on,
+*               calls nest
+*/
+void preempt_disable(void)
+{
+    preempt_count++;
+}
+
+void preempt_enable(void)
+{
+    preempt_count--;
+}
+
+/*preempt_check
+* input - none
+* outpt - none
+* side effects - may return on another task's stack much later
+* description - called on the way out of every interrupt, switches tasks if
+*               a tick or a wake up asked for it and the interrupted code can
+*               be preempted
+*/
+void preempt_check(void)
+{
+    if(need_resched && setup && !preempt_count)
+        schedule();
+}
+
+/*schedule
+* input - none
+* outpt - none
+* side effects - may return on another task's stack much later
+* description - round robin over schedule_arr, every non NULL entry is a
+*               runnable task. If nothing can run, halts with interrupts on
+*               until an interrupt handler wakes a task.
+*/
+void schedule(void)
+{
+    uint32_t flags;
+    int32_t next;
+    uint64_t begin;
+    cli_and_save(flags);
+
+    //an idle loop further down this stack picks up any change itself
+    if(idling){
+        restore_flags(flags);
         return;
- //   uint32_t flags;
-  //  cli_and_save(flags);
+    }
+    next = pick_next();
+    while(next == -1){
+        idling = 1;
+        tick_program();
+        begin = rdtsc64();
+        TRACE_IRQS_ON();
+        asm volatile(
+            "sti \n \
+            hlt \n \
+            cli"
+        );
+        TRACE_IRQS_OFF();
+        idle_cycles += rdtsc64() - begin;
+        idling = 0;
+        next = pick_next();
+    }
+    need_resched = 0;
 
-    //move to next process
-    int32_t last = curr;
-    int32_t i;
-    for(i = 0; i < SCHED_SIZE; i++){
-        curr = (curr+1) % SCHED_SIZE;
-        if(schedule_arr[curr])
-            break;
+    if(schedule_arr[next] != curr_pcb)
+        switch_to(schedule_arr[next]);
+
+    restore_flags(flags);
+}
+
+/*task_block
+* input - none
+* outpt - none
+* side effects - takes the current task off the run table
+* description - sleeps the current task until task_wake is called on it.
+*               Callers disable interrupts before testing their wait condition
+*               so a wake up can't be lost in between.
+*/
+void task_block(void)
+{
+    uint32_t flags;
+    process_control_block_t* pcb = curr_pcb;
+    cli_and_save(flags);
+
+    rt_job_done(pcb);
+    schedule_arr[pcb->slot] = NULL;
+    schedule();
+
+    restore_flags(flags);
+}
+
+/*task_wake
+* input - pcb of a blocked task
+* outpt - none
+* side effects - puts the task back on the run table
+* description - counterpart of task_block, safe to call from interrupts. A
+*               real-time task starts a new job and preempts the current
+*               task if its deadline comes first.
+*/
+void task_wake(process_control_block_t* pcb)
+{
+    process_control_block_t* cur = curr_pcb;
+
+    if(pcb->rt_period && schedule_arr[pcb->slot] == NULL){
+        rt_release(pcb, clock_ns());
+        if(pcb != cur && (!cur->rt_period || cur->rt_throttled || pcb->rt_deadline < cur->rt_deadline))
+            need_resched = 1;
     }
+    schedule_arr[pcb->slot] = pcb;
+    if(tick_long)
+        tick_program();
+}
 
-    /*if(new_process[curr]){
-        new_process[curr] = 0;
-        return;
-    }*/
-    //no processes to schedule or nothing to update
-    if(last == curr || !schedule_arr[curr]){
+/*rt_set
+* input - task, period and budget in us, a 0 period makes it a normal task
+* outpt - 0, -1 for a bad period or budget or if admitting it would reserve
+*         more than RT_MAX_UTIL of the cpu
+* side effects - starts the task's first job now
+* description - puts a task in the real-time class. Runnable real-time tasks
+*               within their budget always run before normal ones, earliest
+*               deadline first, and every period is a job that is due by the
+*               end of the period. Admitting only what fits in RT_MAX_UTIL
+*               makes every job meet its deadline as long as it stays within
+*               its budget. A job over budget runs like a normal task until
+*               its period ends.
+*/
+int32_t rt_set(process_control_block_t* pcb, uint32_t period_us, uint32_t budget_us)
+{
+    uint32_t flags;
+    uint32_t util = 0, old = 0;
+
+    if(period_us){
+        if(period_us < RT_MIN_PERIOD || period_us > RT_MAX_PERIOD)
+            return -1;
+        if(budget_us == 0 || budget_us > period_us)
+            return -1;
+        util = rt_ppm(period_us, budget_us);
+    }
+
+    cli_and_save(flags);
+    if(pcb->rt_period)
+        old = rt_ppm(pcb->rt_period / NS_PER_US, pcb->rt_budget / NS_PER_US);
+    if(rt_util - old + util > RT_MAX_UTIL){
+        restore_flags(flags);
+        return -1;
+    }
+    rt_util = rt_util - old + util;
+
+    timer_cancel(&pcb->rt_timer);
+    pcb->rt_period = period_us * NS_PER_US;
+    pcb->rt_budget = budget_us * NS_PER_US;
+    pcb->rt_jobs = 0;
+    pcb->rt_misses = 0;
+    pcb->rt_deadline = 0;
+    if(period_us)
+        rt_release(pcb, clock_ns());
+
+    restore_flags(flags);
+    return 0;
+}
+
+/*tick_program
+* input - none
+* outpt - none
+* side effects - may reprogram the pit
+* description - with nohz the pit fires once, at the earliest of the next
+*               timer and, when more than one task can run or a vidmap screen
+*               is shown, the end of the time slice. With nothing else to do
+*               it only fires for timers, at least every PIT_MAX_NS since
+*               that is as far as it counts. Left alone if it already fires
+*               at or before that. A profiling sample due earlier brings it
+*               in for that.
+*/
+void tick_program(void)
+{
+    uint32_t flags;
+    uint64_t now, due, limit, left;
+    process_control_block_t* cur;
+    int32_t i, runnable = 0;
+
+    if(!nohz)
         return;
+    cli_and_save(flags);
+
+    for(i = 0; i < SCHED_SIZE; i++)
+        if(schedule_arr[i])
+            runnable++;
+    tick_long = runnable < 2 && !screen_mapped();
+
+    now = clock_ns();
+    limit = now + (tick_long ? PIT_MAX_NS : TICK_NS);
+    //a real-time task is taken off the cpu when its budget runs out
+    cur = curr_pcb;
+    if(cur->rt_period && !cur->rt_throttled && schedule_arr[cur->slot] == cur){
+        left = cur->rt_start + cur->rt_budget - cur->rt_used;
+        if(left < limit)
+            limit = left;
     }
-    /*
-    if(schedule_arr[curr]->proc_id == 0 || schedule_arr[curr]->proc_id == 4
-        || schedule_arr[curr]->proc_id == 8){
-            if(schedule_arr[curr]->proc_id/4 != curr_terminal)
-                return;
+    due = timer_next(limit);
+    if(tick_due == 0 || due < tick_due){
+        tick_due = due;
+        tick_arm(now);
+    }else if(prof_due && !tick_prof && prof_due < tick_due){
+        tick_arm(now);
+    }
+
+    restore_flags(flags);
+}
+
+/*tick_arm
+* input - clock_ns() now
+* outpt - none
+* side effects - reprograms the pit
+* description - fires the pit at tick_due or at the next profiling sample
+*               if that comes first, called with interrupts off
+*/
+static void tick_arm(uint64_t now)
+{
+    tick_prof = prof_due && prof_due < tick_due;
+    pit_oneshot(tick_prof ? prof_due : tick_due, now);
+}
+
+/*task_handoff
+* input - pcb of the task to run next
+* outpt - none
+* side effects - blocks the current task
+* description - direct switch for synchronous ipc, the partner is known so
+*               the cpu goes straight to it without a pass over
+*               schedule_arr. Blocks and wakes like task_block and task_wake
+*               do, and leaves the choice to schedule() when real-time tasks
+*               are admitted, since the partner need not be the earliest
+*               deadline.
+*/
+void task_handoff(process_control_block_t* next)
+{
+    uint32_t flags;
+    process_control_block_t* pcb = curr_pcb;
+    cli_and_save(flags);
+
+    rt_job_done(pcb);
+    schedule_arr[pcb->slot] = NULL;
+    task_wake(next);
+
+    if(rt_util || idling){
+        schedule();
+    }else{
+        need_resched = 0;
+        switch_to(next);
+    }
+
+    restore_flags(flags);
+}
+
+/*sleep_on
+* input - wait channel, any kernel address naming what is waited for
+* outpt - none
+* side effects - blocks the current task
+* description - callers hold interrupts off and recheck their condition after
+*               returning, a wake up only means the condition may have changed
+*/
+void sleep_on(uint32_t chan)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+
+    curr_pcb->wait_chan = chan;
+    task_block();
+
+    restore_flags(flags);
+}
+
+/*wake_up
+* input - wait channel
+* outpt - none
+* side effects - makes every task sleeping on chan runnable
+* description - counterpart of sleep_on, safe to call from interrupts
+*/
+void wake_up(uint32_t chan)
+{
+    int32_t i;
+    for(i = 0; i < MAX_TASKS; i++){
+        if(tasks->task[i].in_use == ON && tasks->task[i].proc.wait_chan == chan){
+            tasks->task[i].proc.wait_chan = 0;
+            task_wake(&tasks->task[i].proc);
         }
-        */
+    }
+}
+
+/*poll_sleep
+* input - none
+* outpt - none
+* side effects - blocks the current task
+* description - a poll found nothing ready, sleep until some driver's state
+*               changes or the next tick
+*/
+void poll_sleep(void)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+
+    poll_waiters++;
+    sleep_on((uint32_t)&poll_waiters);
+    poll_waiters--;
+
+    restore_flags(flags);
+}
+
+/*poll_wake
+* input - none
+* outpt - none
+* side effects - wakes every task in poll
+* description - drivers call this whenever an fd may have become ready,
+*               the pollers rescan their own fds
+*/
+void poll_wake(void)
+{
+    if(poll_waiters)
+        wake_up((uint32_t)&poll_waiters);
+}
+
+/*task_init_stack
+* input - pcb of a task that has never run, user eip and esp
+* outpt - none
+* side effects - writes to the task's kernel stack
+* description - builds the frame context_switch expects so that the first
+*               switch to this task "returns" into task_start, which irets
+*               to eip on user_esp
+*/
+void task_init_stack(process_control_block_t* pcb, uint32_t eip, uint32_t user_esp)
+{
+    uint32_t* sp = (uint32_t*)((uint32_t)pcb + STACK_SIZE4);
+
+    //iret context
+    *(--sp) = USER_DS;
+    *(--sp) = user_esp;
+    *(--sp) = EFLAGS_IF;
+    *(--sp) = USER_CS;
+    *(--sp) = eip;
+
+    //context_switch frame: ret, ebp, ebx, esi, edi, gs
+    *(--sp) = (uint32_t)task_start;
+    *(--sp) = 0;
+    *(--sp) = 0;
+    *(--sp) = 0;
+    *(--sp) = 0;
+    *(--sp) = 0;
+
+    pcb->sched_esp = (int32_t)sp;
+}
+
+/*task_init_kstack
+* input - pcb of a kernel thread that has never run, function it runs
+* outpt - none
+* side effects - writes to the thread's kernel stack
+* description - the first switch to the thread "returns" into fn, which
+*               never returns itself
+*/
+void task_init_kstack(process_control_block_t* pcb, void (*fn)(void))
+{
+    uint32_t* sp = (uint32_t*)((uint32_t)pcb + STACK_SIZE4);
+
+    //return address of fn
+    *(--sp) = 0;
+
+    //context_switch frame: ret, ebp, ebx, esi, edi, gs
+    *(--sp) = (uint32_t)fn;
+    *(--sp) = 0;
+    *(--sp) = 0;
+    *(--sp) = 0;
+    *(--sp) = 0;
+    *(--sp) = 0;
+
+    pcb->sched_esp = (int32_t)sp;
+}
+
+/*set_tls
+* input - linear base of the thread local storage block
+* outpt - none
+* side effects - rewrites the TLS descriptor in the LDT
+* description - user threads reach their TLS through %gs = TLS_SEL, the one
+*               descriptor is repointed on every switch and reloaded when
+*               context_switch pops the incoming task's %gs
+*/
+void set_tls(uint32_t base)
+{
+    seg_desc_t* tls_desc = (seg_desc_t*)&ldt;
+
+    tls_desc->granularity = 0;
+    tls_desc->opsize      = 1;
+    tls_desc->reserved    = 0;
+    tls_desc->avail       = 0;
+    tls_desc->present     = 1;
+    tls_desc->dpl         = 0x3;
+    tls_desc->sys         = 1;
+    tls_desc->type        = 0x2;
+
+    SET_LDT_PARAMS((*tls_desc), base, TLS_LIMIT);
+}
+
+/*tick_softirq
+* input - none
+* outpt - none
+* side effects - may reprogram the pit, modifies video memory
+* description - bottom half of the pit interrupt, runs the due timers,
+*               programs the next event in place of the fallback the
+*               handler left and redraws a vidmap screen
+*/
+static void tick_softirq(void)
+{
+    uint32_t flags;
+
+    timer_run();
+
+    cli_and_save(flags);
+    tick_due = 0;
+    tick_program();
+    restore_flags(flags);
+
+    if(setup)
+        screen_tick();
+}
 
+/*pit_oneshot
+* input - clock_ns() time to interrupt at, current clock_ns()
+* outpt - none
+* side effects - restarts pit channel 0
+* description - counts down from the nearest count, PIT_MIN_COUNT for a time
+*               already past
+*/
+static void pit_oneshot(uint64_t due, uint64_t now)
+{
+    uint64_t wait;
+    uint32_t count = PIT_MIN_COUNT;
 
+    if(due > now){
+        wait = (due - now) * PIT_HZ;
+        div64_32(&wait, NS_PER_SEC);
+        count = wait > PIT_MAX_COUNT ? PIT_MAX_COUNT : wait;
+        if(count < PIT_MIN_COUNT)
+            count = PIT_MIN_COUNT;
+    }
 
-    //write code that turns on "display to screen" only for running process
-    //processes running in background write to their own backups
+    outb(PIT_ONESHOT, MODE_COMMAND_REG);
+    outb(count & MASK_FREQ, PIT_0_DATA_PORT);
+    outb(count >> 8, PIT_0_DATA_PORT);
+}
 
-    //if next process is not in the active terminal write to backup video memory
-    if((schedule_arr[curr]->proc_id)/4 != curr_terminal){
-        int term_to_write = (curr_pcb->proc_id)/4;
-        page_directory[VIDMAP_PAGE] = (uint32_t)page_table_vid | URWON;
-        page_table_vid[0] = sched_vid_backups[term_to_write] | URWON;
-        page_table[VIDEO >> 12] = sched_vid_backups[term_to_write] | RWON;
+/*rt_release
+* input - real-time task, current clock_ns()
+* outpt - none
+* side effects - arms the task's rt_timer
+* description - starts a job with a full budget. A task that comes back
+*               before its last deadline starts the next period from there
+*               rather than from now, so it can't take more than its share.
+*/
+static void rt_release(process_control_block_t* pcb, uint64_t now)
+{
+    uint64_t release = pcb->rt_deadline > now ? pcb->rt_deadline : now;
+
+    pcb->rt_deadline = release + pcb->rt_period;
+    pcb->rt_used = 0;
+    pcb->rt_throttled = 0;
+    pcb->rt_start = now;
+    timer_arm(&pcb->rt_timer, pcb->rt_deadline, rt_expired, (uint32_t)pcb);
+}
+
+/*rt_charge
+* input - task, current clock_ns()
+* outpt - none
+* side effects - may throttle the task
+* description - bills a running real-time task for the time since it was
+*               last charged
+*/
+static void rt_charge(process_control_block_t* pcb, uint64_t now)
+{
+    if(!pcb->rt_period)
+        return;
+    pcb->rt_used += now - pcb->rt_start;
+    pcb->rt_start = now;
+    if(pcb->rt_used >= pcb->rt_budget)
+        pcb->rt_throttled = 1;
+}
+
+/*rt_job_done
+* input - task that is about to block
+* outpt - none
+* side effects - counts a deadline miss if the job ran late
+* description - a real-time task that blocks is done with its job, the next
+*               one starts when it is woken. Called with interrupts off.
+*/
+static void rt_job_done(process_control_block_t* pcb)
+{
+    uint64_t now;
+
+    if(!pcb->rt_period)
+        return;
+    now = clock_ns();
+    rt_charge(pcb, now);
+    timer_cancel(&pcb->rt_timer);
+    pcb->rt_jobs++;
+    if(now > pcb->rt_deadline)
+        pcb->rt_misses++;
+}
+
+/*rt_expired
+* input - pcb of a real-time task
+* outpt - none
+* side effects - starts the next job
+* description - rt_timer callback, the deadline passed while the job was
+*               still running, that is a miss. A task blocked some other way
+*               than task_block is taken as done.
+*/
+static void rt_expired(uint32_t data)
+{
+    process_control_block_t* pcb = (process_control_block_t*)data;
+    uint64_t now = clock_ns();
+
+    if(schedule_arr[pcb->slot] != pcb)
+        return;
+
+    if(pcb == curr_pcb)
+        rt_charge(pcb, now);
+    pcb->rt_jobs++;
+    pcb->rt_misses++;
+    rt_release(pcb, now);
+    if(pcb != curr_pcb)
+        need_resched = 1;
+}
+
+/*rt_ppm
+* input - period and budget in us
+* outpt - share of the cpu in ppm
+* side effects - none
+* description - budget / period
+*/
+static uint32_t rt_ppm(uint32_t period_us, uint32_t budget_us)
+{
+    uint64_t ppm = (uint64_t)budget_us * RT_PPM;
+    div64_32(&ppm, period_us);
+    return ppm;
+}
+
+/*pick_next
+* input - none
+* outpt - index into schedule_arr, -1 if nothing is runnable
+* side effects - none
+* description - the runnable real-time task with budget left whose deadline
+*               comes first, otherwise round robin after curr. Tasks of
+*               background terminals run too and write to their own console.
+*/
+static int32_t pick_next(void)
+{
+    int32_t i, j, best = -1;
+    process_control_block_t* pcb;
+
+    for(i = 0; i < SCHED_SIZE; i++){
+        pcb = schedule_arr[i];
+        if(pcb == NULL || !pcb->rt_period || pcb->rt_throttled)
+            continue;
+        if(best == -1 || pcb->rt_deadline < schedule_arr[best]->rt_deadline)
+            best = i;
     }
-    //next process is in current terminal so write to active memory
-    else{
-      page_directory[VIDMAP_PAGE] = (uint32_t)page_table_vid | URWON;
-      page_table_vid[0] = VIDEO | URWON;
-      page_table[VIDEO >> 12] = VIDEO | URWON;
+    if(best != -1)
+        return best;
+
+    for(i = 1; i <= SCHED_SIZE; i++){
+        j = (curr + i) % SCHED_SIZE;
+        if(schedule_arr[j])
+            return j;
     }
+    return -1;
+}
 
-    //flush tlb
-   asm volatile(
-       "movl %cr3,%eax \n \
-       movl %eax,%cr3"
-   );
+/*switch_to
+* input - pcb to run
+* outpt - none
+* side effects - changes tss, paging, LDT and the kernel stack
+* description - context switch, called with interrupts off
+*/
+static void switch_to(process_control_block_t* next)
+{
+    process_control_block_t* prev = curr_pcb;
+    uint64_t now;
 
+    LAT_SWITCH_BEGIN();
+    TRACE_EVENT(TR_SWITCH, prev->slot, next->slot, 0, 0);
+    now = clock_ns();
+    rt_charge(prev, now);
+    next->rt_start = now;
+    curr = next->slot;
 
     //context switching
-    tss.esp0 = (uint32_t)(schedule_arr[curr])+STACK_SIZE4;
+    tss.esp0 = (uint32_t)next + STACK_SIZE4;
     tss.ss0 = KERNEL_DS;
 
-    //save old esp/ebp
-    if(schedule_arr[last]){
-        asm (
-          "movl %%esp, %0"
-          :"=r"(schedule_arr[last]->sched_esp)
-        );
-        asm (
-          "movl %%ebp, %0"
-          :"=r"(schedule_arr[last]->sched_ebp)
+    //threads of one process share the same page, a kernel thread keeps the
+    //one that is there
+    if(next->idx != KTHREAD_IDX && prev->idx != next->idx){
+        page_directory[USER_PROG] = mem_locs[next->idx] | SURWON;
+        shm_load(next);
+        vidmap_load(next);
+
+        //flush tlb
+        asm volatile(
+            "movl %cr3,%eax \n \
+            movl %eax,%cr3"
         );
     }
 
-    //restore new esp/ebp
-    asm (
-      "movl %0, %%esp"
-      :
-      :"r"(schedule_arr[curr]->sched_esp)
-    );
-    asm (
-      "movl %0, %%ebp"
-      :
-      :"r"(schedule_arr[curr]->sched_ebp)
-    );
-
-    //set paging to new process
-    page_directory[32] = mem_locs[schedule_arr[curr]->idx] | SURWON;
-
-    //flush tlb
-    asm volatile(
-        "movl %cr3,%eax \n \
-        movl %eax,%cr3"
-    );
-    curr_pcb = schedule_arr[curr];
-
-   // restore_flags(flags);
+    set_tls(next->tls_base);
+    console_route(next->term);
+    curr_pcb = next;
+
+    context_switch((uint32_t*)&prev->sched_esp, next->sched_esp);
+    LAT_SWITCH_END();
 }
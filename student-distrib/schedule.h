@@ -15,13 +15,65 @@
 
 #define PIT_MODE_3 0x36
 #define DIV_100HZ 1193180/100
+//channel 0 counts down once and interrupts at 0, reloaded for every event
+#define PIT_ONESHOT 0x30
+#define PIT_MAX_COUNT 0xFFFF
+//shortest wait programmed, an event already due still takes this long
+#define PIT_MIN_COUNT 0x20
+//a little under PIT_MAX_COUNT, the furthest one-shot
+#define PIT_MAX_NS 54000000
 #define MASK_FREQ 0xFF
-#define SCHED_SIZE 3
+#define SCHED_SIZE MAX_TASKS
+#define TLS_LIMIT (TLS_SIZE - 1)
+#define MS_PER_TICK 10
+#define TICK_NS (MS_PER_TICK * NS_PER_MS)
+
+//real-time class, periods and budgets in us
+#define RT_MIN_PERIOD 1000
+#define RT_MAX_PERIOD 1000000
+//parts per million of the cpu all real-time tasks may reserve, the rest is
+//left to normal tasks
+#define RT_PPM 1000000
+#define RT_MAX_UTIL 900000
+#define NS_PER_US 1000
 
 int32_t curr;
 
+//pit interrupts since boot, with nohz they are not evenly spaced
+extern volatile uint32_t pit_ticks;
+//tsc low word when the latest pit interrupt came in
+extern uint32_t pit_stamp;
+//one-shot pit programmed for the next event instead of a 100Hz tick,
+//"nohz=off" on the kernel line turns it off
+extern int32_t nohz;
+//cycles spent halted with nothing to run
+extern uint64_t idle_cycles;
+//a tick ended the time slice or a task that preempts the current one woke
+//up, checked on the way out of interrupts and back to user space
+extern int32_t need_resched;
+//ppm of the cpu the admitted real-time tasks reserve
+extern uint32_t rt_util;
+
+struct pcb;
+
 extern void pit_init(void);
 extern void pit_handler();
+extern void schedule(void);
+extern void task_block(void);
+extern void task_wake(struct pcb* pcb);
+extern void task_handoff(struct pcb* next);
+extern void task_init_stack(struct pcb* pcb, uint32_t eip, uint32_t user_esp);
+extern void task_init_kstack(struct pcb* pcb, void (*fn)(void));
+extern void set_tls(uint32_t base);
+extern void sleep_on(uint32_t chan);
+extern void wake_up(uint32_t chan);
+extern void poll_sleep(void);
+extern void poll_wake(void);
+extern void preempt_disable(void);
+extern void preempt_enable(void);
+extern void preempt_check(void);
+extern void tick_program(void);
+extern int32_t rt_set(struct pcb* pcb, uint32_t period_us, uint32_t budget_us);
 
 
 
@@ -0,0 +1,61 @@
+//polled output on COM1, the kernel writes what the host has to read back
+//(profiles, traces) here. Nothing is received and no interrupt is used.
+#include "serial.h"
+
+/* serial_init
+ *
+ * DESCRIPTION: sets COM1 to 115200 baud 8N1 with its fifos on
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void serial_init(void){
+    outb(0, COM1 + SERIAL_IER);
+    outb(SERIAL_DLAB, COM1 + SERIAL_LCR);
+    outb(SERIAL_DIVISOR & 0xFF, COM1 + SERIAL_DIV_LO);
+    outb(SERIAL_DIVISOR >> 8, COM1 + SERIAL_DIV_HI);
+    outb(SERIAL_8N1, COM1 + SERIAL_LCR);
+    outb(SERIAL_FIFO_ON, COM1 + SERIAL_FCR);
+    outb(SERIAL_MCR_ON, COM1 + SERIAL_MCR);
+}
+
+/* serial_putc
+ *
+ * DESCRIPTION: waits for room in the transmitter and sends one byte, a
+ *              newline goes out as \r\n
+ * INPUT/OUTPUT: int8_t c - byte to send
+ * SIDE EFFECTS: busy waits
+ */
+void serial_putc(int8_t c){
+    if(c == '\n')
+        serial_putc('\r');
+    while(!(inb(COM1 + SERIAL_LSR) & SERIAL_THRE));
+    outb(c, COM1 + SERIAL_DATA);
+}
+
+/* serial_puts
+ *
+ * DESCRIPTION: sends a string
+ * INPUT/OUTPUT: const int8_t* s - null terminated
+ * SIDE EFFECTS: busy waits
+ */
+void serial_puts(const int8_t* s){
+    while(*s)
+        serial_putc(*s++);
+}
+
+/* serial_hex
+ *
+ * DESCRIPTION: sends a word as 8 lowercase hex digits, the width nm prints
+ *              addresses in so host scripts can compare them as strings
+ * INPUT/OUTPUT: uint32_t value - word to send
+ * SIDE EFFECTS: busy waits
+ */
+void serial_hex(uint32_t value){
+    int32_t shift;
+    uint32_t digit;
+
+    for(shift = 28; shift >= 0; shift -= 4){
+        digit = (value >> shift) & 0xF;
+        serial_putc(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "types.h"
+#include "lib.h"
+
+//first serial port, qemu writes it to a host file with -serial file:<name>
+#define COM1 0x3F8
+//register offsets from the base port
+#define SERIAL_DATA 0
+#define SERIAL_IER 1
+#define SERIAL_DIV_LO 0
+#define SERIAL_DIV_HI 1
+#define SERIAL_FCR 2
+#define SERIAL_LCR 3
+#define SERIAL_MCR 4
+#define SERIAL_LSR 5
+//divisor latch access bit, then 8 data bits, no parity, one stop bit
+#define SERIAL_DLAB 0x80
+#define SERIAL_8N1 0x03
+//enable and clear the fifos
+#define SERIAL_FIFO_ON 0xC7
+//dtr, rts and out2
+#define SERIAL_MCR_ON 0x0B
+//transmit holding register empty
+#define SERIAL_THRE 0x20
+//115200 baud
+#define SERIAL_DIVISOR 1
+
+void serial_init(void);
+void serial_putc(int8_t c);
+void serial_puts(const int8_t* s);
+void serial_hex(uint32_t value);
+
+#endif
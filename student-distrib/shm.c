@@ -0,0 +1,229 @@
+//named shared memory, each segment is one 4MB frame after the process pages
+#include "shm.h"
+#include "schedule.h"
+
+static shm_t segments[MAX_SHM];
+
+static void flush_tlb(void);
+static void shm_drop(int32_t id, process_control_block_t* leader);
+
+/* shm_init
+ *
+ * DESCRIPTION: marks every segment as free
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void shm_init(void){
+    int32_t i;
+    for(i = 0; i < MAX_SHM; i++){
+        segments[i].in_use = OFF;
+        segments[i].gen = 0;
+    }
+}
+
+/* shm_get
+ *
+ * DESCRIPTION: looks up a segment by name, creating it if it doesn't exist
+ * INPUT/OUTPUT: const int8_t* name - kernel copy of the name
+ *               int32_t size - bytes needed, at most SHM_SIZE
+ *               returns segment id, -1 if size is bad or every segment is taken
+ * SIDE EFFECTS: a new segment is zeroed the first time it is mapped, it
+ *               belongs to the caller until then
+ */
+int32_t shm_get(const int8_t* name, int32_t size){
+    int32_t i;
+    int32_t free_id = -1;
+
+    if(size <= 0 || size > SHM_SIZE)
+        return -1;
+
+    for(i = 0; i < MAX_SHM; i++){
+        if(segments[i].in_use == OFF){
+            if(free_id == -1)
+                free_id = i;
+        }
+        else if(strncmp(segments[i].name,name,SHM_NAME_LEN) == 0){
+            return (size <= segments[i].size) ? i : -1;
+        }
+    }
+    if(free_id == -1)
+        return -1;
+
+    strncpy(segments[free_id].name,name,SHM_NAME_LEN);
+    segments[free_id].size = size;
+    segments[free_id].refs = 0;
+    segments[free_id].fresh = 1;
+    segments[free_id].zeroing = 0;
+    segments[free_id].zeroer = NULL;
+    segments[free_id].owner = curr_pcb->leader;
+    segments[free_id].gen++;
+    segments[free_id].in_use = ON;
+    return free_id;
+}
+
+/* shm_attach
+ *
+ * DESCRIPTION: maps a segment into the calling process, every thread sees it.
+ *              Called with interrupts off, waits while another process
+ *              zeroes the segment and checks everything again after it.
+ * INPUT/OUTPUT: int32_t id - segment id
+ *               uint32_t addr - 4MB aligned address inside the shm window
+ *               returns 0, SHM_FRESH if the caller has to zero it first,
+ *               -1 on a bad id or address or if addr is taken
+ * SIDE EFFECTS: changes paging
+ */
+int32_t shm_attach(int32_t id, uint32_t addr){
+    process_control_block_t* leader = curr_pcb->leader;
+    int32_t slot = (addr - SHM_VIRT) / SHM_SIZE;
+    uint32_t gen;
+
+    if(id < 0 || id >= MAX_SHM || segments[id].in_use == OFF)
+        return -1;
+    if(addr < SHM_VIRT || addr >= SHM_END || (addr & (SHM_SIZE - 1)) != 0)
+        return -1;
+
+    //while we sleep the segment may be freed and handed out again, or
+    //another thread may map something at addr
+    gen = segments[id].gen;
+    while(1){
+        if(segments[id].in_use == OFF || segments[id].gen != gen)
+            return -1;
+        if(leader->shm_map[slot] != SHM_NONE)
+            return -1;
+        if(!segments[id].zeroing)
+            break;
+        sleep_on((uint32_t)&segments[id]);
+    }
+
+    leader->shm_map[slot] = id;
+    segments[id].refs++;
+    segments[id].owner = NULL;
+    page_directory[SHM_PDE + slot] = (SHM_BASE + id * SHM_SIZE) | SURWON;
+    flush_tlb();
+
+    //don't hand out whatever the last owner of the frame left there
+    if(segments[id].fresh){
+        segments[id].fresh = 0;
+        segments[id].zeroing = 1;
+        segments[id].zeroer = leader;
+        return SHM_FRESH;
+    }
+    return 0;
+}
+
+/* shm_zeroed
+ *
+ * DESCRIPTION: the caller of shm_attach finished zeroing a fresh segment,
+ *              lets the processes waiting to map it go on
+ * INPUT/OUTPUT: int32_t id - segment id
+ * SIDE EFFECTS: none
+ */
+void shm_zeroed(int32_t id){
+    uint32_t flags;
+    cli_and_save(flags);
+    if(segments[id].zeroing && segments[id].zeroer == curr_pcb->leader){
+        segments[id].zeroing = 0;
+        segments[id].zeroer = NULL;
+        wake_up((uint32_t)&segments[id]);
+    }
+    restore_flags(flags);
+}
+
+/* shm_drop
+ *
+ * DESCRIPTION: a process lets go of its mapping of a segment, which is freed
+ *              after the last one. A process that halted while it was still
+ *              zeroing the segment leaves that to the next mapper and lets
+ *              the waiters go.
+ * INPUT/OUTPUT: int32_t id - segment id
+ *               process_control_block_t* leader - process unmapping it
+ * SIDE EFFECTS: may wake processes waiting in shm_attach
+ */
+static void shm_drop(int32_t id, process_control_block_t* leader){
+    if(segments[id].zeroing && segments[id].zeroer == leader){
+        segments[id].zeroing = 0;
+        segments[id].zeroer = NULL;
+        segments[id].fresh = 1;
+        wake_up((uint32_t)&segments[id]);
+    }
+    if(--segments[id].refs == 0)
+        segments[id].in_use = OFF;
+}
+
+/* shm_detach
+ *
+ * DESCRIPTION: unmaps a segment, it is freed after its last unmap
+ * INPUT/OUTPUT: uint32_t addr - address it was mapped at
+ *               returns 0, -1 if nothing is mapped there or another thread
+ *               is still zeroing it
+ * SIDE EFFECTS: changes paging
+ */
+int32_t shm_detach(uint32_t addr){
+    process_control_block_t* leader = curr_pcb->leader;
+    int32_t slot = (addr - SHM_VIRT) / SHM_SIZE;
+    int32_t id;
+
+    if(addr < SHM_VIRT || addr >= SHM_END || (addr & (SHM_SIZE - 1)) != 0)
+        return -1;
+    id = leader->shm_map[slot];
+    if(id == SHM_NONE)
+        return -1;
+    //the zeroing thread writes through this mapping with interrupts on
+    if(segments[id].zeroing && segments[id].zeroer == leader)
+        return -1;
+
+    leader->shm_map[slot] = SHM_NONE;
+    shm_drop(id, leader);
+    page_directory[SHM_PDE + slot] = RW;
+    flush_tlb();
+    return 0;
+}
+
+/* shm_release
+ *
+ * DESCRIPTION: drops every mapping of a halting process and frees the
+ *              segments it created that nobody mapped. A thread killed in
+ *              the middle of zeroing a segment doesn't keep others waiting.
+ * INPUT/OUTPUT: process_control_block_t* pcb - process leader
+ * SIDE EFFECTS: clears the shm window, caller flushes the tlb
+ */
+void shm_release(process_control_block_t* pcb){
+    int32_t i, id;
+    for(i = 0; i < MAX_SHM; i++){
+        if(segments[i].in_use == ON && segments[i].owner == pcb)
+            segments[i].in_use = OFF;
+    }
+    for(i = 0; i < SHM_WINDOW; i++){
+        id = pcb->shm_map[i];
+        if(id == SHM_NONE)
+            continue;
+        pcb->shm_map[i] = SHM_NONE;
+        shm_drop(id, pcb);
+        page_directory[SHM_PDE + i] = RW;
+    }
+}
+
+/* shm_load
+ *
+ * DESCRIPTION: points the shm window at the segments of the process about to
+ *              run, called next to every remap of the user page
+ * INPUT/OUTPUT: process_control_block_t* pcb - any task of the process
+ * SIDE EFFECTS: caller flushes the tlb
+ */
+void shm_load(process_control_block_t* pcb){
+    int32_t i, id;
+    for(i = 0; i < SHM_WINDOW; i++){
+        id = pcb->leader->shm_map[i];
+        if(id == SHM_NONE)
+            page_directory[SHM_PDE + i] = RW;
+        else
+            page_directory[SHM_PDE + i] = (SHM_BASE + id * SHM_SIZE) | SURWON;
+    }
+}
+
+static void flush_tlb(void){
+    asm volatile(
+        "movl %cr3,%eax \n \
+        movl %eax,%cr3"
+    );
+}
@@ -0,0 +1,45 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include "types.h"
+#include "lib.h"
+#include "paging.h"
+#include "sys_handlers.h"
+
+#define MAX_SHM 4
+#define SHM_NAME_LEN 32
+#define SHM_BASE 0x2000000
+#define SHM_SIZE 0x400000
+#define SHM_PDE 34
+#define SHM_VIRT 0x08800000
+#define SHM_END (SHM_VIRT + SHM_WINDOW * SHM_SIZE)
+#define SHM_NONE -1
+//shm_attach mapped a new segment, the caller zeroes it and calls shm_zeroed
+#define SHM_FRESH 1
+
+struct pcb;
+
+typedef struct shm{
+    int8_t name[SHM_NAME_LEN];
+    int32_t size;
+    int32_t refs;
+    int32_t in_use;
+    int32_t fresh;
+    //the first mapper is zeroing it with interrupts on, others wait
+    int32_t zeroing;
+    struct pcb* zeroer;
+    //counts reuses of the slot, a waiter notices it was freed meanwhile
+    uint32_t gen;
+    //process that created it, it frees a segment nobody mapped yet on halt
+    struct pcb* owner;
+}shm_t;
+
+void shm_init(void);
+int32_t shm_get(const int8_t* name, int32_t size);
+int32_t shm_attach(int32_t id, uint32_t addr);
+void shm_zeroed(int32_t id);
+int32_t shm_detach(uint32_t addr);
+void shm_release(struct pcb* pcb);
+void shm_load(struct pcb* pcb);
+
+#endif
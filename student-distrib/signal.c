@@ -0,0 +1,241 @@
+//signal delivery, a handler runs on the user stack above a copy of the
+//interrupted registers and comes back through the trampoline next to them
+#include "signal.h"
+#include "x86_desc.h"
+#include "pipe.h"
+
+//movl $SYS_SIGRETURN, %eax ; int $0x80 ; nop
+static uint8_t trampoline[SIG_TRAMP_SIZE] = {
+    0xB8, SYS_SIGRETURN, 0x00, 0x00, 0x00, 0xCD, 0x80, 0x90
+};
+
+static void alarm_expired(uint32_t data);
+static void signal_wake(process_control_block_t* pcb);
+static process_control_block_t* pipe_writer(process_control_block_t* reader);
+
+/* signal_send
+ *
+ * DESCRIPTION: marks signum pending on a task, it is delivered the next time
+ *              the task returns to user space. A task asleep in sleep_on is
+ *              woken so it can get there.
+ * INPUT/OUTPUT: process_control_block_t* pcb - task to signal
+ *               int32_t signum
+ * SIDE EFFECTS: stamps the task with the tsc, safe to call from interrupts
+ */
+void signal_send(process_control_block_t* pcb, int32_t signum){
+    uint32_t stamp, flags;
+    asm volatile("rdtsc" : "=a"(stamp) : : "edx");
+
+    cli_and_save(flags);
+    pcb->sig_tsc = stamp;
+    pcb->sig_pending |= (1 << signum);
+    signal_wake(pcb);
+    restore_flags(flags);
+}
+
+/* signal_pending
+ *
+ * DESCRIPTION: whether do_signal would act on a pending signal, blocking
+ *              calls return -1 when it would so the signal gets delivered.
+ *              ALARM and USER1 without a handler are dropped, so they don't
+ *              count.
+ * INPUT/OUTPUT: process_control_block_t* pcb - task to check
+ *               returns 1 if a signal is waiting to be delivered, else 0
+ * SIDE EFFECTS: none
+ */
+int32_t signal_pending(process_control_block_t* pcb){
+    uint32_t pending = pcb->sig_pending;
+
+    if(pcb->sig_masked)
+        return 0;
+    if(pcb->leader->sig_handler[ALARM] == NULL)
+        pending &= ~(1 << ALARM);
+    if(pcb->leader->sig_handler[USER1] == NULL)
+        pending &= ~(1 << USER1);
+    return pending != 0;
+}
+
+/* signal_wake
+ *
+ * DESCRIPTION: wakes a task sleeping on a wait channel when it has a signal
+ *              to take, the sleeper sees it through signal_pending.
+ *              Called with interrupts off.
+ * INPUT/OUTPUT: process_control_block_t* pcb - task just signalled
+ * SIDE EFFECTS: may make the task runnable
+ */
+static void signal_wake(process_control_block_t* pcb){
+    if(pcb->wait_chan && signal_pending(pcb)){
+        pcb->wait_chan = 0;
+        task_wake(pcb);
+    }
+}
+
+/* pipe_writer
+ *
+ * DESCRIPTION: finds the detached process on the same terminal whose stdout
+ *              is the pipe reader takes its stdin from, the stage before it
+ *              in a pipeline
+ * INPUT/OUTPUT: process_control_block_t* reader
+ *               returns that process, NULL if stdin is not a pipe or no
+ *               detached process writes it
+ * SIDE EFFECTS: none
+ */
+static process_control_block_t* pipe_writer(process_control_block_t* reader){
+    int32_t i;
+    process_control_block_t* pcb;
+    file_descriptor_structure_t* in = &reader->fd_table[0];
+    file_descriptor_structure_t* out;
+
+    if(in->flags == OFF || in->table != pipe_driver || in->position != PIPE_READ_END)
+        return NULL;
+
+    for(i = 0; i < MAX_PROCESS; i++){
+        if(tasks->task[i].in_use != ON)
+            continue;
+        pcb = &tasks->task[i].proc;
+        if(pcb->term != reader->term || !pcb->detached)
+            continue;
+        out = &pcb->fd_table[1];
+        if(out->flags != OFF && out->table == pipe_driver &&
+           out->position == PIPE_WRITE_END && out->inode == in->inode)
+            return pcb;
+    }
+    return NULL;
+}
+
+/* signal_interrupt
+ *
+ * DESCRIPTION: ctrl+c, sends INTERRUPT to the program running in the
+ *              foreground of a terminal. That is the newest process the
+ *              terminal's shell chain executed, the root shell is left alone.
+ *              The earlier stages of its pipeline are spawned, so they are
+ *              found by following stdin back through the pipes.
+ * INPUT/OUTPUT: int32_t term - terminal number
+ * SIDE EFFECTS: none
+ */
+void signal_interrupt(int32_t term){
+    int32_t i;
+    uint32_t flags;
+    process_control_block_t* pcb;
+    process_control_block_t* fg = NULL;
+
+    //the keyboard bottom half runs with interrupts on
+    cli_and_save(flags);
+
+    for(i = 0; i < MAX_PROCESS; i++){
+        if(tasks->task[i].in_use != ON)
+            continue;
+        pcb = &tasks->task[i].proc;
+        if(pcb->term != term || pcb->detached)
+            continue;
+        if(fg == NULL || pcb->proc_id > fg->proc_id)
+            fg = pcb;
+    }
+
+    if(fg == NULL || ROOT_SHELL(fg)){
+        restore_flags(flags);
+        return;
+    }
+
+    //bounded in case the pipes ever form a loop
+    for(i = 0; fg != NULL && i < MAX_PROCESS; i++){
+        signal_send(fg, INTERRUPT);
+        fg = pipe_writer(fg);
+    }
+    restore_flags(flags);
+}
+
+/* alarm_set
+ *
+ * DESCRIPTION: starts a process's ALARM over with a new period, counting
+ *              from now, on its own kernel timer
+ * INPUT/OUTPUT: process_control_block_t* pcb - leader of the process
+ *               uint32_t period_ms - 0 stops the alarm
+ * SIDE EFFECTS: none
+ */
+void alarm_set(process_control_block_t* pcb, uint32_t period_ms){
+    uint32_t flags;
+    cli_and_save(flags);
+
+    timer_cancel(&pcb->alarm_timer);
+    pcb->alarm_period = period_ms;
+    if(period_ms){
+        pcb->alarm_next = timer_now() + period_ms;
+        timer_arm(&pcb->alarm_timer, (uint64_t)pcb->alarm_next * NS_PER_MS, alarm_expired, (uint32_t)pcb);
+    }
+
+    restore_flags(flags);
+}
+
+/* alarm_expired
+ *
+ * DESCRIPTION: alarm timer callback, raises ALARM and sets the timer for
+ *              the next period
+ * INPUT/OUTPUT: uint32_t data - pcb of the leader
+ * SIDE EFFECTS: stamps the process with the pit interrupt's tsc, handed to
+ *               the handler for latency measurements
+ */
+static void alarm_expired(uint32_t data){
+    process_control_block_t* pcb = (process_control_block_t*)data;
+    uint32_t now = timer_now();
+
+    pcb->sig_tsc = pit_stamp;
+    pcb->sig_pending |= (1 << ALARM);
+    signal_wake(pcb);
+
+    //a process that was frozen on a background terminal gets one ALARM
+    //for all the periods it missed
+    pcb->alarm_next += pcb->alarm_period;
+    if((int32_t)(now - pcb->alarm_next) >= 0)
+        pcb->alarm_next = now + pcb->alarm_period;
+    timer_arm(&pcb->alarm_timer, (uint64_t)pcb->alarm_next * NS_PER_MS, alarm_expired, data);
+}
+
+/* do_signal
+ *
+ * DESCRIPTION: called by ret_from_intr with interrupts off right before a
+ *              task returns to user space. Delivers the lowest pending signal:
+ *              copies ctx, the trampoline and the tick stamp onto the user
+ *              stack and points ctx at the handler. Without a handler ALARM
+ *              and USER1 are dropped and the rest kill the task.
+ * INPUT/OUTPUT: hw_context_t* ctx - user registers about to be restored
+ * SIDE EFFECTS: may not return, signals stay masked until sigreturn
+ */
+void do_signal(hw_context_t* ctx){
+    int32_t signum;
+    void* handler;
+    signal_frame_t* frame;
+    process_control_block_t* pcb = curr_pcb;
+
+    if(pcb->sig_masked)
+        return;
+
+    for(signum = 0; signum < NUM_SIGNALS; signum++){
+        if(!(pcb->sig_pending & (1 << signum)))
+            continue;
+        pcb->sig_pending &= ~(1 << signum);
+
+        handler = pcb->leader->sig_handler[signum];
+        if(handler == NULL){
+            if(signum == ALARM || signum == USER1)
+                continue;
+            kill_current();
+        }
+
+        //no room for the frame, nothing the task can do about it
+        frame = (signal_frame_t*)(ctx->esp - sizeof(signal_frame_t));
+        if((uint32_t)frame < USER || ctx->esp > USER_STACK_TOP)
+            kill_current();
+
+        memcpy(&frame->context, ctx, sizeof(hw_context_t));
+        memcpy(frame->trampoline, trampoline, SIG_TRAMP_SIZE);
+        frame->irq_tsc = pcb->sig_tsc;
+        frame->signum = signum;
+        frame->ret_addr = (uint32_t)frame->trampoline;
+
+        ctx->esp = (uint32_t)frame;
+        ctx->eip = (uint32_t)handler;
+        pcb->sig_masked = 1;
+        return;
+    }
+}
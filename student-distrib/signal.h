@@ -0,0 +1,31 @@
+#ifndef SIGNAL_H
+#define SIGNAL_H
+
+#include "types.h"
+#include "lib.h"
+#include "sys_handlers.h"
+
+#define SIG_TRAMP_SIZE 8
+//arithmetic flags and DF, the only ones sigreturn takes from user space
+#define EFLAGS_USER 0x0CD5
+//ece391 programs get an ALARM every 10 seconds unless they ask otherwise
+#define ALARM_MS 10000
+
+//what a handler finds on its stack, from its return address up
+typedef struct signal_frame{
+    uint32_t ret_addr;
+    uint32_t signum;
+    hw_context_t context;
+    uint8_t trampoline[SIG_TRAMP_SIZE];
+    uint32_t irq_tsc;
+}signal_frame_t;//88
+
+struct pcb;
+
+void signal_send(struct pcb* pcb, int32_t signum);
+int32_t signal_pending(struct pcb* pcb);
+void signal_interrupt(int32_t term);
+void alarm_set(struct pcb* pcb, uint32_t period_ms);
+void do_signal(hw_context_t* ctx);
+
+#endif
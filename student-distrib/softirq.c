@@ -0,0 +1,197 @@
+//bottom halves. Every device interrupt goes through irq_enter and irq_exit
+//around its handler, irq_exit runs the softirqs the handler raised with
+//interrupts on and then switches tasks if the interrupt asked for it.
+#include "softirq.h"
+#include "schedule.h"
+#include "worker.h"
+#include "trace.h"
+
+int32_t softirq_on = 1;
+uint32_t irqoff_max[NUM_IRQS];
+hw_context_t* irq_regs;
+
+static void (*softirq_vec[NR_SOFTIRQS])(void);
+static volatile uint32_t softirq_pending;
+//nonzero while softirqs run or are held off, they don't nest
+static volatile int32_t softirq_count;
+//leftovers after SOFTIRQ_RESTART passes
+static work_t softirq_work;
+
+//IRQ line and tsc low word of the interrupt whose interrupts off window is
+//open, -1 once it is closed
+static int32_t irq_line;
+static uint32_t irq_stamp;
+
+static void irqoff_end(void);
+static void softirq_thread(uint32_t data);
+
+/* softirq_init
+ *
+ * DESCRIPTION: nothing raised, no handlers yet, runs before any device
+ *              interrupt is enabled
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void softirq_init(void){
+    int32_t i;
+
+    for(i = 0; i < NR_SOFTIRQS; i++)
+        softirq_vec[i] = NULL;
+    for(i = 0; i < NUM_IRQS; i++)
+        irqoff_max[i] = 0;
+    softirq_pending = 0;
+    softirq_count = 0;
+    softirq_work.pending = 0;
+    irq_line = -1;
+}
+
+/* open_softirq
+ *
+ * DESCRIPTION: sets the function a softirq runs
+ * INPUT/OUTPUT: int32_t nr - softirq number
+ *               fn - runs with interrupts on and preemption off
+ * SIDE EFFECTS: none
+ */
+void open_softirq(int32_t nr, void (*fn)(void)){
+    softirq_vec[nr] = fn;
+}
+
+/* raise_softirq
+ *
+ * DESCRIPTION: marks a softirq to run at the next interrupt exit, called
+ *              from hard interrupt handlers with interrupts off
+ * INPUT/OUTPUT: int32_t nr - softirq number
+ * SIDE EFFECTS: none
+ */
+void raise_softirq(int32_t nr){
+    softirq_pending |= 1 << nr;
+}
+
+/* do_softirq
+ *
+ * DESCRIPTION: runs every raised softirq, lowest number first, and goes
+ *              again for the ones raised meanwhile. Interrupts are on while
+ *              they run, unless softirq=off, and a task switch waits until
+ *              they are done. Whatever is still raised after
+ *              SOFTIRQ_RESTART passes goes to the worker thread so an
+ *              interrupt storm can't keep the interrupted task off the cpu.
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void do_softirq(void){
+    uint32_t flags, pending;
+    int32_t nr, rounds = SOFTIRQ_RESTART;
+
+    cli_and_save(flags);
+    if(softirq_count || !softirq_pending){
+        restore_flags(flags);
+        return;
+    }
+    softirq_count++;
+    preempt_disable();
+
+    while((pending = softirq_pending) != 0 && rounds-- > 0){
+        softirq_pending = 0;
+        if(softirq_on){
+            irqoff_end();
+            sti();
+        }
+        for(nr = 0; pending; nr++, pending >>= 1){
+            if((pending & 1) && softirq_vec[nr])
+                softirq_vec[nr]();
+        }
+        cli();
+    }
+
+    preempt_enable();
+    softirq_count--;
+    if(softirq_pending)
+        work_queue(&softirq_work, softirq_thread, 0);
+
+    restore_flags(flags);
+}
+
+/* softirq_disable / softirq_enable
+ *
+ * DESCRIPTION: keeps softirqs from running on top of task code that shares
+ *              state with them, hard interrupts still come in and raise
+ *              them. Enabling runs what was raised meanwhile, calls nest.
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void softirq_disable(void){
+    uint32_t flags;
+    cli_and_save(flags);
+    softirq_count++;
+    restore_flags(flags);
+}
+
+void softirq_enable(void){
+    uint32_t flags;
+    cli_and_save(flags);
+    softirq_count--;
+    restore_flags(flags);
+    if(softirq_on)
+        do_softirq();
+}
+
+/* irq_enter
+ *
+ * DESCRIPTION: called by every IRQ wrapper before the handler, opens the
+ *              interrupts off window and points irq_regs at the registers
+ *              the interrupt saved
+ * INPUT/OUTPUT: hw_context_t* ctx - what the wrapper pushed
+ * SIDE EFFECTS: none
+ */
+void irq_enter(hw_context_t* ctx){
+    asm volatile("rdtsc" : "=a"(irq_stamp) : : "edx");
+    irq_regs = ctx;
+    irq_line = ctx->irq_num - ICW2_MASTER;
+    TRACE_EVENT(TR_IRQ, irq_line, 0, 0, 0);
+}
+
+/* irq_exit
+ *
+ * DESCRIPTION: called by every IRQ wrapper after the handler, with
+ *              interrupts still off. Runs the softirqs unless the interrupt
+ *              came in on top of them, then takes the cpu away from the
+ *              interrupted code if a tick or a wake up asked for it.
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: may return on another task's stack much later
+ */
+void irq_exit(void){
+    TRACE_EVENT(TR_IRQ_EXIT, irq_regs->irq_num - ICW2_MASTER, 0, 0, 0);
+    if(softirq_pending && !softirq_count)
+        do_softirq();
+    irqoff_end();
+    preempt_check();
+}
+
+/* irqoff_end
+ *
+ * DESCRIPTION: closes the open interrupts off window, right before
+ *              interrupts go back on
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+static void irqoff_end(void){
+    uint32_t end;
+
+    if(irq_line < 0 || irq_line >= NUM_IRQS)
+        return;
+    asm volatile("rdtsc" : "=a"(end) : : "edx");
+    if(end - irq_stamp > irqoff_max[irq_line])
+        irqoff_max[irq_line] = end - irq_stamp;
+    irq_line = -1;
+}
+
+/* softirq_thread
+ *
+ * DESCRIPTION: worker job for softirqs left over by an interrupt exit, they
+ *              run like any other task's work from here
+ * INPUT/OUTPUT: uint32_t data - unused
+ * SIDE EFFECTS: none
+ */
+static void softirq_thread(uint32_t data){
+    do_softirq();
+}
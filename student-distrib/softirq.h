@@ -0,0 +1,38 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include "types.h"
+#include "lib.h"
+#include "i8259.h"
+
+//bottom halves, a hard interrupt handler only does what can't wait, raises
+//its softirq and the rest runs on the way out of the interrupt with
+//interrupts back on. Lower numbers run first.
+#define TIMER_SOFTIRQ 0
+#define KEYBOARD_SOFTIRQ 1
+#define NR_SOFTIRQS 2
+//passes over the pending bits one interrupt exit makes, what is raised
+//after that is left to the worker thread
+#define SOFTIRQ_RESTART 4
+
+//0 with "softirq=off" on the kernel line, bottom halves and worker jobs
+//then run inside the hard interrupt with interrupts off like they used to
+extern int32_t softirq_on;
+//most cycles an interrupt on each IRQ line kept interrupts off, from the
+//handler's entry to the first sti after it
+extern uint32_t irqoff_max[NUM_IRQS];
+//registers of the code the current device interrupt stopped, only valid in
+//the hard handler
+struct hw_context;
+extern struct hw_context* irq_regs;
+
+void softirq_init(void);
+void open_softirq(int32_t nr, void (*fn)(void));
+void raise_softirq(int32_t nr);
+void do_softirq(void);
+void softirq_disable(void);
+void softirq_enable(void);
+void irq_enter(struct hw_context* ctx);
+void irq_exit(void);
+
+#endif
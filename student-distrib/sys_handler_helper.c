@@ -1,53 +1,76 @@
 #include "sys_handler_helper.h"
+#include "shm.h"
+#include "ipc.h"
+#include "signal.h"
+#include "kmem.h"
+#include "softirq.h"
+#include "worker.h"
 
+//cycles the last SWITCH_SAMPLES terminal switches took, read with kstat
+uint32_t switch_cycles[SWITCH_SAMPLES];
+uint32_t switch_count;
 
-//Arrays of backups for different terminals
-uint32_t vid_backups[] = {BACKUP0,BACKUP1,BACKUP2};
-uint8_t buf_backup0[BUFFER_MAX_INDEX+1];
-uint8_t buf_backup1[BUFFER_MAX_INDEX+1];
-uint8_t buf_backup2[BUFFER_MAX_INDEX+1];
-uint8_t *buf_backups[] = {buf_backup0,buf_backup1,buf_backup2};
-int32_t buff_idx_backups[NUM_TERMINALS];
-uint32_t xcoord_backups[NUM_TERMINALS];
-uint32_t ycoord_backups[NUM_TERMINALS];
-process_control_block_t *pcb_backups[NUM_TERMINALS];
+//kernel heap the last terminal session took, and how many were made
+uint32_t session_bytes;
+uint32_t session_count;
+
+//program pages that were there before terminals were counted at boot,
+//for the first three root shells and the first three children
+static const uint32_t low_pages[] = {TERMINAL0,TERMINAL1,TERMINAL2,PROCESS0,PROCESS1,PROCESS2};
+
+//the Alt+Fn waiting for the worker thread
+static work_t switch_work;
+
+static int32_t open_session(int32_t term);
+static void switch_work_fn(uint32_t data);
 
 
 /* init_shell
-* input: none
+* input: terminal the shell is for
 * output: none
-* side effects: places programs into memory, sets up paging
+* side effects: places programs into memory, changes paging
 * description: intializes a shell in memory without calling execute, basically
-                a fake execute that only loads into memory
+                a fake execute that only loads into memory. Terminal t's root
+                shell always takes slot t.
 */
-void init_shell(){
-    //error check
-    if(num_processes >= 2)
-        return;
-
+void init_shell(int32_t term){
     dentry_t d;
     int32_t i;
     int32_t length;
-    int32_t proc_idx;
+    int32_t proc_idx = term;
+    int8_t entry[BUF4];
+    uint32_t prev_page = page_directory[USER_PROG];
     //increment processes
     num_processes++;
 
-    //find space for current process on kernel stack
-    task_stack_t *process;
-    for(i = 1; i < MAX_PROCESS; i++){
-        //find first available kernel stack
-        if(tasks->task[i].in_use == OFF){
-           tasks->task[i].in_use = ON;
-           process = &tasks->task[i];
-           proc_idx = i;
-           break;
-        }
-    }
+    task_stack_t *process = &tasks->task[proc_idx];
+    process->in_use = ON;
     dread("shell",&d);
 
     //set up paging
     page_directory[USER_PROG] = mem_locs[proc_idx] | SURWON;
     process->proc.idx = proc_idx;
+    process->proc.slot = proc_idx;
+    process->proc.leader = &(process->proc);
+    strncpy(process->proc.name, "shell", PROG_NAME);
+    process->proc.fd_table = process->proc.file_arr;
+    process->proc.tls_base = USER_STACK_TOP - THREAD_STACK_SIZE;
+    process->proc.wait_chan = 0;
+    process->proc.detached = 0;
+    process->proc.ipc_state = IPC_NONE;
+    process->proc.ipc_peer = 0;
+    for(i = 0; i < SHM_WINDOW; i++)
+        process->proc.shm_map[i] = SHM_NONE;
+    process->proc.vid_page = 0;
+    for(i = 0; i < NUM_SIGNALS; i++)
+        process->proc.sig_handler[i] = NULL;
+    process->proc.sig_pending = 0;
+    process->proc.sig_masked = 0;
+    process->proc.sleep_timer.pending = 0;
+    process->proc.alarm_timer.pending = 0;
+    process->proc.rt_period = 0;
+    process->proc.rt_timer.pending = 0;
+    alarm_set(&process->proc, ALARM_MS);
 
     //flush tlb
     asm volatile(
@@ -62,23 +85,34 @@ void init_shell(){
     int8_t *prog_ptr = (int8_t*)USER_ENTRY;
     fread(d.inode_num,0,prog_ptr,length);
 
+    //first switch to this terminal irets straight into the shell
+    fread(d.inode_num,ENTRY_OFF,entry,BUF4);
+    task_init_stack(&process->proc,*((uint32_t*)entry),USER_STACK_TOP - BUF4);
+
     //set up pcb id
-    if(proc_idx == 1)
-        process->proc.proc_id = 4;
-    if(proc_idx == 2)
-        process->proc.proc_id = 8;
+    process->proc.proc_id = TERM_ID(term);
+    process->proc.term = term;
 
     //open stdin
     process->proc.file_arr[0].flags = ON;
+    process->proc.file_arr[0].mode = 0;
     process->proc.file_arr[0].table = keyboard_driver;
 
     //open stdout
     process->proc.file_arr[1].flags = ON;
+    process->proc.file_arr[1].mode = 0;
     process->proc.file_arr[1].table = terminal_driver;
 
     //initialize "in use" flags to 0
     for(i=2; i<MAX_FD; i++)
         process->proc.file_arr[i].flags = OFF;
+
+    //the running task carries on in its own page, a kernel thread in the
+    //one it borrowed
+    page_directory[USER_PROG] = prev_page;
+    asm volatile(
+        "movl %cr3, %eax \n \
+        movl %eax, %cr3");
 }
 
 /* init_kernel_memory
@@ -91,153 +125,227 @@ void init_shell(){
 
 void init_kernel_memory(){
     int32_t i;
+    uint32_t page;
 
     //set pointer to tasks structure
-    tasks = (kernel_tasks_t*)(KERNEL_BOT - MAX_PROCESS * STACK_SIZE);
+    tasks = (kernel_tasks_t*)(KERNEL_BOT - MAX_TASKS * STACK_SIZE);
 
     //initialize task to off, prevents page faulting
-    for(i = 0; i < MAX_PROCESS; i++){
+    for(i = 0; i < MAX_TASKS; i++){
         tasks->task[i].in_use = OFF;
     }
 
-    tasks->task[0].proc.proc_id = 0;
+    for(i = 0; i < MAX_TERMINALS; i++){
+        tasks->task[i].proc.proc_id = TERM_ID(i);
+        tasks->task[i].proc.term = i;
+    }
 
     //initialize me_locs array to point to correct physical pages for processes
-    mem_locs[0] = TERMINAL0;
-    mem_locs[1] = TERMINAL1;
-    mem_locs[2] = TERMINAL2;
-    mem_locs[3] = PROCESS0;
-    mem_locs[4] = PROCESS1;
-    mem_locs[5] = PROCESS2;
+    for(i = 0, page = PROCESS_HIGH; i < MAX_PROCESS; i++){
+        if(i < LOW_SLOTS)
+            mem_locs[i] = low_pages[i];
+        else if(i >= MAX_TERMINALS && i < MAX_TERMINALS + LOW_SLOTS)
+            mem_locs[i] = low_pages[i - MAX_TERMINALS + LOW_SLOTS];
+        else{
+            mem_locs[i] = page;
+            page += PROG_PAGE;
+        }
+    }
 
     num_processes = 0;
+    session_count = 0;
 
-    //set first term
+    //set first term, the kernel executes its shell
     curr_terminal = SHELL0;
+    open_session(SHELL0);
 
-    //shell dirt flag means 1 for visited
+    //shell dirt flag means 1 for visited, the other terminals get their
+    //session on the first switch to them
     shell_dirty = 0x001;
-
-    //initialize other terminals
-    init_shell();
-    init_shell();
     setup = 0;
 }
 
 /* switch_terminal
 * input: shell to switch to
 * output: none
-* side effects: changes esp and ebp, changes backups in memory
-* description: the main function to switch a terminal.
-                  1) saves current terminal by backing up keyboard, video mem, coords
-                  2) saves esp and ebp for context switch
-                  3) opens up new terminal by loading latest backups from keybaord, video mem, coords
-                  4) loads in new esp and ebp for context switch
-                  5) changes paging
+* side effects: switches tasks
+* description: the main function to switch a terminal, runs in the worker
+                thread with interrupts on.
+                  1) makes the terminal's session the first time
+                  2) shows the new terminal's console, only rows it wrote
+                     while in the background are copied
+                  3) keys go to the new terminal's input from here on, each
+                     terminal keeps its own so nothing is copied
+                  4) tasks of the other terminals keep running in the
+                     background
 */
 
 void switch_terminal(int32_t shell){
 
+    uint32_t begin, end;
+    int32_t first;
+
     //error check
-    if(shell == curr_terminal || shell < SHELL0 || shell > SHELL2)
+    if(shell == curr_terminal || shell < SHELL0 || shell >= num_terminals)
       return;
 
-    //save video memory and cursor position of current task and keyboard
-    xcoord_backups[curr_terminal] = coordReturn(1);
-    ycoord_backups[curr_terminal] = coordReturn(0);
-    buff_idx_backups[curr_terminal] = get_buf_idx();
-    memcpy((void*)vid_backups[curr_terminal],(const void*)VIDEO,PG_SIZE);
-    memcpy((void*)buf_backups[curr_terminal],(const void*)line_char_buffer,BUFFER_MAX_INDEX+1);
-
-    //clear screen
-    clear();
-
-    //save pcb into backups
-    pcb_backups[curr_terminal] = curr_pcb;
-
-    //save esp and ebp into pcb
-    asm (
-        "movl %%ebp, %0"
-        :"=r"(curr_pcb->sched_ebp)
-      );
-    asm (
-        "movl %%esp, %0"
-        :"=r"(curr_pcb->sched_esp)
-      );
-
-    //update curr terminal
-    curr_terminal = shell;
+    asm volatile("rdtsc" : "=a"(begin) : : "edx");
+
+    //init_shell maps the new shell's page for a while and the keyboard and
+    //vidmap redraws must not run halfway through the screen copy
+    preempt_disable();
+    softirq_disable();
 
     //creating terminal for the first time
-    if(((0x1 << curr_terminal) & shell_dirty) == 0){
-      /*
-        asm (
-            "movl %%ebp, %0"
-            :"=r"(curr_pcb->sched_ebp)
-          );
-        asm (
-            "movl %%esp, %0"
-            :"=r"(curr_pcb->sched_esp)
-          );
-          */
- //       schedule_arr[curr_terminal] = &(tasks->task[curr_terminal].proc);
-
-        //update curr pcb
-        curr_pcb = &(tasks->task[curr_terminal].proc);
-        clear_buffer();
+    first = ((0x1 << shell) & shell_dirty) == 0;
+    if(first && open_session(shell) == -1){
+        softirq_enable();
+        preempt_enable();
+        return;
+    }
+
+    //update curr terminal, its console kept its screen and cursor
+    curr_terminal = shell;
+    screen_select(curr_terminal);
+    console_route(curr_terminal);
+
+    if(first){
+        clear();
         resetCursor();
         shell_dirty |= 0x1 << curr_terminal;
-        //allows for keyboard interrupts
-        sti();
-        //call execute for second shell and third shell
-        system_handler(SYS_EXECUTE,(uint32_t)"shell123",0,0);
+
+        //the shell only needs to be loaded and scheduled
+        init_shell(curr_terminal);
+        task_wake(&(tasks->task[curr_terminal].proc));
     }
 
-    //ELSE load video memory and cursor location and keyboard
-    else{
-      memcpy((void*)VIDEO,(const void*)vid_backups[curr_terminal],PG_SIZE);
-      memcpy((void*)line_char_buffer,(const void*)buf_backups[curr_terminal],BUFFER_MAX_INDEX+1);
-      set_buf_idx(buff_idx_backups[curr_terminal]);
-      placeCursor(xcoord_backups[curr_terminal],ycoord_backups[curr_terminal]);
-//      /*
-
-      //update curr pcb
-      curr_pcb = pcb_backups[curr_terminal];
-
-      //save tss vals
-      tss.esp0 = (uint32_t)(curr_pcb)+STACK_SIZE4;
-      tss.ss0 = KERNEL_DS;
-
-      //load new esp and ebp for context switch
-      asm (
-          "movl %0, %%ebp"
-          :
-          :"r"(curr_pcb->sched_ebp)
-        );
-      asm (
-            "movl %0, %%esp"
-            :
-            :"r"(curr_pcb->sched_esp)
-        );
-
-        //repage
-        page_directory[32] = mem_locs[curr_pcb->idx] | SURWON;
-        //flush tlb
-        asm volatile(
-            "movl %cr3,%eax \n \
-            movl %eax,%cr3"
-        );
+    asm volatile("rdtsc" : "=a"(end) : : "edx");
+    switch_cycles[switch_count % SWITCH_SAMPLES] = end - begin;
+    switch_count++;
 
-    }
+    softirq_enable();
+    preempt_enable();
 }
 
-/* demote_pcb_backup
-* input: shell, pcb to demote
+/* switch_terminal_later
+* input: shell to switch to
 * output: none
 * side effects: none
-* description: takes a pcb and creates the outermost process
+* description: Alt+Fn from the keyboard softirq, hands the switch to the
+                worker thread. Presses that come faster than it switches
+                only leave the latest one queued.
 */
 
-void demote_pcb_backup(int32_t shell, process_control_block_t* pcb){
-    pcb_backups[shell] = pcb;
+void switch_terminal_later(int32_t shell){
+    work_queue(&switch_work, switch_work_fn, shell);
+}
+
+/* kthread_create
+* input: function the thread runs, it never returns
+* output: the thread's pcb, NULL if every kernel thread slot is taken
+* side effects: makes the thread runnable
+* description: kernel threads take the slots after the user threads and only
+                run in the kernel on their own stack. They have no page of
+                their own and run in whichever process page was mapped before
+                them.
+*/
+
+process_control_block_t* kthread_create(void (*fn)(void)){
+    uint32_t flags;
+    int32_t i;
+    task_stack_t *kthread;
+
+    cli_and_save(flags);
+
+    for(i = KTHREAD_SLOT; i < MAX_TASKS; i++){
+        if(tasks->task[i].in_use == OFF)
+            break;
+    }
+    if(i == MAX_TASKS){
+        restore_flags(flags);
+        return NULL;
+    }
+    kthread = &tasks->task[i];
+    kthread->in_use = ON;
+
+    kthread->proc.proc_id = TERM_ID(SHELL0);
+    kthread->proc.term = SHELL0;
+    kthread->proc.parent_proc_id = TERM_ID(SHELL0);
+    kthread->proc.parent_pcb = NULL;
+    kthread->proc.idx = KTHREAD_IDX;
+    kthread->proc.slot = i;
+    kthread->proc.leader = &kthread->proc;
+    kthread->proc.fd_table = kthread->proc.file_arr;
+    kthread->proc.tls_base = 0;
+    kthread->proc.wait_chan = 0;
+    kthread->proc.detached = 1;
+    kthread->proc.ipc_state = IPC_NONE;
+    kthread->proc.ipc_peer = 0;
+    kthread->proc.sig_pending = 0;
+    kthread->proc.sig_masked = 0;
+    kthread->proc.alarm_period = 0;
+    kthread->proc.sleep_timer.pending = 0;
+    kthread->proc.alarm_timer.pending = 0;
+    kthread->proc.rt_period = 0;
+    kthread->proc.rt_timer.pending = 0;
+    kthread->proc.arguments[0] = '\0';
+    for(i = 0; i < MAX_FD; i++)
+        kthread->proc.file_arr[i].flags = OFF;
+    for(i = 0; i < SHM_WINDOW; i++)
+        kthread->proc.shm_map[i] = SHM_NONE;
+
+    task_init_kstack(&kthread->proc, fn);
+    task_wake(&kthread->proc);
+
+    restore_flags(flags);
+    return &kthread->proc;
+}
+
+/* open_session
+* input: terminal used for the first time
+* output: 0 on success, -1 if the kernel heap is out of room
+* side effects: none
+* description: terminals are made lazily, this allocates the console and
+                input buffers and records how much heap they took
+*/
+static int32_t open_session(int32_t term){
+    uint32_t before = kmem_used();
+
+    if(console_create(term) == -1 || keyboard_session(term) == -1)
+        return -1;
+
+    session_bytes = kmem_used() - before;
+    session_count++;
+    return 0;
+}
+
+/* kill_threads
+* input: leader of a thread group
+* output: none
+* side effects: frees kernel stacks
+* description: drops every thread of a process that is halting, none of them
+                can be running since the leader is
+*/
+
+void kill_threads(process_control_block_t* leader){
+    int32_t i;
+    for(i = MAX_PROCESS; i < KTHREAD_SLOT; i++){
+        if(tasks->task[i].in_use == ON && tasks->task[i].proc.leader == leader){
+            ipc_abort(&tasks->task[i].proc);
+            timer_cancel(&tasks->task[i].proc.sleep_timer);
+            rt_set(&tasks->task[i].proc, 0, 0);
+            tasks->task[i].in_use = OFF;
+            schedule_arr[i] = NULL;
+        }
+    }
+}
+
+/* switch_work_fn
+* input: shell to switch to
+* output: none
+* side effects: switches terminals
+* description: worker job of switch_terminal_later
+*/
+static void switch_work_fn(uint32_t data){
+    switch_terminal(data);
 }
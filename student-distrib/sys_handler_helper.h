@@ -11,16 +11,25 @@
 #include "i8259.h"
 
 #define SHELL0 0
-#define SHELL1 1
-#define SHELL2 2
-#define NUM_TERMINALS 3
+//terminals when the boot command line has no consoles=
+#define DEFAULT_TERMINALS 3
+//root shells and children that keep the program pages below the shm segments
+#define LOW_SLOTS 3
 #define USER_PROG 32
 #define PG_SIZE 4096
+#define SWITCH_SAMPLES 16
+
+extern uint32_t switch_cycles[SWITCH_SAMPLES];
+extern uint32_t switch_count;
+extern uint32_t session_bytes;
+extern uint32_t session_count;
 
 
 void init_kernel_memory();
-void init_shell();
+void init_shell(int32_t term);
 void switch_terminal(int32_t shell);
-void demote_pcb_backup(int32_t shell,process_control_block_t* pcb);
+void switch_terminal_later(int32_t shell);
+process_control_block_t* kthread_create(void (*fn)(void));
+void kill_threads(process_control_block_t* leader);
 
 #endif
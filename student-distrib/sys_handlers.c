@@ -1,7 +1,21 @@
 #include "sys_handlers.h"
 #include "x86_desc.h"
-
-static int32_t halt(uint8_t status);
+#include "pipe.h"
+#include "shm.h"
+#include "ipc.h"
+#include "signal.h"
+#include "kmem.h"
+#include "clock.h"
+#include "softirq.h"
+#include "lathist.h"
+#include "profile.h"
+#include "trace.h"
+
+//the build stops here when the size comments in sys_handlers.h go stale
+typedef char fd_size_check[(sizeof(file_descriptor_structure_t) == 20) ? 1 : -1];
+typedef char pcb_size_check[(sizeof(process_control_block_t) == 548) ? 1 : -1];
+
+static int32_t halt(uint32_t status);
 static int32_t execute(const uint8_t* command);
 static int32_t read(int32_t fd, void* buf, int32_t nbytes);
 static int32_t write(int32_t fd, const void* buf, int32_t nbytes);
@@ -11,16 +25,60 @@ static int32_t getargs(uint8_t* buf, int32_t nbytes);
 static int32_t vidmap(uint8_t** screen_start);
 static int32_t set_handler(int32_t signum, void* handler_address);
 static int32_t sigreturn(void);
+static int32_t alarm(int32_t period_ms);
+static int32_t waitpid(int32_t pid, int32_t* status, int32_t options);
+static int32_t kstat(int32_t which, uint32_t* buf, int32_t n);
+static int32_t ioctl(int32_t fd, int32_t request, int32_t arg);
+static int32_t gettime(int32_t clock, timespec_t* ts);
+static int32_t sleep(uint32_t ns_lo, uint32_t ns_hi);
+static int32_t sched_rt(uint32_t period_us, uint32_t budget_us);
+static void sleep_expired(uint32_t data);
+static void release_children(process_control_block_t* pcb);
+static int32_t copy_samples(uint32_t* buf, int32_t n, const uint32_t* ring, uint32_t count, int32_t size);
+static int32_t thread_create(uint32_t start, uint32_t entry, uint32_t arg);
+static int32_t futex(uint32_t* addr, int32_t op, int32_t val);
+static int32_t pipe(int32_t* fds, int32_t size);
+static int32_t dup2(int32_t oldfd, int32_t newfd);
+static int32_t spawn(const uint8_t* command);
+static int32_t poll(pollfd_t* fds, int32_t nfds, int32_t timeout);
+static int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg);
+static uint32_t futex_key(uint32_t addr);
+static int32_t shm_create(const uint8_t* name, int32_t size);
+static int32_t shm_map(int32_t id, void* addr);
+static int32_t shm_unmap(void* addr);
+static int32_t parse_command(const uint8_t* command, int8_t* cmd);
+static int32_t alloc_process(void);
+static void copy_args(task_stack_t* process, const uint8_t* args);
+static int32_t load_program(task_stack_t* process, int32_t process_idx, const int8_t* cmd, uint32_t* eip_val);
+static void init_process(task_stack_t* process, process_control_block_t* parent);
+static void release_fd(int32_t fd);
+static void fd_ref(file_descriptor_structure_t* file);
+static int32_t syscall_dispatch(uint32_t instr, uint32_t arg0, uint32_t arg1, uint32_t arg2);
 
 
 
 /* system_handler
  *
- * DESCRIPTION: INT 80 was invoked
+ * DESCRIPTION: INT 80 was invoked, traces the call around running it
  * INPUT/OUTPUT: arguments passed in through registers eax,ebx,ecx,edx
  * SIDE EFFECTS: none
  */
 int32_t system_handler(uint32_t instr, uint32_t arg0, uint32_t arg1, uint32_t arg2){
+    int32_t ret;
+
+    TRACE_EVENT(TR_SYSCALL, instr, arg0, arg1, arg2);
+    ret = syscall_dispatch(instr, arg0, arg1, arg2);
+    TRACE_EVENT(TR_SYSRET, instr, ret, 0, 0);
+    return ret;
+}
+
+/* syscall_dispatch
+ *
+ * DESCRIPTION: runs system call instr
+ * INPUT/OUTPUT: arguments passed in through registers eax,ebx,ecx,edx
+ * SIDE EFFECTS: none
+ */
+static int32_t syscall_dispatch(uint32_t instr, uint32_t arg0, uint32_t arg1, uint32_t arg2){
     /*uint32_t instr,arg0,arg1,arg2;
     asm ("movl %%eax,%0":"=r"(instr));
     asm ("movl %%ebx,%0":"=r"(arg0));
@@ -57,19 +115,86 @@ int32_t system_handler(uint32_t instr, uint32_t arg0, uint32_t arg1, uint32_t ar
     else if(instr == SYS_SIGRETURN){
         return sigreturn();
     }
+    else if(instr == SYS_THREAD_CREATE){
+        return thread_create(arg0,arg1,arg2);
+    }
+    else if(instr == SYS_FUTEX){
+        return futex((uint32_t*)arg0,(int32_t)arg1,(int32_t)arg2);
+    }
+    else if(instr == SYS_PIPE){
+        return pipe((int32_t*)arg0,(int32_t)arg1);
+    }
+    else if(instr == SYS_DUP2){
+        return dup2((int32_t)arg0,(int32_t)arg1);
+    }
+    else if(instr == SYS_SPAWN){
+        return spawn((const uint8_t*)arg0);
+    }
+    else if(instr == SYS_SHM_CREATE){
+        return shm_create((const uint8_t*)arg0,(int32_t)arg1);
+    }
+    else if(instr == SYS_SHM_MAP){
+        return shm_map((int32_t)arg0,(void*)arg1);
+    }
+    else if(instr == SYS_SHM_UNMAP){
+        return shm_unmap((void*)arg0);
+    }
+    else if(instr == SYS_IPC_CALL){
+        return ipc_call((int32_t)arg0);
+    }
+    else if(instr == SYS_IPC_REPLY_WAIT){
+        return ipc_reply_wait((int32_t)arg0);
+    }
+    else if(instr == SYS_POLL){
+        return poll((pollfd_t*)arg0,(int32_t)arg1,(int32_t)arg2);
+    }
+    else if(instr == SYS_FCNTL){
+        return fcntl((int32_t)arg0,(int32_t)arg1,(int32_t)arg2);
+    }
+    else if(instr == SYS_ALARM){
+        return alarm((int32_t)arg0);
+    }
+    else if(instr == SYS_WAITPID){
+        return waitpid((int32_t)arg0,(int32_t*)arg1,(int32_t)arg2);
+    }
+    else if(instr == SYS_KSTAT){
+        return kstat((int32_t)arg0,(uint32_t*)arg1,(int32_t)arg2);
+    }
+    else if(instr == SYS_IOCTL){
+        return ioctl((int32_t)arg0,(int32_t)arg1,(int32_t)arg2);
+    }
+    else if(instr == SYS_GETTIME){
+        return gettime((int32_t)arg0,(timespec_t*)arg1);
+    }
+    else if(instr == SYS_SLEEP){
+        return sleep(arg0,arg1);
+    }
+    else if(instr == SYS_SCHED_RT){
+        return sched_rt(arg0,arg1);
+    }
+    else if(instr == SYS_LATHIST){
+        return lathist((int32_t)arg0,(uint32_t*)arg1,(int32_t)arg2);
+    }
+    else if(instr == SYS_PROFILE){
+        return profile(arg0);
+    }
+    else if(instr == SYS_TRACE){
+        return trace((int32_t)arg0);
+    }
     return -1;
 }
 
 /* halt
  *
  * DESCRIPTION: Stops the current process
- * INPUT/OUTPUT: uint8_t status
+ * INPUT/OUTPUT: uint32_t status - 0-255, or EXCEPTION_STATUS when killed
  * SIDE EFFECTS: Decreases number of processes run, if at minimun number, restart shell
  */
-int32_t halt(uint8_t status){
+int32_t halt(uint32_t status){
 
     uint32_t flags;
     cli_and_save(flags);
+    TRACE_EVENT(TR_HALT, status, 0, 0, 0);
 
     uint32_t i;
 
@@ -82,7 +207,66 @@ int32_t halt(uint8_t status){
       }
   }*/
 
-    if (curr_pcb->proc_id == TERM0ID || curr_pcb->proc_id == TERM1ID || curr_pcb->proc_id == TERM2ID)
+    //a thread only gives back its kernel stack
+    if(curr_pcb->leader != curr_pcb){
+        ipc_abort(curr_pcb);
+        rt_set(curr_pcb, 0, 0);
+        ((task_stack_t*)curr_pcb)->in_use = OFF;
+        schedule_arr[curr_pcb->slot] = NULL;
+        schedule();
+        //never switched back to
+    }
+
+    //threads die with their process
+    kill_threads(curr_pcb);
+    shm_release(curr_pcb);
+    ipc_abort(curr_pcb);
+
+    // close every fd, stdin and stdout too so pipe readers see EOF
+    for (i = 0; i < MAX_FD; i++) {
+        if (curr_pcb->fd_table[i].flags != 0) {
+            release_fd(i);
+        }
+    }
+
+    //a raw or cbreak keyboard goes back to lines
+    keyboard_release(curr_pcb);
+
+    alarm_set(curr_pcb, 0);
+    rt_set(curr_pcb, 0, 0);
+
+    //nothing may write into the screen through the vidmap page from here
+    curr_pcb->vid_page = 0;
+    vidmap_load(curr_pcb);
+    asm volatile(
+        "movl %cr3,%eax \n \
+        movl %eax,%cr3"
+    );
+
+    //spawned children don't die with us
+    release_children(curr_pcb);
+
+    //a spawned process keeps its slot until waitpid collects the status,
+    //unless its parent is already gone
+    if(curr_pcb->detached){
+        schedule_arr[curr_pcb->slot] = NULL;
+        if(curr_pcb->parent_pcb == NULL){
+            ((task_stack_t*)curr_pcb)->in_use = OFF;
+            num_processes--;
+        }
+        else{
+            curr_pcb->exit_status = status;
+            ((task_stack_t*)curr_pcb)->in_use = ZOMBIE;
+            wake_up((uint32_t)curr_pcb->parent_pcb);
+        }
+        schedule();
+        //never switched back to
+    }
+
+    //drawing through vidmap ends with the process
+    screen_unmap();
+
+    if (ROOT_SHELL(curr_pcb))
     {
         // restart shell
         printf("Restarting shell...\n");
@@ -91,7 +275,9 @@ int32_t halt(uint8_t status){
 
 
     //add parent process to scheduler
-    schedule_arr[curr_pcb->proc_id/4] = curr_pcb->parent_pcb;
+    schedule_arr[curr_pcb->slot] = NULL;
+    schedule_arr[curr_pcb->parent_pcb->slot] = curr_pcb->parent_pcb;
+    curr = curr_pcb->parent_pcb->slot;
 
     //cli();
 
@@ -112,6 +298,8 @@ int32_t halt(uint8_t status){
     //restore parent paging
     int32_t proc_idx = curr_pcb->parent_pcb->idx;
     page_directory[32] = mem_locs[proc_idx] | SURWON;
+    shm_load(curr_pcb->parent_pcb);
+    vidmap_load(curr_pcb->parent_pcb);
 
     //flush tlb
     asm volatile(
@@ -119,20 +307,11 @@ int32_t halt(uint8_t status){
         movl %eax,%cr3"
     );
 
-    // change all fd flags to 0
-    for (i = 2; i < MAX_FD; i++) {
-        if (curr_pcb->file_arr[i].flags != 0) {
-            close(i);
-        }
-    }
-
    //sti();
    asm volatile(
        "movl %0, %%eax \n \
        addl $-4,%%eax \n \
-       xorl %%ebx, %%ebx \n \
-       movb %1, %%bl \n \
-       movl %%ebx,(%%eax)"
+       movl %1,(%%eax)"
        :
        :"r"(curr_pcb->parent_ebp),"r"(status)
        :"%eax"
@@ -152,7 +331,7 @@ int32_t halt(uint8_t status){
 
     //reset pcb pointer
     curr_pcb = curr_pcb->parent_pcb;
-    demote_pcb_backup(curr_pcb->proc_id/4,curr_pcb);
+    set_tls(curr_pcb->tls_base);
 
     restore_flags(flags);
 
@@ -167,7 +346,8 @@ int32_t halt(uint8_t status){
  *
  * DESCRIPTION: Creates a new process based off command given
  * INPUT/OUTPUT: const uint8_t* command
- *               Returns -1 if can't create, 0-255 if user halts,
+ *               Returns -1 if can't create or the caller is not a
+ *               process's main thread, 0-255 if user halts,
  *               256 if exception is thrown
  * SIDE EFFECTS: Creates a new process, changes paging
  */
@@ -183,14 +363,10 @@ int32_t execute(const uint8_t* command){
 
     //command line buffer
     int8_t cmd[CMD_BUF];
-    int8_t exe[BUF4];
-    int8_t entry[BUF4];
-    dentry_t d;
-    int32_t length = 0;
     int32_t process_idx;
-    int32_t i = 0, j;
     int32_t restart = 0;
     int32_t begin_args;
+    uint32_t eip_val;
 
     //check for restart command
     if(strncmp((int8_t*)command,"shell123",RESTART_SIZE) == 0){
@@ -203,108 +379,53 @@ int32_t execute(const uint8_t* command){
         cmd[5] = '\0';
         begin_args = 5;
         restart = 1;
-        curr_pcb = &(tasks->task[curr_terminal].proc);
+        curr_pcb = &(tasks->task[curr_pcb->term].proc);
     }
 
-    //limit number of processes written
-    if(num_processes == MAX_PROCESS){
-        printf("Max processes already running\n");
+    //the child would wait on the thread, whose stack kill_threads frees
+    //when the leader halts, so only the main thread may execute
+    if(setup && !restart && curr_pcb != curr_pcb->leader){
         restore_flags(flags);
         return -1;
     }
-    num_processes++;
-
-
-    /*--------------
-    PARSE ARGUMENT
-    ----------------*/
-    if(!restart){
-        while(((int8_t)command[i] != ' ') && ((int8_t)command[i] != '\0') && ((int8_t)command[i] != '\n')){
-            cmd[i] = command[i];
-            i++;
-        }
-          cmd[i] = '\0';
-          begin_args = i;
-    }
 
     //get crrent process
     task_stack_t *process;
     if(restart){
         //curr_pcb is already set
         process_idx = curr_pcb->idx;
-        process = &tasks->task[process_idx];
+    }
+    else if(!setup){
+        //the kernel starts terminal 0's shell
+        process_idx = SHELL0;
+        tasks->task[process_idx].in_use = ON;
     }
     else{
         //find an open task and fill it with process
-        for(i = 0; i < MAX_PROCESS; i++){
-            if(tasks->task[i].in_use == OFF){
-               tasks->task[i].in_use = ON;
-               process = &tasks->task[i];
-               process_idx = i;
-               break;
-            }
-        }
-    }
-
-    //copy arguments of the command into the argument pcb buffer
-    strncpy(process->proc.arguments,(const int8_t*)(command+begin_args+1),BUFFER_SIZE);
-    j = 0;
-    //find end of line character
-    while(process->proc.arguments[j] != '\0' && process->proc.arguments[j] != '\n'){
-        j++;
-    }
-    process->proc.arguments[j] = '\0';
-
-    //read in dentry
-    if(dread(cmd,&d) == -1 || d.ftype != FILE_TYPE){
-        num_processes--;
-        tasks->task[process_idx].in_use = OFF;
-        restore_flags(flags);
-        return -1;
-    }
-    //read in 4 bytes to check if executable
-    if(fread(d.inode_num,0,exe,BUF4) != BUF4){
-        num_processes--;
-        tasks->task[process_idx].in_use = OFF;
-        restore_flags(flags);
-        return -1;
+        process_idx = alloc_process();
     }
 
-
-    /*--------------
-    CHECK FILE VALIDITY
-    ----------------*/
-    if(exe[0] != EXE0 || exe[1] != EXE1 || exe[2] != EXE2 || exe[3] != EXE3){
-        num_processes--;
-        tasks->task[process_idx].in_use = OFF;
+    //limit number of processes written
+    if(process_idx == -1){
+        printf("Max processes already running\n");
         restore_flags(flags);
         return -1;
     }
-
-    //get entry point to user level program from bytes 24-27 of executable file
-    fread(d.inode_num,ENTRY_OFF,entry,BUF4);
-    //uint32_t eip_val = 0;
-    uint32_t eip_val = *((uint32_t*)entry);
+    num_processes++;
+    process = &tasks->task[process_idx];
 
 
     /*--------------
-    SETUP PAGING
+    PARSE ARGUMENT
     ----------------*/
-    page_directory[32] = mem_locs[process_idx] | SURWON;
-    process->proc.idx = process_idx;
+    if(!restart)
+        begin_args = parse_command(command,cmd);
 
+    //copy arguments of the command into the argument pcb buffer
+    copy_args(process,command+begin_args);
 
-    //flush tlb
-    asm volatile(
-        "movl %cr3, %eax \n \
-        movl %eax, %cr3");
-
-    /*-------------------
-    LOAD FILE INTO MEMORY
-    ---------------------*/
-    length = get_length(d.inode_num);
-    int8_t *prog_ptr = (int8_t*)USER_ENTRY;
-    if(fread(d.inode_num,0,prog_ptr,length) != length){
+    //check the file, map its page and load it
+    if(load_program(process,process_idx,cmd,&eip_val) == -1){
         num_processes--;
         tasks->task[process_idx].in_use = OFF;
         restore_flags(flags);
@@ -316,31 +437,27 @@ int32_t execute(const uint8_t* command){
     CREATE NEW PCB
     ---------------*/
 
-    //fill in child pcb
-    if(num_processes > 3 && !restart){
-        process->proc.parent_pcb = curr_pcb;
-        process->proc.parent_proc_id = curr_pcb->proc_id;
+    //fill in child pcb, root shells have no parent
+    if(process_idx >= MAX_TERMINALS){
+        init_process(process,curr_pcb);
         process->proc.parent_esp0 = tss.esp0;
         process->proc.parent_ss0 = tss.ss0;
-        process->proc.proc_id = curr_pcb->proc_id + 1;
-    }
-
-
-
-    /*-----------------
-    OPEN RELEVANT FD'S
-    -------------------*/
-    //open stdin
-    process->proc.file_arr[0].flags = ON;
-    process->proc.file_arr[0].table = keyboard_driver;
 
-    //open stdout
-    process->proc.file_arr[1].flags = ON;
-    process->proc.file_arr[1].table = terminal_driver;
+        //parent sleeps in execute until the child halts
+        schedule_arr[curr_pcb->slot] = NULL;
+    }
+    else{
+        init_process(process,NULL);
+    }
+    TRACE_EVENT(TR_EXEC, process_idx, process->proc.proc_id,
+                ((uint32_t*)process->proc.name)[0], ((uint32_t*)process->proc.name)[1]);
 
-    //initialize "in use" flags to 0
-    for(j=2; j<MAX_FD; j++)
-        process->proc.file_arr[j].flags = OFF;
+    //the child starts without the parent's shared memory
+    shm_load(&(process->proc));
+    vidmap_load(&(process->proc));
+    asm volatile(
+        "movl %cr3, %eax \n \
+        movl %eax, %cr3");
 
     //set curr_pcb
     curr_pcb = &(process->proc);
@@ -349,23 +466,10 @@ int32_t execute(const uint8_t* command){
     tss.esp0 = (uint32_t)process + STACK_SIZE4;
     tss.ss0 = KERNEL_DS;
 
-    //add process to be scheduled and remove parent
-    curr = curr_pcb->proc_id/4;
+    //add process to be scheduled
+    curr = process_idx;
     schedule_arr[curr] = curr_pcb;
-    new_process[curr] = 1;
-    /*
-    if(curr_pcb->proc_id != 0 && curr_pcb->proc_id != 4 && curr_pcb->proc_id != 8){
-        for(i = 0; i < 3; i++){
-            if(schedule_arr[i] == curr_pcb->parent_pcb){
-                schedule_arr[i] = curr_pcb;
-                break;
-            }
-        }
-    }
-    else{
-        schedule_arr[curr_pcb->proc_id/4] = curr_pcb;
-    }
-    */
+    set_tls(curr_pcb->tls_base);
     //save current esp and ebp to pcb
     asm volatile(
         "movl %%ebp, %0 \n \
@@ -380,12 +484,9 @@ int32_t execute(const uint8_t* command){
     PUSH IRET CONTEXT TO STACK
     AND CALL IRET
     ----------------------------*/
-    restore_flags(flags);
+    //interrupts stay off until the iret, which turns them back on
     setup = 1;
-    //turn on interrupts if its a restart
-    if(restart){
-      sti();
-    }
+    TRACE_IRQS_ON();
 
     asm volatile(
           "switch: \n \
@@ -393,6 +494,7 @@ int32_t execute(const uint8_t* command){
           pushl %eax \n \
           pushl $0x83FFFFF \n \
           pushfl \n \
+          orl $0x200, (%esp) \n \
           pushl $0x23"
     );
 
@@ -411,6 +513,202 @@ int32_t execute(const uint8_t* command){
     return 0;
 }
 
+/* parse_command
+ *
+ * DESCRIPTION: copies the program name out of a command line
+ * INPUT/OUTPUT: const uint8_t* command
+ *               int8_t* cmd - CMD_BUF sized buffer for the name
+ *               returns index in command where the arguments begin
+ * SIDE EFFECTS: none
+ */
+static int32_t parse_command(const uint8_t* command, int8_t* cmd){
+    int32_t i = 0;
+    while(i < CMD_BUF - 1 && ((int8_t)command[i] != ' ') && ((int8_t)command[i] != '\0') && ((int8_t)command[i] != '\n')){
+        cmd[i] = command[i];
+        i++;
+    }
+    cmd[i] = '\0';
+    return i;
+}
+
+/* alloc_process
+ *
+ * DESCRIPTION: takes a free process slot for a child, the first
+ *              MAX_TERMINALS slots belong to the root shells
+ * INPUT/OUTPUT: returns index of the slot, -1 if all are in use
+ * SIDE EFFECTS: marks the slot in use
+ */
+static int32_t alloc_process(void){
+    int32_t i;
+    for(i = MAX_TERMINALS; i < MAX_PROCESS; i++){
+        if(tasks->task[i].in_use == OFF){
+           tasks->task[i].in_use = ON;
+           return i;
+        }
+    }
+    return -1;
+}
+
+/* copy_args
+ *
+ * DESCRIPTION: copies everything after the program name into the pcb
+ * INPUT/OUTPUT: task_stack_t* process
+ *               const uint8_t* args - command line at the end of the name
+ * SIDE EFFECTS: none
+ */
+static void copy_args(task_stack_t* process, const uint8_t* args){
+    int32_t j = 0;
+
+    //no arguments, don't read past the end of the command
+    if((int8_t)args[0] != ' '){
+        process->proc.arguments[0] = '\0';
+        return;
+    }
+
+    strncpy(process->proc.arguments,(const int8_t*)(args+1),BUFFER_SIZE);
+    //find end of line character
+    while(process->proc.arguments[j] != '\0' && process->proc.arguments[j] != '\n'){
+        j++;
+    }
+    process->proc.arguments[j] = '\0';
+}
+
+/* load_program
+ *
+ * DESCRIPTION: checks that cmd is an executable, maps the page of the slot
+ *              and copies the file in
+ * INPUT/OUTPUT: task_stack_t* process, int32_t process_idx
+ *               const int8_t* cmd - file name
+ *               uint32_t* eip_val - gets the entry point
+ *               returns -1 if cmd is not an executable, 0 otherwise
+ * SIDE EFFECTS: leaves the new page mapped on success
+ */
+static int32_t load_program(task_stack_t* process, int32_t process_idx, const int8_t* cmd, uint32_t* eip_val){
+    int8_t exe[BUF4];
+    int8_t entry[BUF4];
+    dentry_t d;
+    int32_t length;
+
+    //read in dentry
+    if(dread(cmd,&d) == -1 || d.ftype != FILE_TYPE)
+        return -1;
+    //read in 4 bytes to check if executable
+    if(fread(d.inode_num,0,exe,BUF4) != BUF4)
+        return -1;
+
+
+    /*--------------
+    CHECK FILE VALIDITY
+    ----------------*/
+    if(exe[0] != EXE0 || exe[1] != EXE1 || exe[2] != EXE2 || exe[3] != EXE3)
+        return -1;
+
+    //get entry point to user level program from bytes 24-27 of executable file
+    fread(d.inode_num,ENTRY_OFF,entry,BUF4);
+    *eip_val = *((uint32_t*)entry);
+
+
+    /*--------------
+    SETUP PAGING
+    ----------------*/
+    page_directory[USER_PROG] = mem_locs[process_idx] | SURWON;
+    process->proc.idx = process_idx;
+    process->proc.slot = process_idx;
+    strncpy(process->proc.name, cmd, PROG_NAME - 1);
+    process->proc.name[PROG_NAME - 1] = '\0';
+
+
+    //flush tlb
+    asm volatile(
+        "movl %cr3, %eax \n \
+        movl %eax, %cr3");
+
+    /*-------------------
+    LOAD FILE INTO MEMORY
+    ---------------------*/
+    length = get_length(d.inode_num);
+    int8_t *prog_ptr = (int8_t*)USER_ENTRY;
+    if(fread(d.inode_num,0,prog_ptr,length) != length){
+        //give the caller its page back
+        page_directory[USER_PROG] = mem_locs[curr_pcb->idx] | SURWON;
+        asm volatile(
+            "movl %cr3, %eax \n \
+            movl %eax, %cr3");
+        return -1;
+    }
+    return 0;
+}
+
+/* init_process
+ *
+ * DESCRIPTION: fills in the pcb of a freshly loaded process
+ * INPUT/OUTPUT: task_stack_t* process
+ *               process_control_block_t* parent - NULL for a root shell
+ * SIDE EFFECTS: a child shares its parent's stdin and stdout, everyone else
+ *               starts on the keyboard and terminal
+ */
+static void init_process(task_stack_t* process, process_control_block_t* parent){
+    int32_t j;
+
+    if(parent != NULL){
+        process->proc.parent_pcb = parent;
+        process->proc.parent_proc_id = parent->proc_id;
+        process->proc.proc_id = parent->proc_id + 1;
+        process->proc.term = parent->term;
+    }
+    else{
+        process->proc.term = process->proc.slot;
+    }
+
+    //a process is the leader of its own thread group
+    process->proc.leader = &(process->proc);
+    process->proc.fd_table = process->proc.file_arr;
+    process->proc.tls_base = USER_STACK_TOP - THREAD_STACK_SIZE;
+    process->proc.wait_chan = 0;
+    process->proc.detached = 0;
+    process->proc.ipc_state = IPC_NONE;
+    process->proc.ipc_peer = 0;
+    for(j = 0; j < SHM_WINDOW; j++)
+        process->proc.shm_map[j] = SHM_NONE;
+    process->proc.vid_page = 0;
+    for(j = 0; j < NUM_SIGNALS; j++)
+        process->proc.sig_handler[j] = NULL;
+    process->proc.sig_pending = 0;
+    process->proc.sig_masked = 0;
+    process->proc.sleep_timer.pending = 0;
+    process->proc.alarm_timer.pending = 0;
+    process->proc.rt_period = 0;
+    process->proc.rt_timer.pending = 0;
+    alarm_set(&process->proc, ALARM_MS);
+
+
+    /*-----------------
+    OPEN RELEVANT FD'S
+    -------------------*/
+    if(parent != NULL){
+        //inherit stdin and stdout, they may be pipes
+        for(j = 0; j < 2; j++){
+            process->proc.file_arr[j] = parent->fd_table[j];
+            fd_ref(&process->proc.file_arr[j]);
+        }
+    }
+    else{
+        //open stdin
+        process->proc.file_arr[0].flags = ON;
+        process->proc.file_arr[0].mode = 0;
+        process->proc.file_arr[0].table = keyboard_driver;
+
+        //open stdout
+        process->proc.file_arr[1].flags = ON;
+        process->proc.file_arr[1].mode = 0;
+        process->proc.file_arr[1].table = terminal_driver;
+    }
+
+    //initialize "in use" flags to 0
+    for(j=2; j<MAX_FD; j++)
+        process->proc.file_arr[j].flags = OFF;
+}
+
 /* read
  *
  * DESCRIPTION: reads into buffer
@@ -421,11 +719,11 @@ int32_t execute(const uint8_t* command){
  * SIDE EFFECTS: fills in buffer that was passed in
  */
 int32_t read(int32_t fd, void* buf, int32_t nbytes){
-    if(fd < 0 || fd >= MAX_FD || curr_pcb->file_arr[fd].flags == OFF)
+    if(fd < 0 || fd >= MAX_FD || curr_pcb->fd_table[fd].flags == OFF)
         return -1;
     if(buf == NULL)
         return -1;
-    return curr_pcb->file_arr[fd].table(READ,fd,buf,nbytes);
+    return curr_pcb->fd_table[fd].table(READ,fd,buf,nbytes);
 }
 
 /* write
@@ -438,11 +736,11 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes){
  * SIDE EFFECTS: none
  */
 int32_t write(int32_t fd, const void* buf, int32_t nbytes){
-    if(fd < 0 || fd >= MAX_FD || curr_pcb->file_arr[fd].flags == OFF)
+    if(fd < 0 || fd >= MAX_FD || curr_pcb->fd_table[fd].flags == OFF)
         return -1;
     if(buf == NULL)
       return -1;
-    return curr_pcb->file_arr[fd].table(WRITE,fd,(void*)buf,nbytes);
+    return curr_pcb->fd_table[fd].table(WRITE,fd,(void*)buf,nbytes);
 }
 
 /* open
@@ -453,34 +751,39 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes){
  */
 int32_t open(const uint8_t* filename){
     int32_t i;
+    uint32_t flags;
     dentry_t d;
     if(dread((const int8_t*)filename,&d) == -1)
         return -1;
+    //threads share the fd table, claim the slot with interrupts off
+    cli_and_save(flags);
     for(i = 2; i < MAX_FD; i++){
-        if(curr_pcb->file_arr[i].flags == OFF){
-            curr_pcb->file_arr[i].flags = ON;
-            curr_pcb->file_arr[i].inode = d.inode_num;
-            curr_pcb->file_arr[i].position = 0;
+        if(curr_pcb->fd_table[i].flags == OFF){
+            curr_pcb->fd_table[i].flags = ON;
+            curr_pcb->fd_table[i].inode = d.inode_num;
+            curr_pcb->fd_table[i].position = 0;
+            curr_pcb->fd_table[i].mode = 0;
             //file is rtc
             if(d.ftype == RTC_TYPE)
-                curr_pcb->file_arr[i].table = rtc_driver;
+                curr_pcb->fd_table[i].table = rtc_driver;
             //file is directory
             else if(d.ftype == DIR_TYPE){
-                curr_pcb->file_arr[i].position = get_idx(d.inode_num);
-                curr_pcb->file_arr[i].table = d_driver;
-                curr_pcb->file_arr[i].flags = DIRECTORY;
+                curr_pcb->fd_table[i].position = get_idx(d.inode_num);
+                curr_pcb->fd_table[i].table = d_driver;
+                curr_pcb->fd_table[i].flags = DIRECTORY;
             }
             //file is file
             else if(d.ftype == FILE_TYPE)
-                curr_pcb->file_arr[i].table = f_driver;
+                curr_pcb->fd_table[i].table = f_driver;
 
             break;
         }
     }
+    restore_flags(flags);
     if(i == MAX_FD)
         return -1;
     //call specific open
-    curr_pcb->file_arr[i].table(OPEN,i,NULL,-1);
+    curr_pcb->fd_table[i].table(OPEN,i,NULL,-1);
     //return fd
     return i;
 }
@@ -494,14 +797,38 @@ int32_t open(const uint8_t* filename){
  */
 int32_t close(int32_t fd){
     //invalid fd
-    if(fd < 2 || fd >= MAX_FD || curr_pcb->file_arr[fd].flags == OFF)
+    if(fd < 2 || fd >= MAX_FD || curr_pcb->fd_table[fd].flags == OFF)
         return -1;
+    release_fd(fd);
+
+    return 0;
+}
+
+/* release_fd
+ *
+ * DESCRIPTION: closes any open fd, stdin and stdout included
+ * INPUT/OUTPUT: int32_t fd
+ * SIDE EFFECTS: none
+ */
+static void release_fd(int32_t fd){
     //call specific close
-    curr_pcb->file_arr[fd].table(CLOSE,fd,NULL,-1);
+    curr_pcb->fd_table[fd].table(CLOSE,fd,NULL,-1);
     //mark as empty
-    curr_pcb->file_arr[fd].flags = OFF;
+    curr_pcb->fd_table[fd].flags = OFF;
+}
 
-    return 0;
+/* fd_ref
+ *
+ * DESCRIPTION: an fd entry was copied, pipes count their open ends and the
+ *              rtc its open fds
+ * INPUT/OUTPUT: file_descriptor_structure_t* file - the new copy
+ * SIDE EFFECTS: none
+ */
+static void fd_ref(file_descriptor_structure_t* file){
+    if(file->flags != OFF && file->table == pipe_driver)
+        pipe_ref(file->inode,file->position);
+    else if(file->flags != OFF && file->table == rtc_driver)
+        rtc_ref();
 }
 
 /* getargs
@@ -543,9 +870,11 @@ int32_t vidmap(uint8_t** screen_start){
       return -1;
     }
 
-    //initialize page
+    //the program draws into its terminal's screen from its start, the
+    //page follows the process around in vidmap_load
+    curr_pcb->leader->vid_page = screen_map() | URWON;
     page_directory[VIDMAP_PAGE] = (uint32_t)page_table_vid | URWON;
-    page_table_vid[0] = (uint32_t)VIDEO | URWON;
+    page_table_vid[0] = curr_pcb->leader->vid_page;
 
     //flush tlb
     asm volatile(
@@ -559,24 +888,887 @@ int32_t vidmap(uint8_t** screen_start){
     return 0;
 }
 
+/* vidmap_load
+ *
+ * DESCRIPTION: points the vidmap page at the screen of the process about to
+ *              run, nothing is there for one that never called vidmap.
+ *              Called next to every remap of the user page.
+ * INPUT/OUTPUT: process_control_block_t* pcb - any task of the process
+ * SIDE EFFECTS: caller flushes the tlb
+ */
+void vidmap_load(process_control_block_t* pcb){
+    page_table_vid[0] = pcb->leader->vid_page;
+}
+
 /* set_handler
  *
- * DESCRIPTION:
+ * DESCRIPTION: Installs the user function run when signum is delivered to any
+ *              task of the calling process. NULL restores the default, which
+ *              ignores ALARM and USER1 and kills the task on the rest.
  * INPUT/OUTPUT: int32_t signum
-                void* handler_address
+                void* handler_address - void handler(int signum), or NULL
+                returns 0, -1 if signum or the address is bad
  * SIDE EFFECTS: none
  */
 int32_t set_handler(int32_t signum, void* handler_address){
-    return 0;
+    if(signum < 0 || signum >= NUM_SIGNALS)
+        return -1;
+    if(handler_address != NULL && ((uint32_t)handler_address < USER || (uint32_t)handler_address >= OOB))
+        return -1;
+
+    curr_pcb->leader->sig_handler[signum] = handler_address;
+    return 0;
 }
 
 /* sigreturn
  *
- * DESCRIPTION:
- * INPUT/OUTPUT:
- * SIDE EFFECTS: none
+ * DESCRIPTION: Called by the trampoline once a handler returns. Copies the
+ *              registers saved in the signal frame, possibly edited by the
+ *              handler, back into the user frame and unmasks signals.
+ *              Segments and privileged flags are not taken from user space.
+ * INPUT/OUTPUT: returns the saved eax, so the interrupted code gets its own
+                 eax back, -1 if no handler is running
+ * SIDE EFFECTS: the task resumes where the signal interrupted it
  */
 int32_t sigreturn(){
+    hw_context_t* ctx = USER_FRAME(curr_pcb);
+    //the handler's ret popped the return address, esp is at signum
+    hw_context_t* saved = (hw_context_t*)(ctx->esp + BUF4);
+
+    if(!curr_pcb->sig_masked)
+        return -1;
+    if((uint32_t)saved < USER || (uint32_t)(saved + 1) > USER_STACK_TOP)
+        return -1;
+
+    ctx->ebx = saved->ebx;
+    ctx->ecx = saved->ecx;
+    ctx->edx = saved->edx;
+    ctx->esi = saved->esi;
+    ctx->edi = saved->edi;
+    ctx->ebp = saved->ebp;
+    ctx->eip = saved->eip;
+    ctx->esp = saved->esp;
+    ctx->eflags = (saved->eflags & EFLAGS_USER) | EFLAGS_IF;
+    ctx->ds = USER_DS;
+    ctx->es = USER_DS;
+    ctx->fs = USER_DS;
+    ctx->cs = USER_CS;
+    ctx->ss = USER_DS;
+
+    curr_pcb->sig_masked = 0;
+    return saved->eax;
+}
+
+/* alarm
+ *
+ * DESCRIPTION: Sets how often the calling process gets ALARM, counting from
+ *              now, in ms of the kernel timers
+ * INPUT/OUTPUT: int32_t period_ms - 0 stops the alarm
+                 returns 0, -1 on a negative period
+ * SIDE EFFECTS: none
+ */
+int32_t alarm(int32_t period_ms){
+    if(period_ms < 0)
+        return -1;
+
+    alarm_set(curr_pcb->leader, period_ms);
     return 0;
+}
+
+/* kill_current
+ *
+ * DESCRIPTION: Ends the current task the way an exception always has, its
+ *              parent sees EXCEPTION_STATUS
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: never returns
+ */
+void kill_current(void){
+    halt(EXCEPTION_STATUS);
+}
+
+/* thread_create
+ *
+ * DESCRIPTION: Starts a new thread in the calling process. The thread shares
+ *              the page and fd table of its leader, and gets its own kernel
+ *              stack, user stack and TLS block. It starts at start with entry
+ *              and arg on top of its user stack.
+ * INPUT/OUTPUT: uint32_t start - user trampoline the thread irets to
+                 uint32_t entry - thread function
+                 uint32_t arg - argument for the thread function
+                 returns thread id, -1 if no kernel stack is free
+ * SIDE EFFECTS: thread becomes runnable
+ */
+int32_t thread_create(uint32_t start, uint32_t entry, uint32_t arg){
+    uint32_t flags;
+    uint32_t stack_top;
+    uint32_t* user_sp;
+    int32_t i;
+    task_stack_t *thread;
+    process_control_block_t *leader = curr_pcb->leader;
+
+    if(start < USER || start >= OOB || entry < USER || entry >= OOB)
+        return -1;
+
+    cli_and_save(flags);
+
+    //threads only need a kernel stack, take one of the slots without a page
+    for(i = MAX_PROCESS; i < KTHREAD_SLOT; i++){
+        if(tasks->task[i].in_use == OFF)
+            break;
+    }
+    if(i == KTHREAD_SLOT){
+        restore_flags(flags);
+        return -1;
+    }
+    thread = &tasks->task[i];
+    thread->in_use = ON;
+
+    thread->proc.proc_id = leader->proc_id;
+    thread->proc.term = leader->term;
+    thread->proc.parent_proc_id = leader->parent_proc_id;
+    thread->proc.parent_pcb = leader->parent_pcb;
+    thread->proc.idx = leader->idx;
+    thread->proc.slot = i;
+    thread->proc.leader = leader;
+    thread->proc.fd_table = leader->file_arr;
+    thread->proc.wait_chan = 0;
+    thread->proc.detached = 0;
+    thread->proc.ipc_state = IPC_NONE;
+    thread->proc.ipc_peer = 0;
+    thread->proc.sig_pending = 0;
+    thread->proc.sig_masked = 0;
+    thread->proc.alarm_period = 0;
+    thread->proc.sleep_timer.pending = 0;
+    thread->proc.alarm_timer.pending = 0;
+    thread->proc.rt_period = 0;
+    thread->proc.rt_timer.pending = 0;
+    thread->proc.arguments[0] = '\0';
+
+    //every thread slot owns a fixed user stack below the leader's, with
+    //its TLS block at the bottom
+    stack_top = USER_STACK_TOP - (i - MAX_PROCESS + 1) * THREAD_STACK_SIZE;
+    thread->proc.tls_base = stack_top - THREAD_STACK_SIZE;
+
+    user_sp = (uint32_t*)stack_top;
+    *(--user_sp) = arg;
+    *(--user_sp) = entry;
+
+    task_init_stack(&thread->proc, start, (uint32_t)user_sp);
+    task_wake(&thread->proc);
+
+    restore_flags(flags);
+    return i;
+}
+
+/* futex
+ *
+ * DESCRIPTION: Wait/wake on a user address, used to build user level locks.
+ *              FUTEX_WAIT sleeps only if *addr still holds val, FUTEX_WAKE
+ *              wakes up to val threads of this process sleeping on addr.
+ * INPUT/OUTPUT: uint32_t* addr - user word
+                 int32_t op - FUTEX_WAIT or FUTEX_WAKE
+                 int32_t val - expected value or number to wake
+                 returns 0 after a wait, number woken for a wake, -1 on error
+                 or if *addr changed before the wait or a signal ended it
+ * SIDE EFFECTS: may block the calling thread
+ */
+int32_t futex(uint32_t* addr, int32_t op, int32_t val){
+    uint32_t flags;
+    int32_t i;
+    int32_t woken = 0;
+    uint32_t key;
+    process_control_block_t *pcb;
+
+    key = futex_key((uint32_t)addr);
+    if(key == 0)
+        return -1;
+
+    cli_and_save(flags);
+
+    if(op == FUTEX_WAIT){
+        //lock changed hands already, caller has to look again
+        if(*addr != (uint32_t)val){
+            restore_flags(flags);
+            return -1;
+        }
+        sleep_on(key);
+        restore_flags(flags);
+        //woken for a signal rather than by FUTEX_WAKE
+        return signal_pending(curr_pcb) ? -1 : 0;
+    }
+
+    if(op == FUTEX_WAKE){
+        for(i = 0; i < MAX_TASKS && woken < val; i++){
+            pcb = &tasks->task[i].proc;
+            if(tasks->task[i].in_use == ON && pcb->wait_chan == key){
+                pcb->wait_chan = 0;
+                task_wake(pcb);
+                woken++;
+            }
+        }
+        restore_flags(flags);
+        return woken;
+    }
+
+    restore_flags(flags);
+    return -1;
+}
+
+/* pipe
+ *
+ * DESCRIPTION: Creates a pipe, fds[0] is the read end and fds[1] the write end
+ * INPUT/OUTPUT: int32_t* fds - user array of two fds
+                 int32_t size - capacity in bytes, 0 for the largest
+                 returns 0, -1 if fds is bad or no pipe or fd is free
+ * SIDE EFFECTS: takes two fds of the calling process
+ */
+int32_t pipe(int32_t* fds, int32_t size){
+    int32_t i;
+    int32_t end = PIPE_READ_END;
+    int32_t pipe_num;
+    int32_t new_fds[2];
+    uint32_t flags;
+
+    if((uint32_t)fds < USER || (uint32_t)fds > OOB - 2*BUF4)
+        return -1;
+
+    //threads share the fd table, find and claim both fds with interrupts off
+    cli_and_save(flags);
+    //find two free fds before taking a pipe
+    for(i = 2; i < MAX_FD && end <= PIPE_WRITE_END; i++){
+        if(curr_pcb->fd_table[i].flags == OFF)
+            new_fds[end++] = i;
+    }
+    if(end <= PIPE_WRITE_END){
+        restore_flags(flags);
+        return -1;
+    }
 
+    pipe_num = pipe_create(size);
+    if(pipe_num == -1){
+        restore_flags(flags);
+        return -1;
+    }
+
+    for(end = PIPE_READ_END; end <= PIPE_WRITE_END; end++){
+        curr_pcb->fd_table[new_fds[end]].flags = ON;
+        curr_pcb->fd_table[new_fds[end]].table = pipe_driver;
+        curr_pcb->fd_table[new_fds[end]].inode = pipe_num;
+        curr_pcb->fd_table[new_fds[end]].position = end;
+        curr_pcb->fd_table[new_fds[end]].mode = 0;
+    }
+    restore_flags(flags);
+
+    fds[PIPE_READ_END] = new_fds[PIPE_READ_END];
+    fds[PIPE_WRITE_END] = new_fds[PIPE_WRITE_END];
+    return 0;
+}
+
+/* dup2
+ *
+ * DESCRIPTION: Makes newfd refer to the same file as oldfd, newfd is closed
+ *              first if it was open. Works on stdin and stdout, which is how
+ *              the shell points a program at a pipe.
+ * INPUT/OUTPUT: int32_t oldfd, int32_t newfd
+                 returns newfd, -1 if either fd is bad
+ * SIDE EFFECTS: none
+ */
+int32_t dup2(int32_t oldfd, int32_t newfd){
+    uint32_t flags;
+
+    if(oldfd < 0 || oldfd >= MAX_FD || curr_pcb->fd_table[oldfd].flags == OFF)
+        return -1;
+    if(newfd < 0 || newfd >= MAX_FD)
+        return -1;
+    if(oldfd == newfd)
+        return newfd;
+
+    cli_and_save(flags);
+    if(curr_pcb->fd_table[newfd].flags != OFF)
+        release_fd(newfd);
+    curr_pcb->fd_table[newfd] = curr_pcb->fd_table[oldfd];
+    fd_ref(&curr_pcb->fd_table[newfd]);
+    restore_flags(flags);
+
+    return newfd;
+}
+
+/* spawn
+ *
+ * DESCRIPTION: Starts a program without waiting for it, unlike execute the
+ *              caller keeps running. The child inherits stdin and stdout and
+ *              belongs to the calling process, which collects its status
+ *              with waitpid.
+ * INPUT/OUTPUT: const uint8_t* command
+                 returns the child's slot, -1 if it couldn't be started
+ * SIDE EFFECTS: child becomes runnable
+ */
+int32_t spawn(const uint8_t* command){
+    uint32_t flags;
+    int8_t cmd[CMD_BUF];
+    int32_t process_idx;
+    int32_t begin_args;
+    uint32_t eip_val;
+    task_stack_t *process;
+
+    if(command == NULL)
+        return -1;
+
+    cli_and_save(flags);
+
+    process_idx = alloc_process();
+    if(process_idx == -1){
+        restore_flags(flags);
+        return -1;
+    }
+    num_processes++;
+
+    begin_args = parse_command(command,cmd);
+    process = &tasks->task[process_idx];
+    copy_args(process,command+begin_args);
+
+    if(load_program(process,process_idx,cmd,&eip_val) == -1){
+        num_processes--;
+        process->in_use = OFF;
+        restore_flags(flags);
+        return -1;
+    }
+
+    init_process(process,curr_pcb->leader);
+    process->proc.detached = 1;
+    TRACE_EVENT(TR_EXEC, process_idx, process->proc.proc_id,
+                ((uint32_t*)process->proc.name)[0], ((uint32_t*)process->proc.name)[1]);
+
+    //load_program mapped the child, the caller carries on in its own page
+    page_directory[USER_PROG] = mem_locs[curr_pcb->idx] | SURWON;
+    asm volatile(
+        "movl %cr3, %eax \n \
+        movl %eax, %cr3");
+
+    task_init_stack(&process->proc,eip_val,USER_STACK_TOP - BUF4);
+    task_wake(&process->proc);
+
+    restore_flags(flags);
+    return process_idx;
+}
+
+/* waitpid
+ *
+ * DESCRIPTION: Collects the status of a spawned child once it halts and
+ *              frees its slot
+ * INPUT/OUTPUT: int32_t pid - id spawn returned, -1 for any child
+                 int32_t* status - gets the halt status, may be NULL
+                 int32_t options - WNOHANG returns 0 instead of sleeping
+                 returns the child's id, 0 if WNOHANG and none halted yet,
+                 -1 if there is no such child or a signal came first
+ * SIDE EFFECTS: blocks until a child halts
+ */
+int32_t waitpid(int32_t pid, int32_t* status, int32_t options){
+    uint32_t flags;
+    int32_t i, found;
+    process_control_block_t* leader = curr_pcb->leader;
+    process_control_block_t* child;
+
+    if(pid < -1 || pid >= MAX_PROCESS)
+        return -1;
+    if(status != NULL && ((uint32_t)status < USER || (uint32_t)(status + 1) > OOB))
+        return -1;
+
+    cli_and_save(flags);
+    while(1){
+        found = 0;
+        for(i = 0; i < MAX_PROCESS; i++){
+            if((pid != -1 && i != pid) || tasks->task[i].in_use == OFF)
+                continue;
+            child = &tasks->task[i].proc;
+            if(!child->detached || child->parent_pcb != leader)
+                continue;
+
+            found = 1;
+            if(tasks->task[i].in_use == ZOMBIE){
+                if(status != NULL)
+                    *status = child->exit_status;
+                tasks->task[i].in_use = OFF;
+                num_processes--;
+                restore_flags(flags);
+                return i;
+            }
+        }
+
+        if(!found || (options & WNOHANG)){
+            restore_flags(flags);
+            return found ? 0 : -1;
+        }
+        if(signal_pending(curr_pcb)){
+            restore_flags(flags);
+            return -1;
+        }
+        //halting children wake their parent's leader
+        sleep_on((uint32_t)leader);
+    }
+}
+
+/* kstat
+ *
+ * DESCRIPTION: Copies out kernel measurements. KSTAT_SWITCH gives the cycles
+ *              the latest terminal switches took, oldest first. KSTAT_SESSION
+ *              gives terminals configured and made, the kernel heap one
+ *              session took, its kernel stack and program page, and the heap
+ *              in use. KSTAT_KBD_IRQ and KSTAT_KBD_BH give the cycles the
+ *              latest keyboard handlers and bottom halves took,
+ *              KSTAT_KBD_READ the cycles from the latest keys' irq to the
+ *              read that took them. KSTAT_CLOCK gives the tsc rate in kHz
+ *              and the wall clock seconds at boot. KSTAT_TIMER gives the
+ *              kernel timers pending and the cycles the latest and slowest
+ *              pass over the timer wheel took. KSTAT_IRQ gives the
+ *              interrupts handled on each IRQ line since boot, KSTAT_IDLE
+ *              the ms spent halted with nothing to run and whether the pit
+ *              runs nohz. KSTAT_RT gives the calling thread's real-time
+ *              jobs and deadline misses and the ppm of the cpu all
+ *              real-time tasks reserve. KSTAT_IRQOFF gives the most cycles
+ *              an interrupt on each IRQ line kept interrupts off.
+ *              KSTAT_IRQSOFF_TOP gives the longest interrupts off sections
+ *              anywhere, as cycles and the eips that turned interrupts off
+ *              and on again. KSTAT_TIMER_TEST runs test_timers in the
+ *              caller and gives its results, kernels built with TIMER_TEST
+ *              only.
+ * INPUT/OUTPUT: int32_t which - counter to read
+                 uint32_t* buf - user buffer for n samples
+                 returns how many samples were copied, -1 on a bad argument
+ * SIDE EFFECTS: none
+ */
+int32_t kstat(int32_t which, uint32_t* buf, int32_t n){
+    uint32_t flags;
+    uint32_t words[KSTAT_SESSION_WORDS];
+    uint32_t test[TEST_TIMERS_WORDS];
+    uint64_t idle;
+
+    if(which < KSTAT_SWITCH || which > KSTAT_TIMER_TEST || n < 0)
+        return -1;
+    if((uint32_t)buf < USER || (uint32_t)buf >= OOB || n > (int32_t)((OOB - (uint32_t)buf) / 4))
+        return -1;
+
+    //waits on its timers with interrupts on, so not under the cli below
+    if(which == KSTAT_TIMER_TEST){
+        if(test_timers(test) == -1)
+            return -1;
+        if(n > TEST_TIMERS_WORDS)
+            n = TEST_TIMERS_WORDS;
+        memcpy(buf, test, n * 4);
+        return n;
+    }
+
+    cli_and_save(flags);
+    if(which == KSTAT_SESSION){
+        words[0] = num_terminals;
+        words[1] = session_count;
+        words[2] = session_bytes;
+        words[3] = STACK_SIZE;
+        words[4] = PROG_PAGE;
+        words[5] = kmem_used();
+        if(n > KSTAT_SESSION_WORDS)
+            n = KSTAT_SESSION_WORDS;
+        memcpy(buf, words, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+    if(which == KSTAT_CLOCK){
+        words[0] = tsc_khz;
+        words[1] = boot_epoch;
+        if(n > KSTAT_CLOCK_WORDS)
+            n = KSTAT_CLOCK_WORDS;
+        memcpy(buf, words, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+    if(which == KSTAT_TIMER){
+        words[0] = timer_pending;
+        words[1] = timer_run_cycles;
+        words[2] = timer_run_max;
+        if(n > KSTAT_TIMER_WORDS)
+            n = KSTAT_TIMER_WORDS;
+        memcpy(buf, words, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+    if(which == KSTAT_IRQ){
+        if(n > NUM_IRQS)
+            n = NUM_IRQS;
+        memcpy(buf, irq_count, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+    if(which == KSTAT_IRQOFF){
+        if(n > NUM_IRQS)
+            n = NUM_IRQS;
+        memcpy(buf, irqoff_max, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+    if(which == KSTAT_IRQSOFF_TOP){
+        if(n > IRQSOFF_TOP * IRQSOFF_WORDS)
+            n = IRQSOFF_TOP * IRQSOFF_WORDS;
+        memcpy(buf, irqsoff_top, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+    if(which == KSTAT_IDLE){
+        idle = idle_cycles;
+        div64_32(&idle, tsc_khz);
+        words[0] = idle;
+        words[1] = nohz;
+        if(n > KSTAT_IDLE_WORDS)
+            n = KSTAT_IDLE_WORDS;
+        memcpy(buf, words, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+    if(which == KSTAT_RT){
+        words[0] = curr_pcb->rt_jobs;
+        words[1] = curr_pcb->rt_misses;
+        words[2] = rt_util;
+        if(n > KSTAT_RT_WORDS)
+            n = KSTAT_RT_WORDS;
+        memcpy(buf, words, n * 4);
+        restore_flags(flags);
+        return n;
+    }
+
+    if(which == KSTAT_KBD_IRQ)
+        n = copy_samples(buf, n, kbd_irq_cycles, kbd_irq_count, KBD_SAMPLES);
+    else if(which == KSTAT_KBD_BH)
+        n = copy_samples(buf, n, kbd_bh_cycles, kbd_bh_count, KBD_SAMPLES);
+    else if(which == KSTAT_KBD_READ)
+        n = copy_samples(buf, n, kbd_read_cycles, kbd_read_count, KBD_SAMPLES);
+    else
+        n = copy_samples(buf, n, switch_cycles, switch_count, SWITCH_SAMPLES);
+    restore_flags(flags);
+
+    return n;
+}
+
+/* copy_samples
+ *
+ * DESCRIPTION: copies the latest samples of a ring out oldest first
+ * INPUT/OUTPUT: uint32_t* buf - room for n samples
+ *               ring, count, size - the samples, how many were ever taken
+ *               and how many the ring holds
+ *               returns how many samples were copied
+ * SIDE EFFECTS: none
+ */
+static int32_t copy_samples(uint32_t* buf, int32_t n, const uint32_t* ring, uint32_t count, int32_t size){
+    int32_t i;
+
+    if(n > size)
+        n = size;
+    if((uint32_t)n > count)
+        n = count;
+    for(i = 0; i < n; i++)
+        buf[i] = ring[(count - n + i) % size];
+    return n;
+}
+
+/* release_children
+ *
+ * DESCRIPTION: called when a process halts, frees the slots of its spawned
+ *              children that already halted and orphans the rest, which
+ *              then free their own slot
+ * INPUT/OUTPUT: process_control_block_t* pcb - halting process
+ * SIDE EFFECTS: none
+ */
+static void release_children(process_control_block_t* pcb){
+    int32_t i;
+    process_control_block_t* child;
+
+    for(i = 0; i < MAX_PROCESS; i++){
+        if(tasks->task[i].in_use == OFF)
+            continue;
+        child = &tasks->task[i].proc;
+        if(!child->detached || child->parent_pcb != pcb)
+            continue;
+
+        if(tasks->task[i].in_use == ZOMBIE){
+            tasks->task[i].in_use = OFF;
+            num_processes--;
+        }
+        else
+            child->parent_pcb = NULL;
+    }
+}
+
+/* futex_key
+ *
+ * DESCRIPTION: physical address of a user word, all user memory is mapped
+ *              with 4MB pages
+ * INPUT/OUTPUT: uint32_t addr
+ *               returns 0 if addr is not in the program page or a mapped
+ *               shared memory segment
+ * SIDE EFFECTS: none
+ */
+static uint32_t futex_key(uint32_t addr){
+    uint32_t pde;
+
+    if(addr & (BUF4 - 1))
+        return 0;
+    if(!(addr >= USER && addr < OOB) && !(addr >= SHM_VIRT && addr < SHM_END))
+        return 0;
+
+    pde = page_directory[addr >> 22];
+    if((pde & SURWON) != SURWON)
+        return 0;
+    return (pde & ~(SHM_SIZE - 1)) | (addr & (SHM_SIZE - 1));
+}
+
+/* shm_create
+ *
+ * DESCRIPTION: Opens the shared memory segment called name, creating it if no
+ *              process has it yet. A segment lives until its last unmap.
+ * INPUT/OUTPUT: const uint8_t* name - up to 31 characters
+                 int32_t size - bytes, at most 4MB
+                 returns segment id, -1 if the name or size is bad or there is
+                 no free segment
+ * SIDE EFFECTS: none
+ */
+int32_t shm_create(const uint8_t* name, int32_t size){
+    int8_t kname[SHM_NAME_LEN];
+    int32_t i;
+    uint32_t flags;
+    int32_t id;
+
+    if((uint32_t)name < USER || (uint32_t)name >= OOB)
+        return -1;
+
+    //copy the name so it can be compared after the page changes
+    for(i = 0; i < SHM_NAME_LEN - 1 && (uint32_t)(name + i) < OOB && name[i] != '\0'; i++)
+        kname[i] = name[i];
+    kname[i] = '\0';
+    if(i == 0)
+        return -1;
+
+    cli_and_save(flags);
+    id = shm_get(kname,size);
+    restore_flags(flags);
+    return id;
+}
+
+/* shm_map
+ *
+ * DESCRIPTION: Maps a segment at addr, which has to be a 4MB boundary in
+ *              0x08800000-0x097FFFFF
+ * INPUT/OUTPUT: int32_t id - from shm_create
+                 void* addr
+                 returns 0, -1 if id or addr is bad or addr is in use
+ * SIDE EFFECTS: changes paging, the segment is zeroed the first time
+ */
+int32_t shm_map(int32_t id, void* addr){
+    uint32_t flags;
+    int32_t ret;
+    cli_and_save(flags);
+    ret = shm_attach(id,(uint32_t)addr);
+    restore_flags(flags);
+
+    //4MB takes a while, interrupts stay on for it
+    if(ret == SHM_FRESH){
+        memset(addr,0,SHM_SIZE);
+        shm_zeroed(id);
+        ret = 0;
+    }
+    return ret;
+}
+
+/* shm_unmap
+ *
+ * DESCRIPTION: Unmaps the segment at addr
+ * INPUT/OUTPUT: void* addr
+                 returns 0, -1 if no segment is mapped at addr
+ * SIDE EFFECTS: changes paging
+ */
+int32_t shm_unmap(void* addr){
+    uint32_t flags;
+    int32_t ret;
+    cli_and_save(flags);
+    ret = shm_detach((uint32_t)addr);
+    restore_flags(flags);
+    return ret;
+}
+
+/* poll
+ *
+ * DESCRIPTION: Sleeps until one of the fds is ready or the timeout runs out.
+ *              Readiness comes from the POLL command of each fd's driver.
+ * INPUT/OUTPUT: pollfd_t* fds - user array, revents is filled in
+                 int32_t nfds - at most MAX_FD entries
+                 int32_t timeout - milliseconds, 0 returns at once, -1 never
+                                   times out. Runs on the caller's kernel
+                                   timer.
+                 returns number of entries with revents set, 0 on timeout,
+                 -1 if fds is bad or a signal came first
+ * SIDE EFFECTS: may block
+ */
+int32_t poll(pollfd_t* fds, int32_t nfds, int32_t timeout){
+    uint32_t flags;
+    int32_t i, ready;
+    ktimer_t* t = &curr_pcb->sleep_timer;
+    file_descriptor_structure_t* file;
+
+    if(nfds < 0 || nfds > MAX_FD)
+        return -1;
+    if((uint32_t)fds < USER || (uint32_t)fds > OOB - nfds*sizeof(pollfd_t))
+        return -1;
+
+    cli_and_save(flags);
+    if(timeout > 0)
+        timer_arm(t, clock_ns() + (uint64_t)timeout * NS_PER_MS, sleep_expired, (uint32_t)curr_pcb);
+    while(1){
+        ready = 0;
+        for(i = 0; i < nfds; i++){
+            fds[i].revents = 0;
+            if(fds[i].fd < 0 || fds[i].fd >= MAX_FD || curr_pcb->fd_table[fds[i].fd].flags == OFF){
+                fds[i].revents = POLLNVAL;
+            }
+            else{
+                file = &curr_pcb->fd_table[fds[i].fd];
+                fds[i].revents = file->table(POLL,fds[i].fd,NULL,0) & fds[i].events;
+            }
+            if(fds[i].revents)
+                ready++;
+        }
+
+        if(ready || timeout == 0)
+            break;
+        if(timeout > 0 && !t->pending)
+            break;
+        if(signal_pending(curr_pcb)){
+            ready = -1;
+            break;
+        }
+        poll_sleep();
+    }
+    timer_cancel(t);
+    restore_flags(flags);
+
+    return ready;
+}
+
+/* ioctl
+ *
+ * DESCRIPTION: Device specific control, handed to the fd's driver. The
+ *              keyboard takes KBD_SETMODE and KBD_GETMODE.
+ * INPUT/OUTPUT: int32_t fd
+                 int32_t request - the driver's request number
+                 int32_t arg - argument of the request
+                 returns what the driver returns, -1 if it has no requests
+ * SIDE EFFECTS: none
+ */
+int32_t ioctl(int32_t fd, int32_t request, int32_t arg){
+    if(fd < 0 || fd >= MAX_FD || curr_pcb->fd_table[fd].flags == OFF)
+        return -1;
+
+    return curr_pcb->fd_table[fd].table(IOCTL,fd,(void*)arg,request);
+}
+
+/* gettime
+ *
+ * DESCRIPTION: Reads CLOCK_MONOTONIC, time since boot off the calibrated
+ *              tsc, or CLOCK_REALTIME, seconds since 1970 from the cmos
+ *              clock read at boot plus the same tsc time
+ * INPUT/OUTPUT: int32_t clock
+                 timespec_t* ts - user buffer for the time
+                 returns 0, -1 on a bad argument
+ * SIDE EFFECTS: none
+ */
+int32_t gettime(int32_t clock, timespec_t* ts){
+    timespec_t now;
+
+    if((uint32_t)ts < USER || (uint32_t)ts > OOB - sizeof(timespec_t))
+        return -1;
+    if(clock_gettime(clock, &now) == -1)
+        return -1;
+    *ts = now;
+    return 0;
+}
+
+/* sleep
+ *
+ * DESCRIPTION: Blocks the caller for at least ns nanoseconds of
+ *              CLOCK_MONOTONIC on its own kernel timer. Wakes come in 1ms
+ *              steps of the timer wheel, at most as often as the pit ticks.
+ * INPUT/OUTPUT: uint32_t ns_lo, ns_hi - the 64 bit time to sleep
+                 returns 0, -1 if a signal came first
+ * SIDE EFFECTS: none
+ */
+int32_t sleep(uint32_t ns_lo, uint32_t ns_hi){
+    uint32_t flags;
+    uint64_t ns = ((uint64_t)ns_hi << 32) | ns_lo;
+    ktimer_t* t = &curr_pcb->sleep_timer;
+
+    if(ns == 0)
+        return 0;
+
+    cli_and_save(flags);
+    timer_arm(t, clock_ns() + ns, sleep_expired, (uint32_t)curr_pcb);
+    while(t->pending){
+        if(signal_pending(curr_pcb)){
+            timer_cancel(t);
+            restore_flags(flags);
+            return -1;
+        }
+        sleep_on((uint32_t)t);
+    }
+    restore_flags(flags);
+
+    return 0;
+}
+
+/* sched_rt
+ *
+ * DESCRIPTION: Puts the calling thread in the real-time class, every period
+ *              it is guaranteed budget of cpu time before its next period
+ *              starts. A job starts each time it wakes up, at most once per
+ *              period, and is done when it blocks again.
+ * INPUT/OUTPUT: uint32_t period_us - 1ms to 1s, 0 makes it a normal task
+                 uint32_t budget_us - up to period_us
+                 returns 0, -1 on a bad argument or if the real-time tasks
+                 would reserve more than 90% of the cpu
+ * SIDE EFFECTS: none
+ */
+int32_t sched_rt(uint32_t period_us, uint32_t budget_us){
+    return rt_set(curr_pcb, period_us, budget_us);
+}
+
+/* sleep_expired
+ *
+ * DESCRIPTION: timer callback of sleep and poll, runs in the timer softirq
+ * INPUT/OUTPUT: uint32_t data - pcb of the sleeper
+ * SIDE EFFECTS: makes the sleeper runnable
+ */
+void sleep_expired(uint32_t data){
+    process_control_block_t* pcb = (process_control_block_t*)data;
+
+    pcb->wait_chan = 0;
+    task_wake(pcb);
+}
+
+/* fcntl
+ *
+ * DESCRIPTION: Reads or sets the status flags of an fd, O_NONBLOCK is the
+ *              only one. A nonblocking read or write returns -1 instead of
+ *              sleeping.
+ * INPUT/OUTPUT: int32_t fd
+                 int32_t cmd - F_GETFL or F_SETFL
+                 int32_t arg - new flags for F_SETFL
+                 returns the flags for F_GETFL, 0 for F_SETFL, -1 on error
+ * SIDE EFFECTS: none
+ */
+int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg){
+    if(fd < 0 || fd >= MAX_FD || curr_pcb->fd_table[fd].flags == OFF)
+        return -1;
+
+    if(cmd == F_GETFL)
+        return curr_pcb->fd_table[fd].mode;
+    if(cmd == F_SETFL){
+        curr_pcb->fd_table[fd].mode = arg & O_NONBLOCK;
+        return 0;
+    }
+    return -1;
 }
@@ -8,6 +8,7 @@
 #include "terminal.h"
 #include "keyboard.h"
 #include "schedule.h"
+#include "timer.h"
 
 #define SYS_HALT    1
 #define SYS_EXECUTE 2
@@ -19,10 +20,54 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_THREAD_CREATE 11
+#define SYS_FUTEX 12
+#define SYS_PIPE 13
+#define SYS_DUP2 14
+#define SYS_SPAWN 15
+#define SYS_SHM_CREATE 16
+#define SYS_SHM_MAP 17
+#define SYS_SHM_UNMAP 18
+#define SYS_IPC_CALL 19
+#define SYS_IPC_REPLY_WAIT 20
+#define SYS_POLL 21
+#define SYS_FCNTL 22
+#define SYS_ALARM 23
+#define SYS_WAITPID 24
+#define SYS_KSTAT 25
+#define SYS_IOCTL 26
+#define SYS_GETTIME 27
+#define SYS_SLEEP 28
+#define SYS_SCHED_RT 29
+#define SYS_LATHIST 30
+#define SYS_PROFILE 31
+#define SYS_TRACE 32
+//kstat counters
+#define KSTAT_SWITCH 0
+#define KSTAT_SESSION 1
+#define KSTAT_SESSION_WORDS 6
+#define KSTAT_KBD_IRQ 2
+#define KSTAT_KBD_BH 3
+#define KSTAT_KBD_READ 4
+#define KSTAT_CLOCK 5
+#define KSTAT_CLOCK_WORDS 2
+#define KSTAT_TIMER 6
+#define KSTAT_TIMER_WORDS 3
+#define KSTAT_IRQ 7
+#define KSTAT_IDLE 8
+#define KSTAT_IDLE_WORDS 2
+#define KSTAT_RT 9
+#define KSTAT_RT_WORDS 3
+#define KSTAT_IRQOFF 10
+#define KSTAT_IRQSOFF_TOP 11
+#define KSTAT_TIMER_TEST 12
 #define USER 0x08000000
 #define OOB 0x08400000
 #define ON 1
 #define OFF 0
+//a halted spawned process whose status wasn't collected yet
+#define ZOMBIE 2
+#define WNOHANG 1
 #define DIRECTORY 2
 #define BYTE 0xFF
 #define KERNEL_BOT 0x800000
@@ -32,13 +77,34 @@
 #define PROCESS0 0x1400000
 #define PROCESS1 0x1800000
 #define PROCESS2 0x1C00000
+//program pages of the slots the six above don't cover, past the kernel heap
+#define PROCESS_HIGH 0x3400000
+#define PROG_PAGE 0x400000
 #define USER_ENTRY 0x08048000
 #define STACK_SIZE 0x2000
 #define STACK_SIZE4 0x1FFC
 #define MAX_FD 8
-#define MAX_PROCESS 6
+//slot t holds the root shell of terminal t, children take the slots after
+#define MAX_TERMINALS MAX_CONSOLES
+#define MAX_CHILDREN 6
+#define MAX_PROCESS (MAX_TERMINALS + MAX_CHILDREN)
+#define MAX_THREADS 10
+//kernel threads take the slots after the user threads
+#define MAX_KTHREADS 1
+#define KTHREAD_SLOT (MAX_PROCESS + MAX_THREADS)
+#define MAX_TASKS (KTHREAD_SLOT + MAX_KTHREADS)
+//idx of a kernel thread, it has no process page
+#define KTHREAD_IDX 0xFFFFFFFF
+#define USER_STACK_TOP 0x08400000
+#define THREAD_STACK_SIZE 0x10000
+#define TLS_SIZE 0x100
+#define SHM_WINDOW 4
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
 #define BUF4 4
 #define CMD_BUF 128
+//bytes of a program's file name kept in its pcb, with the null
+#define PROG_NAME 16
 #define RESTART_SIZE 8
 #define EXE0 0x7F
 #define EXE1 0x45
@@ -47,30 +113,70 @@
 #define ENTRY_OFF 24
 #define VIDMEM 0x08400000
 #define VIDMAP_PAGE 33
-#define TERM0ID 0
-#define TERM1ID 4
-#define TERM2ID 8
+//proc_id of terminal t's root shell, its descendants count up from there.
+//The count says how deep a process is, not where, that is pcb->term.
+#define TERM_ID(t) ((t)*4)
+//terminal t's root shell lives in slot t
+#define ROOT_SHELL(pcb) ((pcb)->slot == (uint32_t)(pcb)->term)
 
 #define OPEN 0
 #define READ 1
 #define WRITE 2
 #define CLOSE 3
+#define POLL 4
+#define IOCTL 5
+
+//poll events, a driver answers POLL with the ones that are ready
+#define POLLIN 0x01
+#define POLLOUT 0x04
+#define POLLNVAL 0x20
+
+//file status flags
+#define F_GETFL 3
+#define F_SETFL 4
+#define O_NONBLOCK 0x800
+
+//signals, lower numbers are delivered first
+#define DIV_ZERO 0
+#define SEGFAULT 1
+#define INTERRUPT 2
+#define ALARM 3
+#define USER1 4
+#define NUM_SIGNALS 5
+
+//status a parent sees when its child was killed
+#define EXCEPTION_STATUS 256
 
 int32_t system_handler(uint32_t instr, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+void kill_current(void);
 
 
 typedef struct file_descriptor_structure{
     int32_t (*table)(uint32_t,uint32_t,void*,uint32_t);
-    int32_t inode;
-    int32_t position;
+    union{
+        //files and directories, a pipe keeps its number and end here
+        struct{
+            int32_t inode;
+            int32_t position;
+        };
+        //rtc, how many interrupts make one of its ticks and the interrupt
+        //count its next tick is due at
+        struct{
+            uint32_t rtc_divider;
+            uint32_t rtc_due;
+        };
+    };
     int32_t flags;
-}file_descriptor_structure_t;//16
+    int32_t mode;
+}file_descriptor_structure_t;//20
 
 typedef struct pcb{
     int8_t arguments[128];//128
     int32_t proc_id;//4
+    //terminal the process belongs to, children and threads inherit it
+    int32_t term;//4
     int32_t parent_proc_id;//4
-    file_descriptor_structure_t file_arr[8];//128
+    file_descriptor_structure_t file_arr[8];//160
     struct pcb* parent_pcb;//4
     int32_t parent_esp0;//4
     int16_t parent_ss0;//2
@@ -81,29 +187,98 @@ typedef struct pcb{
     int32_t sched_esp;//4
     int32_t sched_eip;//4
     uint32_t idx;//4
-}process_control_block_t;//300
+    uint32_t slot;//4
+    struct pcb* leader;//4
+    file_descriptor_structure_t* fd_table;//4
+    uint32_t tls_base;//4
+    uint32_t wait_chan;//4
+    int32_t detached;//4
+    int8_t shm_map[SHM_WINDOW];//4
+    //page table entry of the screen the process drew through vidmap, 0
+    //when it never called vidmap
+    uint32_t vid_page;//4
+    int32_t ipc_state;//4
+    int32_t ipc_peer;//4
+    void* sig_handler[NUM_SIGNALS];//20
+    uint32_t sig_pending;//4
+    int32_t sig_masked;//4
+    uint32_t sig_tsc;//4
+    //ms, alarm_next is in timer_now() ms
+    uint32_t alarm_period;//4
+    uint32_t alarm_next;//4
+    int32_t exit_status;//4
+    ktimer_t sleep_timer;//24
+    ktimer_t alarm_timer;//24
+    //real-time class, a normal task has rt_period 0. Periods, budgets and
+    //use in ns, deadline and start are clock_ns() times.
+    uint32_t rt_period;//4
+    uint32_t rt_budget;//4
+    uint32_t rt_used;//4
+    int32_t rt_throttled;//4
+    uint64_t rt_deadline;//8
+    uint64_t rt_start;//8
+    uint32_t rt_jobs;//4
+    uint32_t rt_misses;//4
+    ktimer_t rt_timer;//24
+    //file the process was loaded from, threads use their leader's
+    int8_t name[PROG_NAME];//16
+}process_control_block_t;//548
+
+void vidmap_load(process_control_block_t* pcb);
+
+//registers saved on the kernel stack by every interrupt, exception and
+//system call entry in idt_wrappers.S. The one at the top of a task's kernel
+//stack belongs to user space, it is popped when the task returns there.
+typedef struct hw_context{
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
+    uint32_t eax;
+    uint32_t ds;
+    uint32_t es;
+    uint32_t fs;
+    uint32_t irq_num;
+    uint32_t err_code;
+    uint32_t eip;
+    uint32_t cs;
+    uint32_t eflags;
+    uint32_t esp;
+    uint32_t ss;
+}hw_context_t;//68
+
+#define USER_FRAME(pcb) ((hw_context_t*)((uint32_t)(pcb) + STACK_SIZE4 - sizeof(hw_context_t)))
+
+typedef struct pollfd{
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+}pollfd_t;
 
 typedef struct task_stack{//8kb
     //pcb
-    process_control_block_t proc;//300
+    process_control_block_t proc;//524
     int32_t in_use;
-    int8_t stack[8192-300-4];
+    int8_t stack[STACK_SIZE-sizeof(process_control_block_t)-4];
 }task_stack_t;
 
-typedef struct kernel_tasks{//48KB
-    task_stack_t task[6];
+typedef struct kernel_tasks{//8KB per task
+    task_stack_t task[MAX_TASKS];
 }kernel_tasks_t;
 
 process_control_block_t *curr_pcb;
 kernel_tasks_t *tasks;
 
-process_control_block_t *schedule_arr[3];
-int32_t new_process[3];
+process_control_block_t *schedule_arr[MAX_TASKS];
 
 uint32_t mem_locs[MAX_PROCESS];
 int32_t num_processes;
 int32_t curr_terminal;
-int8_t shell_dirty;
+//terminals the consoles= boot parameter asks for
+int32_t num_terminals;
+uint32_t shell_dirty;
 int8_t setup;
 
 #include "sys_handler_helper.h"
@@ -24,23 +24,18 @@ int32_t terminal_close(){
  * input: buffer to write, bytes to write
  * output: number of bytes written
  * side effects: prints to screen
- * function: takes the buffer inputted and outputs it to the terminal screen
+ * function: takes the buffer inputted and outputs it to the terminal screen,
+ *           the whole buffer is rendered in one batch
  */
 int32_t terminal_write(const char* buf, uint32_t nbytes){
-    int i;
-    int bytes_written = 0;
+    uint32_t flags;
 
-    //wrap in critical section to prevent race condition
-    cli();
+    //wrap in critical section so keyboard echo can't land mid write
+    cli_and_save(flags);
+    putc_buf((const uint8_t*)buf, nbytes);
+    restore_flags(flags);
 
-    //go through each char in buffer and output it to the screen
-    for(i=0;i<nbytes;i++){
-        putc(buf[i]);
-        bytes_written++;
-    }
-    sti();
-
-    return bytes_written;
+    return nbytes;
 }
 
 /* terminal_read
@@ -66,5 +61,9 @@ int32_t terminal_driver(uint32_t cmd, uint32_t fd, void* buf, uint32_t nbytes){
     else if(cmd == CLOSE){
         return terminal_close();
     }
+    //writes never block
+    else if(cmd == POLL){
+        return POLLOUT;
+    }
     return -1;
 }
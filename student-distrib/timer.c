@@ -0,0 +1,379 @@
+//kernel timers on a hierarchical timer wheel, advanced from the pit tick.
+//Adding and cancelling a timer is O(1) and a pending timer costs nothing
+//per tick until its slot, or the slot of its level, comes up.
+#include "timer.h"
+#include "kmem.h"
+#include "schedule.h"
+
+uint32_t timer_pending;
+uint32_t timer_run_cycles;
+uint32_t timer_run_max;
+
+static ktimer_t* tv1[TVR_SIZE];
+static ktimer_t* tvn[TVN_LEVELS][TVN_SIZE];
+//next ms of the wheel to run
+static uint32_t timer_jiffies;
+
+#if TIMER_TEST
+//test_timers results, test_busy keeps a second caller out
+static int32_t test_busy;
+static uint64_t* test_due;
+static volatile int32_t test_done;
+static uint64_t test_late_sum;
+static uint32_t test_late_max;
+
+static void test_expired(uint32_t data);
+#endif
+
+static uint64_t ns_to_ms(uint64_t ns);
+static void internal_add(ktimer_t* t);
+static void detach(ktimer_t* t);
+static uint32_t cascade(int32_t level);
+
+/* timer_init
+ *
+ * DESCRIPTION: starts the wheel at the current ms, clock_init runs first
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: none
+ */
+void timer_init(void){
+    int32_t i, j;
+
+    for(i = 0; i < TVR_SIZE; i++)
+        tv1[i] = NULL;
+    for(i = 0; i < TVN_LEVELS; i++)
+        for(j = 0; j < TVN_SIZE; j++)
+            tvn[i][j] = NULL;
+
+    timer_jiffies = ns_to_ms(clock_ns());
+    timer_pending = 0;
+    timer_run_cycles = 0;
+    timer_run_max = 0;
+}
+
+/* timer_arm
+ *
+ * DESCRIPTION: runs fn(data) from the timer softirq once the monotonic clock
+ *              reaches due_ns, rounded up to the next ms. A pending timer is
+ *              moved to the new time.
+ * INPUT/OUTPUT: ktimer_t* t - owned by the caller until it ran or was
+ *                             cancelled
+ *               uint64_t due_ns - clock_ns() time
+ *               fn, data - callback
+ * SIDE EFFECTS: none
+ */
+void timer_arm(ktimer_t* t, uint64_t due_ns, void (*fn)(uint32_t), uint32_t data){
+    uint32_t flags;
+    uint64_t due, now;
+    cli_and_save(flags);
+
+    if(t->pending)
+        detach(t);
+    else
+        timer_pending++;
+
+    due = ns_to_ms(due_ns + NS_PER_MS - 1);
+    now = ns_to_ms(clock_ns());
+    if(due > now + TIMER_MAX_MS)
+        due = now + TIMER_MAX_MS;
+
+    t->expires = due;
+    t->fn = fn;
+    t->data = data;
+    t->pending = 1;
+    internal_add(t);
+
+    //a one-shot pit may have to fire sooner now
+    tick_program();
+
+    restore_flags(flags);
+}
+
+/* timer_cancel
+ *
+ * DESCRIPTION: takes a timer off the wheel
+ * INPUT/OUTPUT: ktimer_t* t
+ *               returns 1 if it was pending, 0 if it ran or was never armed
+ * SIDE EFFECTS: none
+ */
+int32_t timer_cancel(ktimer_t* t){
+    uint32_t flags;
+    int32_t was_pending;
+    cli_and_save(flags);
+
+    was_pending = t->pending;
+    if(was_pending){
+        detach(t);
+        t->pending = 0;
+        timer_pending--;
+    }
+
+    restore_flags(flags);
+    return was_pending;
+}
+
+/* timer_run
+ *
+ * DESCRIPTION: called from the timer softirq, runs the wheel up to the
+ *              current ms. Every 256ms the next slot of the level above is
+ *              spread over the level below first, the same for the higher
+ *              levels whenever the level under them wrapped. The wheel is
+ *              worked on with interrupts off, they come back on between
+ *              callbacks.
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: runs the callbacks of the expired timers
+ */
+void timer_run(void){
+    uint32_t flags, begin, end, now, index;
+    ktimer_t* work;
+    ktimer_t* t;
+
+    asm volatile("rdtsc" : "=a"(begin) : : "edx");
+    cli_and_save(flags);
+
+    now = ns_to_ms(clock_ns());
+    while((int32_t)(now - timer_jiffies) >= 0){
+        index = timer_jiffies & TVR_MASK;
+        if(!index && !cascade(0) && !cascade(1) && !cascade(2))
+            cascade(3);
+        timer_jiffies++;
+
+        //callbacks may add to this slot again, they run off a list of
+        //their own
+        work = tv1[index];
+        tv1[index] = NULL;
+        if(work)
+            work->pprev = &work;
+        while((t = work) != NULL){
+            detach(t);
+            t->pending = 0;
+            timer_pending--;
+            t->fn(t->data);
+            restore_flags(flags);
+            cli();
+        }
+    }
+    restore_flags(flags);
+
+    asm volatile("rdtsc" : "=a"(end) : : "edx");
+    timer_run_cycles = end - begin;
+    if(timer_run_cycles > timer_run_max)
+        timer_run_max = timer_run_cycles;
+}
+
+/* timer_now
+ *
+ * DESCRIPTION: current ms of the monotonic clock, the unit timers are kept in
+ * INPUT/OUTPUT: returns ms since boot
+ * SIDE EFFECTS: none
+ */
+uint32_t timer_now(void){
+    return ns_to_ms(clock_ns());
+}
+
+/* timer_next
+ *
+ * DESCRIPTION: when the earliest pending timer runs, for programming the
+ *              one-shot pit. Timers on the upper levels are looked at when
+ *              their slot cascades inside the window.
+ * INPUT/OUTPUT: uint64_t limit_ns - clock_ns() time to look up to
+ *               returns the clock_ns() time the earliest timer runs at,
+ *               limit_ns if none runs sooner
+ * SIDE EFFECTS: none
+ */
+uint64_t timer_next(uint64_t limit_ns){
+    uint32_t end = ns_to_ms(limit_ns);
+    uint32_t j, index;
+    int32_t level, found = 0;
+    ktimer_t* t;
+
+    for(j = timer_jiffies; (int32_t)(end - j) > 0; j++){
+        if(tv1[j & TVR_MASK])
+            return (uint64_t)j * NS_PER_MS;
+        if(j & TVR_MASK)
+            continue;
+        for(level = 0; level < TVN_LEVELS; level++){
+            index = (j >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+            for(t = tvn[level][index]; t != NULL; t = t->next){
+                if((int32_t)(t->expires - end) < 0){
+                    end = t->expires;
+                    found = 1;
+                }
+            }
+            if(index)
+                break;
+        }
+    }
+
+    return found ? (uint64_t)end * NS_PER_MS : limit_ns;
+}
+
+/* ns_to_ms
+ *
+ * DESCRIPTION: rounds down to whole ms
+ * INPUT/OUTPUT: uint64_t ns
+ *               returns ms
+ * SIDE EFFECTS: none
+ */
+static uint64_t ns_to_ms(uint64_t ns){
+    div64_32(&ns, NS_PER_MS);
+    return ns;
+}
+
+/* internal_add
+ *
+ * DESCRIPTION: puts a timer in the slot of the first level that reaches
+ *              its ms, one already due goes in the slot run next
+ * INPUT/OUTPUT: ktimer_t* t
+ * SIDE EFFECTS: none
+ */
+static void internal_add(ktimer_t* t){
+    uint32_t expires = t->expires;
+    uint32_t idx = expires - timer_jiffies;
+    ktimer_t** slot;
+    int32_t level;
+
+    if((int32_t)idx < 0)
+        slot = &tv1[timer_jiffies & TVR_MASK];
+    else if(idx < TVR_SIZE)
+        slot = &tv1[expires & TVR_MASK];
+    else{
+        for(level = 0; level < TVN_LEVELS - 1; level++)
+            if(idx < (1U << (TVR_BITS + (level + 1) * TVN_BITS)))
+                break;
+        slot = &tvn[level][(expires >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK];
+    }
+
+    t->next = *slot;
+    if(t->next)
+        t->next->pprev = &t->next;
+    *slot = t;
+    t->pprev = slot;
+}
+
+/* detach
+ *
+ * DESCRIPTION: unlinks a timer from its slot
+ * INPUT/OUTPUT: ktimer_t* t
+ * SIDE EFFECTS: none
+ */
+static void detach(ktimer_t* t){
+    *t->pprev = t->next;
+    if(t->next)
+        t->next->pprev = t->pprev;
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+/* cascade
+ *
+ * DESCRIPTION: spreads the slot of a level that comes up now over the
+ *              levels below
+ * INPUT/OUTPUT: int32_t level - 0 for the first level above tv1
+ *               returns the slot's index, 0 means the level wrapped too
+ * SIDE EFFECTS: none
+ */
+static uint32_t cascade(int32_t level){
+    uint32_t index = (timer_jiffies >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+    ktimer_t* t;
+
+    while((t = tvn[level][index]) != NULL){
+        detach(t);
+        internal_add(t);
+    }
+    return index;
+}
+
+/* test_timers
+ *
+ * DESCRIPTION: arms TEST_TIMERS timers spread over TEST_SPREAD_MS and waits
+ *              for all of them, then reports how late they ran and what a
+ *              timer_run cost with and without them. Needs interrupts on,
+ *              only one caller runs it at a time.
+ * INPUT/OUTPUT: uint32_t* result - TEST_TIMERS_WORDS words: the timers, the
+ *                   average and the most us late, timer_run max cycles idle
+ *                   and with the timers armed
+ *               returns 0, -1 if it is already running, a real-time task
+ *               is admitted, the heap is full or the kernel was built
+ *               without TIMER_TEST
+ * SIDE EFFECTS: resets timer_run_max
+ */
+int32_t test_timers(uint32_t* result){
+#if TIMER_TEST
+    ktimer_t* timers;
+    uint32_t idle_max, begin, flags;
+    uint64_t now;
+    int32_t i;
+
+    cli_and_save(flags);
+    //its thousand timers and hlt loops would cost real-time jobs deadlines
+    if(test_busy || rt_util){
+        restore_flags(flags);
+        return -1;
+    }
+    test_busy = 1;
+    restore_flags(flags);
+
+    timers = kmalloc(TEST_TIMERS * sizeof(ktimer_t));
+    test_due = kmalloc(TEST_TIMERS * sizeof(uint64_t));
+    if(timers == NULL || test_due == NULL){
+        if(timers != NULL)
+            kfree(timers, TEST_TIMERS * sizeof(ktimer_t));
+        if(test_due != NULL)
+            kfree(test_due, TEST_TIMERS * sizeof(uint64_t));
+        test_busy = 0;
+        return -1;
+    }
+
+    //a few ticks with no timers
+    timer_run_max = 0;
+    begin = pit_ticks;
+    while(pit_ticks - begin < 10)
+        asm volatile("hlt");
+    idle_max = timer_run_max;
+
+    test_done = 0;
+    test_late_sum = 0;
+    test_late_max = 0;
+    timer_run_max = 0;
+    now = clock_ns();
+    for(i = 0; i < TEST_TIMERS; i++){
+        //stride through the spread so neighbours land in different slots
+        test_due[i] = now + (uint64_t)((i * 7919) % TEST_SPREAD_MS + 1) * NS_PER_MS;
+        timer_arm(&timers[i], test_due[i], test_expired, i);
+    }
+    while(test_done < TEST_TIMERS)
+        asm volatile("hlt");
+
+    div64_32(&test_late_sum, TEST_TIMERS);
+    result[0] = TEST_TIMERS;
+    result[1] = (uint32_t)test_late_sum / 1000;
+    result[2] = test_late_max / 1000;
+    result[3] = idle_max;
+    result[4] = timer_run_max;
+
+    kfree(timers, TEST_TIMERS * sizeof(ktimer_t));
+    kfree(test_due, TEST_TIMERS * sizeof(uint64_t));
+    test_busy = 0;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+#if TIMER_TEST
+/* test_expired
+ *
+ * DESCRIPTION: test_timers callback, notes how late it ran
+ * INPUT/OUTPUT: uint32_t data - index of the timer
+ * SIDE EFFECTS: none
+ */
+static void test_expired(uint32_t data){
+    uint32_t late = clock_ns() - test_due[data];
+
+    test_late_sum += late;
+    if(late > test_late_max)
+        test_late_max = late;
+    test_done++;
+}
+#endif
@@ -0,0 +1,54 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+#include "lib.h"
+#include "clock.h"
+
+//hierarchical timer wheel in 1ms steps. The first level has a slot for each
+//of the next 256ms, every further level has 64 slots each as long as the
+//whole level below, timers move down a level when their slot comes up.
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 4
+//furthest a timer can be set, further ones are clamped to it
+#define TIMER_MAX_MS 0x7FFFFFFF
+
+//1 builds in test_timers, a self-test any process can start through kstat
+#define TIMER_TEST 0
+
+//test_timers, and the words of its results
+#define TEST_TIMERS 1000
+#define TEST_SPREAD_MS 1000
+#define TEST_TIMERS_WORDS 5
+
+typedef struct ktimer{
+    struct ktimer* next;
+    //the pointer that points at this timer, so it can unlink itself
+    struct ktimer** pprev;
+    //ms of the wheel it runs at
+    uint32_t expires;
+    int32_t pending;
+    //runs in the timer softirq with interrupts off
+    void (*fn)(uint32_t data);
+    uint32_t data;
+}ktimer_t;
+
+//timers pending and the cycles the latest and slowest timer_run took
+extern uint32_t timer_pending;
+extern uint32_t timer_run_cycles;
+extern uint32_t timer_run_max;
+
+void timer_init(void);
+void timer_arm(ktimer_t* t, uint64_t due_ns, void (*fn)(uint32_t), uint32_t data);
+int32_t timer_cancel(ktimer_t* t);
+void timer_run(void);
+uint64_t timer_next(uint64_t limit_ns);
+uint32_t timer_now(void);
+int32_t test_timers(uint32_t* result);
+
+#endif
@@ -0,0 +1,146 @@
+//event trace. System calls, context switches, IRQs, page faults and
+//program loads and halts go into a ring of timestamped events while the
+//trace is on. Draining writes them to the serial port, trace2json.sh turns
+//that into a Chrome trace.
+#include "trace.h"
+#include "lib.h"
+#include "clock.h"
+#include "serial.h"
+#include "schedule.h"
+
+#if EVENT_TRACE
+volatile int32_t trace_on;
+
+static trace_event_t trace_buf[TRACE_SIZE];
+//events written since the last drain, the ring keeps the last TRACE_SIZE
+static uint32_t trace_head;
+//a drain is writing the ring out, it can't be turned on meanwhile
+static int32_t trace_draining;
+
+static const int8_t* trace_names[TR_TYPES] = {
+    "sys", "sysret", "switch", "irq", "irqret", "pf", "exec", "halt"
+};
+
+static void trace_write(void);
+
+/* trace_event
+ *
+ * DESCRIPTION: stamps an event and puts it in the ring, called through
+ *              TRACE_EVENT from anywhere, interrupts included
+ * INPUT/OUTPUT: uint32_t type - TR_ event type
+ *               uint32_t a, b, c, d - what the type puts there
+ * SIDE EFFECTS: overwrites the oldest event once the ring is full
+ */
+void trace_event(uint32_t type, uint32_t a, uint32_t b, uint32_t c, uint32_t d){
+    uint32_t flags;
+    trace_event_t* e;
+
+    cli_and_save(flags);
+    e = &trace_buf[trace_head & (TRACE_SIZE - 1)];
+    trace_head++;
+    e->tsc = rdtsc64();
+    e->type = type;
+    e->slot = curr_pcb->slot;
+    e->a = a;
+    e->b = b;
+    e->c = c;
+    e->d = d;
+    restore_flags(flags);
+}
+
+/* trace_write
+ *
+ * DESCRIPTION: writes the ring to the serial port, oldest first, a header,
+ *              a line an event and an end marker:
+ *                  trace khz <tsc kHz> events <n> lost <overwritten>
+ *                  <us since the first>.<ns> <slot> <type> <a> <b> <c> <d>
+ *                  trace end
+ *              a to d in hex
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: busy waits on the serial port
+ */
+static void trace_write(void){
+    int8_t num[TRACE_DIGITS];
+    uint32_t first, i, frac;
+    uint64_t t;
+    trace_event_t* e;
+
+    first = trace_head > TRACE_SIZE ? trace_head - TRACE_SIZE : 0;
+    serial_puts("trace khz ");
+    serial_puts(itoa(tsc_khz, num, 10));
+    serial_puts(" events ");
+    serial_puts(itoa(trace_head - first, num, 10));
+    serial_puts(" lost ");
+    serial_puts(itoa(first, num, 10));
+    serial_putc('\n');
+
+    for(i = first; i < trace_head; i++){
+        e = &trace_buf[i & (TRACE_SIZE - 1)];
+        t = (e->tsc - trace_buf[first & (TRACE_SIZE - 1)].tsc) * NS_PER_MS;
+        div64_32(&t, tsc_khz);
+        frac = div64_32(&t, NS_PER_US);
+        serial_puts(itoa((uint32_t)t, num, 10));
+        serial_putc('.');
+        serial_putc('0' + frac / 100);
+        serial_putc('0' + frac / 10 % 10);
+        serial_putc('0' + frac % 10);
+        serial_putc(' ');
+        serial_puts(itoa(e->slot, num, 10));
+        serial_putc(' ');
+        serial_puts(trace_names[e->type]);
+        serial_putc(' ');
+        serial_hex(e->a);
+        serial_putc(' ');
+        serial_hex(e->b);
+        serial_putc(' ');
+        serial_hex(e->c);
+        serial_putc(' ');
+        serial_hex(e->d);
+        serial_putc('\n');
+    }
+    serial_puts("trace end\n");
+}
+#endif
+
+/* trace
+ *
+ * DESCRIPTION: TRACE_ON starts recording events, TRACE_OFF stops and
+ *              TRACE_DRAIN stops, writes the ring to the serial port and
+ *              empties it
+ * INPUT/OUTPUT: int32_t cmd - TRACE_OFF, TRACE_ON or TRACE_DRAIN
+ *               returns 0, the events written for TRACE_DRAIN, -1 for a bad
+ *               command, while another drain runs or if the kernel was
+ *               built without EVENT_TRACE
+ * SIDE EFFECTS: draining busy waits on the serial port
+ */
+int32_t trace(int32_t cmd){
+#if EVENT_TRACE
+    uint32_t flags;
+    int32_t count;
+
+    if(cmd != TRACE_ON && cmd != TRACE_OFF && cmd != TRACE_DRAIN)
+        return -1;
+
+    //no event is half written once it is off
+    cli_and_save(flags);
+    if(trace_draining){
+        restore_flags(flags);
+        return -1;
+    }
+    trace_on = (cmd == TRACE_ON);
+    if(cmd != TRACE_DRAIN){
+        restore_flags(flags);
+        return 0;
+    }
+    trace_draining = 1;
+    restore_flags(flags);
+
+    trace_write();
+    count = trace_head > TRACE_SIZE ? TRACE_SIZE : trace_head;
+    trace_head = 0;
+    trace_draining = 0;
+    return count;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+
+//0 compiles the event trace out, every TRACE_EVENT with it
+#define EVENT_TRACE 1
+
+//events the ring keeps, a power of two, the oldest are overwritten
+#define TRACE_SIZE 4096
+//trace commands
+#define TRACE_OFF 0
+#define TRACE_ON 1
+#define TRACE_DRAIN 2
+//a decimal word and its null
+#define TRACE_DIGITS 11
+
+//event types and what goes in a, b, c and d
+#define TR_SYSCALL 0        //number and the three arguments
+#define TR_SYSRET 1         //number and return value
+#define TR_SWITCH 2         //slot switched away from, slot switched to
+#define TR_IRQ 3            //IRQ line, as the handler starts
+#define TR_IRQ_EXIT 4       //IRQ line, as the handler is done
+#define TR_PAGE_FAULT 5     //faulting address, eip, error code
+#define TR_EXEC 6           //slot and proc id of the program, 8 bytes of its name
+#define TR_HALT 7           //status
+#define TR_TYPES 8
+
+#ifndef ASM
+
+typedef struct trace_event{
+    uint64_t tsc;
+    uint32_t type;
+    //task that was running
+    uint32_t slot;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+}trace_event_t;//32
+
+#if EVENT_TRACE
+//set and cleared by the trace system call, all a site costs while it is 0
+extern volatile int32_t trace_on;
+#define TRACE_EVENT(type, a, b, c, d)                                       \
+do{                                                                         \
+    if(trace_on)                                                            \
+        trace_event((type), (uint32_t)(a), (uint32_t)(b), (uint32_t)(c),   \
+                    (uint32_t)(d));                                         \
+}while(0)
+#else
+#define TRACE_EVENT(type, a, b, c, d) do{}while(0)
+#endif
+
+void trace_event(uint32_t type, uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+int32_t trace(int32_t cmd);
+
+#endif /* ASM */
+
+#endif
@@ -0,0 +1,121 @@
+#!/bin/sh
+# Turns an event trace the kernel wrote to the serial port into Chrome trace
+# JSON, for chrome://tracing or ui.perfetto.dev. Every task slot gets a
+# track with its system calls, page faults and program loads, the "cpu"
+# track shows which task ran and the "irq" track the IRQ handlers.
+#
+# usage: ./trace2json.sh <serial log> > trace.json
+#   run qemu with -serial file:trace.log, then "trace <command>" in the os
+
+if [ $# -lt 1 ]; then
+echo "usage: $0 <serial log> > trace.json"
+exit 1
+fi
+
+DIR=$(dirname "$0")
+
+# system call names come from the numbers user space uses, only the last
+# trace in the log is converted
+awk '
+/^#define SYS_/ && FILENAME ~ /sysnum/ { sysname[$3] = tolower(substr($2, 5)); next }
+{ sub(/\r$/, "") }
+$1 == "trace" && $2 == "khz" { n = 0; next }
+$1 == "trace" { next }
+NF == 7 { line[n++] = $0 }
+
+function hex(s,  i, v) {
+    v = 0
+    for (i = 1; i <= length(s); i++)
+        v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    return v
+}
+function signed(v) { return v >= 2147483648 ? v - 4294967296 : v }
+# 4 name bytes of a little endian word
+function chars(s,  i, c, out) {
+    out = ""
+    for (i = 7; i >= 1; i -= 2) {
+        c = hex(substr(s, i, 2))
+        if (c == 0)
+            break
+        out = out sprintf("%c", c)
+    }
+    return out
+}
+function emit(s) {
+    printf "%s\n%s", (first++ ? "," : ""), s
+}
+function ev(name, ph, ts, tid, args) {
+    emit(sprintf("{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%s,\"pid\":1,\"tid\":%d%s}", \
+        name, ph, ts, tid, args == "" ? "" : ",\"args\":{" args "}"))
+}
+function thread_name(tid, name) {
+    emit(sprintf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", tid, name))
+}
+function task(slot) { return slot in prog ? prog[slot] " (" slot ")" : "task " slot }
+# the cpu track follows the slot of every event, execute and halt switch
+# tasks without a switch event
+function run(slot, ts) {
+    if (running == slot)
+        return
+    if (running != "")
+        ev(task(running), "E", ts, CPU, "")
+    ev(task(slot), "B", ts, CPU, "")
+    running = slot
+}
+
+END {
+    CPU = 100
+    IRQ = 101
+    printf "{\"traceEvents\":["
+    thread_name(CPU, "cpu")
+    thread_name(IRQ, "irq")
+    running = ""
+    for (i = 0; i < n; i++) {
+        split(line[i], f, " ")
+        ts = f[1]; slot = f[2]; type = f[3]
+        if (!(slot in seen)) {
+            seen[slot] = 1
+            thread_name(slot, "task " slot)
+        }
+        if (type == "switch") {
+            run(hex(f[5]), ts)
+            continue
+        }
+        if (type != "irq" && type != "irqret")
+            run(slot, ts)
+        if (type == "sys") {
+            nr = hex(f[4])
+            ev(nr in sysname ? sysname[nr] : "sys " nr, "B", ts, slot, \
+                sprintf("\"arg0\":\"0x%s\",\"arg1\":\"0x%s\",\"arg2\":\"0x%s\"", f[5], f[6], f[7]))
+            depth[slot]++
+        } else if (type == "sysret") {
+            # calls made before the trace started have no begin
+            if (depth[slot] > 0) {
+                ev("", "E", ts, slot, sprintf("\"ret\":%d", signed(hex(f[5]))))
+                depth[slot]--
+            }
+        } else if (type == "irq") {
+            ev("irq " hex(f[4]), "B", ts, IRQ, "")
+        } else if (type == "irqret") {
+            ev("", "E", ts, IRQ, "")
+        } else if (type == "pf") {
+            ev("page fault", "i", ts, slot, \
+                sprintf("\"addr\":\"0x%s\",\"eip\":\"0x%s\",\"err\":\"0x%s\"", f[4], f[5], f[6]))
+        } else if (type == "exec") {
+            s = hex(f[4])
+            prog[s] = chars(f[6]) chars(f[7])
+            seen[s] = 1
+            thread_name(s, task(s))
+            ev("exec " prog[s], "i", ts, slot, sprintf("\"slot\":%d,\"pid\":%d", s, hex(f[5])))
+        } else if (type == "halt") {
+            ev("halt", "i", ts, slot, sprintf("\"status\":%d", hex(f[4])))
+            # halt never returns, neither does anything open below it
+            while (depth[slot] > 0) {
+                ev("", "E", ts, slot, "")
+                depth[slot]--
+            }
+        }
+    }
+    printf "\n]}\n"
+}
+' "$DIR/../syscalls/ece391sysnum.h" "$1"
@@ -0,0 +1,95 @@
+//the kernel worker thread, runs queued jobs one after the other in task
+//context, where they can take as long as they need with interrupts on
+#include "worker.h"
+#include "schedule.h"
+#include "softirq.h"
+#include "sys_handler_helper.h"
+
+//jobs waiting, oldest first, the worker sleeps on work_head
+static work_t* work_head;
+static work_t** work_tail;
+static process_control_block_t* worker;
+
+static void worker_main(void);
+
+/* worker_init
+ *
+ * DESCRIPTION: starts the worker thread, with softirq=off there is none and
+ *              jobs run where they are queued
+ * INPUT/OUTPUT: none
+ * SIDE EFFECTS: takes a kernel thread slot
+ */
+void worker_init(void){
+    work_head = NULL;
+    work_tail = &work_head;
+    worker = NULL;
+    if(softirq_on)
+        worker = kthread_create(worker_main);
+}
+
+/* work_queue
+ *
+ * DESCRIPTION: hands fn(data) to the worker thread, safe to call from
+ *              interrupts. A job that is still waiting only gets the new fn
+ *              and data.
+ * INPUT/OUTPUT: work_t* w - owned by the caller, queued at most once
+ *               returns 1 if the job was queued, 0 if it already was
+ * SIDE EFFECTS: wakes the worker thread
+ */
+int32_t work_queue(work_t* w, void (*fn)(uint32_t), uint32_t data){
+    uint32_t flags;
+    cli_and_save(flags);
+
+    w->fn = fn;
+    w->data = data;
+    if(w->pending){
+        restore_flags(flags);
+        return 0;
+    }
+
+    //early in boot or with softirq=off the job runs right here
+    if(worker == NULL){
+        restore_flags(flags);
+        fn(data);
+        return 1;
+    }
+
+    w->pending = 1;
+    w->next = NULL;
+    *work_tail = w;
+    work_tail = &w->next;
+    wake_up((uint32_t)&work_head);
+
+    restore_flags(flags);
+    return 1;
+}
+
+/* worker_main
+ *
+ * DESCRIPTION: body of the worker thread, takes the oldest job and runs it
+ *              with interrupts on, sleeps while there is none
+ * INPUT/OUTPUT: none, never returns
+ * SIDE EFFECTS: none
+ */
+static void worker_main(void){
+    work_t* w;
+    void (*fn)(uint32_t);
+    uint32_t data;
+
+    while(1){
+        cli();
+        while(work_head == NULL)
+            sleep_on((uint32_t)&work_head);
+
+        w = work_head;
+        work_head = w->next;
+        if(work_head == NULL)
+            work_tail = &work_head;
+        w->pending = 0;
+        fn = w->fn;
+        data = w->data;
+        sti();
+
+        fn(data);
+    }
+}
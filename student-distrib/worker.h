@@ -0,0 +1,20 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include "types.h"
+#include "lib.h"
+
+//a job for the kernel worker thread, for work too long for a softirq or
+//that has to be able to block
+typedef struct work{
+    struct work* next;
+    //runs in the worker thread with interrupts on
+    void (*fn)(uint32_t data);
+    uint32_t data;
+    int32_t pending;
+}work_t;
+
+void worker_init(void);
+int32_t work_queue(work_t* w, void (*fn)(uint32_t), uint32_t data);
+
+#endif
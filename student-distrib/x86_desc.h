@@ -15,6 +15,8 @@
 #define USER_DS 0x002B
 #define KERNEL_TSS 0x0030
 #define KERNEL_LDT 0x0038
+/* LDT entry 0, user privilege: per thread TLS segment */
+#define TLS_SEL 0x0007
 
 /* Size of the task state segment (TSS) */
 #define TSS_SIZE 104
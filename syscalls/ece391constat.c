@@ -0,0 +1,28 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* prints what a terminal that sits at its shell prompt costs */
+int main ()
+{
+    uint32_t s[KSTAT_SESSION_WORDS];
+
+    if (KSTAT_SESSION_WORDS != ece391_kstat (KSTAT_SESSION, s, KSTAT_SESSION_WORDS)) {
+        ece391_fdputs (1, (uint8_t*)"kstat failed\n");
+        return 3;
+    }
+
+    ece391_print_num ("terminals: ", s[0], 10);
+    ece391_print_num ("  sessions made: ", s[1], 10);
+    ece391_print_num ("  kernel heap in use: ", s[5], 10);
+    ece391_fdputs (1, (uint8_t*)"\nidle terminal, bytes:\n");
+    ece391_print_num ("  console and input buffers (heap): ", s[2], 10);
+    ece391_print_num ("\n  shell kernel stack: ", s[3], 10);
+    ece391_print_num ("\n  shell program page: ", s[4], 10);
+    ece391_print_num ("\n  total: ", s[2] + s[3] + s[4], 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    return 0;
+}
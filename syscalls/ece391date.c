@@ -0,0 +1,70 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define CALLS 1000
+#define SEC_PER_DAY 86400
+
+/* prints value with at least two digits */
+static void print_2 (const char* label, uint32_t value)
+{
+    ece391_print_num (label, value / 10, 10);
+    ece391_print_num ("", value % 10, 10);
+}
+
+/* date from days since 1970, eras of 400 years start on March 1st */
+static void civil (uint32_t days, uint32_t* y, uint32_t* m, uint32_t* d)
+{
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+/* prints the wall clock, the time since boot, the TSC rate and what a
+   gettime call costs */
+int main ()
+{
+    ece391_timespec_t now, begin, end;
+    uint32_t clock[KSTAT_CLOCK_WORDS];
+    uint32_t y, m, d, secs, ns;
+    int32_t i;
+
+    if (-1 == ece391_gettime (CLOCK_REALTIME, &now)) {
+        ece391_fdputs (1, (uint8_t*)"gettime failed\n");
+        return 3;
+    }
+    civil (now.sec / SEC_PER_DAY, &y, &m, &d);
+    secs = now.sec % SEC_PER_DAY;
+    ece391_print_num ("", y, 10);
+    print_2 ("-", m);
+    print_2 ("-", d);
+    print_2 (" ", secs / 3600);
+    print_2 (":", secs / 60 % 60);
+    print_2 (":", secs % 60);
+    ece391_fdputs (1, (uint8_t*)" UTC\n");
+
+    ece391_gettime (CLOCK_MONOTONIC, &now);
+    ece391_print_num ("up ", now.sec, 10);
+    ece391_print_num ("s ", now.nsec / 1000000, 10);
+    ece391_fdputs (1, (uint8_t*)"ms\n");
+
+    if (KSTAT_CLOCK_WORDS == ece391_kstat (KSTAT_CLOCK, clock, KSTAT_CLOCK_WORDS))
+        ece391_print_num ("tsc: ", clock[0], 10);
+    ece391_fdputs (1, (uint8_t*)" kHz\n");
+
+    ece391_gettime (CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < CALLS; i++)
+        ece391_gettime (CLOCK_MONOTONIC, &end);
+    ns = (end.sec - begin.sec) * 1000000000 + end.nsec - begin.nsec;
+    ece391_print_num ("gettime: ", ns / CALLS, 10);
+    ece391_fdputs (1, (uint8_t*)" ns per call\n");
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define RTC_HZ 32
+#define REPORT_TICKS 64
+#define POLL_CALLS 1000
+#define IDLE_MS 2000
+
+static uint32_t cycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+/* tick intervals in cycles, reset after every report */
+static uint32_t ticks, last_tick, min_gap, max_gap, sum_gap, gaps;
+
+static void on_tick (uint32_t now)
+{
+    uint32_t gap = now - last_tick;
+
+    if (0 != ticks++) {
+	if (0 == gaps || gap < min_gap)
+	    min_gap = gap;
+	if (gap > max_gap)
+	    max_gap = gap;
+	sum_gap += gap >> 10;
+	gaps++;
+    }
+    last_tick = now;
+
+    if (0 == ticks % REPORT_TICKS && 0 != gaps) {
+	ece391_print_num ("ticks: ", ticks, 10);
+	ece391_print_num ("  gap kcycles min/avg/max: ", min_gap >> 10, 10);
+	ece391_print_num ("/", sum_gap / gaps, 10);
+	ece391_print_num ("/", max_gap >> 10, 10);
+	ece391_print_num ("  jitter: ", (max_gap - min_gap) >> 10, 10);
+	ece391_fdputs (1, (uint8_t*)"\n");
+	gaps = sum_gap = max_gap = 0;
+    }
+}
+
+int main ()
+{
+    struct pollfd fds[2];
+    uint8_t buf[BUFSIZE];
+    int32_t rtc, hz = RTC_HZ;
+    int32_t i, cnt;
+    uint32_t begin, woke;
+
+    if (-1 == (rtc = ece391_open ((uint8_t*)"rtc"))) {
+	ece391_fdputs (1, (uint8_t*)"could not open rtc\n");
+	return 3;
+    }
+    ece391_write (rtc, &hz, 4);
+    ece391_fcntl (rtc, F_SETFL, O_NONBLOCK);
+
+    fds[0].fd = 0;
+    fds[0].events = POLLIN;
+    fds[1].fd = rtc;
+    fds[1].events = POLLIN;
+
+    /* cost of a poll that finds nothing and doesn't sleep */
+    begin = cycles ();
+    for (i = 0; i < POLL_CALLS; i++)
+	ece391_poll (fds, 2, 0);
+    ece391_print_num ("poll(2 fds, timeout 0) cycles: ",
+                      (cycles () - begin) / POLL_CALLS, 10);
+    ece391_fdputs (1, (uint8_t*)"\nrtc at 32Hz, type a line or \"quit\"\n");
+
+    while (1) {
+	if (0 == ece391_poll (fds, 2, IDLE_MS)) {
+	    ece391_fdputs (1, (uint8_t*)"timeout\n");
+	    continue;
+	}
+	woke = cycles ();
+
+	if (fds[1].revents & POLLIN) {
+	    /* several ticks may have come in, one read clears them all */
+	    while (0 == ece391_read (rtc, buf, 4))
+		;
+	    on_tick (woke);
+	}
+
+	if (fds[0].revents & POLLIN) {
+	    cnt = ece391_read (0, buf, BUFSIZE - 1);
+	    if (cnt > 0 && '\n' == buf[cnt - 1])
+		cnt--;
+	    buf[cnt < 0 ? 0 : cnt] = '\0';
+	    if (0 == ece391_strcmp (buf, (uint8_t*)"quit"))
+		break;
+	    ece391_fdputs (1, (uint8_t*)"line: ");
+	    ece391_fdputs (1, buf);
+	    ece391_print_num ("  wake to read cycles: ", cycles () - woke, 10);
+	    ece391_fdputs (1, (uint8_t*)"\n");
+	}
+    }
+
+    ece391_close (rtc);
+    return 0;
+}
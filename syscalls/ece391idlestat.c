@@ -0,0 +1,49 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SECONDS 10
+#define IRQ_PIT 0
+#define IRQ_KEYBOARD 1
+#define IRQ_RTC 8
+
+/* sleeps for 10 seconds and prints how many interrupts per second came
+   in meanwhile and how much of the time the cpu was halted.  Run it on
+   an otherwise idle machine, once booted normally and once with
+   nohz=off, to compare the one-shot PIT against the 100Hz tick. */
+int main ()
+{
+    uint32_t before[KSTAT_IRQ_WORDS], after[KSTAT_IRQ_WORDS];
+    uint32_t idle0[KSTAT_IDLE_WORDS], idle1[KSTAT_IDLE_WORDS];
+    uint32_t total = 0;
+    int32_t i;
+
+    ece391_fdputs (1, (uint8_t*)"measuring for 10 seconds, leave the keyboard alone\n");
+    if (KSTAT_IRQ_WORDS != ece391_kstat (KSTAT_IRQ, before, KSTAT_IRQ_WORDS) ||
+        KSTAT_IDLE_WORDS != ece391_kstat (KSTAT_IDLE, idle0, KSTAT_IDLE_WORDS)) {
+        ece391_fdputs (1, (uint8_t*)"kstat failed\n");
+        return 3;
+    }
+    ece391_sleep ((uint64_t)SECONDS * 1000000000);
+    ece391_kstat (KSTAT_IRQ, after, KSTAT_IRQ_WORDS);
+    ece391_kstat (KSTAT_IDLE, idle1, KSTAT_IDLE_WORDS);
+
+    for (i = 0; i < KSTAT_IRQ_WORDS; i++)
+        total += after[i] - before[i];
+
+    ece391_fdputs (1, idle1[1] ? (uint8_t*)"pit: one-shot (nohz)\n"
+                               : (uint8_t*)"pit: 100Hz tick\n");
+    ece391_print_num ("interrupts/s: ", total / SECONDS, 10);
+    ece391_print_num ("  pit: ",
+                      (after[IRQ_PIT] - before[IRQ_PIT]) / SECONDS, 10);
+    ece391_print_num ("  keyboard: ",
+                      (after[IRQ_KEYBOARD] - before[IRQ_KEYBOARD]) / SECONDS,
+                      10);
+    ece391_print_num ("  rtc: ",
+                      (after[IRQ_RTC] - before[IRQ_RTC]) / SECONDS, 10);
+    ece391_print_num ("\nidle: ", (idle1[0] - idle0[0]) / (SECONDS * 10), 10);
+    ece391_fdputs (1, (uint8_t*)"%\n");
+
+    return 0;
+}
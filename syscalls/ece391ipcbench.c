@@ -0,0 +1,143 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ROUNDS 1000
+#define IPC_QUIT 1
+#define SAVED_STDIN 6
+#define SAVED_STDOUT 7
+
+static uint32_t cycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+/* child: answer every call with the first word plus one */
+static void server (void)
+{
+    uint32_t msg[2];
+    int32_t from = ece391_ipc_reply_wait (-1, msg);
+
+    while (from >= 0 && IPC_QUIT != msg[1]) {
+	msg[0]++;
+	from = ece391_ipc_reply_wait (from, msg);
+    }
+}
+
+/* child: send every byte straight back */
+static void echo (void)
+{
+    uint8_t c;
+    while (1 == ece391_read (0, &c, 1))
+	ece391_write (1, &c, 1);
+}
+
+static int32_t ipc_rounds (void)
+{
+    uint32_t msg[2];
+    uint32_t i, begin, end;
+    int32_t id;
+
+    if (-1 == (id = ece391_spawn ((uint8_t*)"ipcbench server")))
+	return -1;
+
+    /* first call also waits for the server to start */
+    msg[0] = 0;
+    msg[1] = 0;
+    if (-1 == ece391_ipc_call (id, msg))
+	return -1;
+
+    begin = cycles ();
+    for (i = 0; i < ROUNDS; i++) {
+	msg[0] = i;
+	ece391_ipc_call (id, msg);
+	if (i + 1 != msg[0]) {
+	    ece391_fdputs (1, (uint8_t*)"bad reply\n");
+	    break;
+	}
+    }
+    end = cycles ();
+
+    msg[1] = IPC_QUIT;
+    ece391_ipc_call (id, msg);
+    return (end - begin) / ROUNDS;
+}
+
+static int32_t pipe_rounds (void)
+{
+    int32_t to_child[2], from_child[2];
+    int32_t i;
+    uint8_t c = 'x';
+    uint32_t begin, end;
+
+    if (-1 == ece391_pipe (to_child, 0))
+	return -1;
+    if (-1 == ece391_pipe (from_child, 0)) {
+	ece391_close (to_child[0]);
+	ece391_close (to_child[1]);
+	return -1;
+    }
+    ece391_dup2 (0, SAVED_STDIN);
+    ece391_dup2 (1, SAVED_STDOUT);
+    ece391_dup2 (to_child[0], 0);
+    ece391_dup2 (from_child[1], 1);
+    i = ece391_spawn ((uint8_t*)"ipcbench echo");
+    ece391_dup2 (SAVED_STDIN, 0);
+    ece391_dup2 (SAVED_STDOUT, 1);
+    ece391_close (SAVED_STDIN);
+    ece391_close (SAVED_STDOUT);
+    ece391_close (to_child[0]);
+    ece391_close (from_child[1]);
+    if (-1 == i) {
+	ece391_close (to_child[1]);
+	ece391_close (from_child[0]);
+	return -1;
+    }
+
+    /* warm up */
+    ece391_write (to_child[1], &c, 1);
+    ece391_read (from_child[0], &c, 1);
+
+    begin = cycles ();
+    for (i = 0; i < ROUNDS; i++) {
+	ece391_write (to_child[1], &c, 1);
+	ece391_read (from_child[0], &c, 1);
+    }
+    end = cycles ();
+    ece391_close (to_child[1]);
+    ece391_close (from_child[0]);
+    return (end - begin) / ROUNDS;
+}
+
+int main ()
+{
+    uint8_t args[128];
+    int32_t rt;
+
+    if (0 == ece391_getargs (args, 128)) {
+	if (0 == ece391_strcmp (args, (uint8_t*)"server"))
+	    server ();
+	else if (0 == ece391_strcmp (args, (uint8_t*)"echo"))
+	    echo ();
+	return 0;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"Round trip latency, 2 processes\n");
+    if (-1 == (rt = ipc_rounds ())) {
+	ece391_fdputs (1, (uint8_t*)"could not start server\n");
+	return 3;
+    }
+    ece391_print_num ("ipc_call cycles:  ", rt, 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (-1 == (rt = pipe_rounds ())) {
+	ece391_fdputs (1, (uint8_t*)"could not start echo\n");
+	return 3;
+    }
+    ece391_print_num ("pipe 1 byte cycles: ", rt, 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
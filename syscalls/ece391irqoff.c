@@ -0,0 +1,60 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define IRQ_PIT 0
+#define IRQ_KEYBOARD 1
+#define IRQ_RTC 8
+
+static uint32_t tsc_mhz;
+
+static void print_line (const char* name, uint32_t cycles)
+{
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_print_num (" max cycles: ", cycles, 10);
+    ece391_print_num ("  us: ", cycles / tsc_mhz, 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* prints the longest any interrupt kept interrupts off, per IRQ line.
+   Type, switch terminals and run something that sleeps or draws, then
+   compare a normal boot against one with softirq=off, where the bottom
+   halves and terminal switches still run inside the interrupt.  Then
+   the longest interrupts off sections anywhere in the kernel, with the
+   addresses that turned interrupts off and on, for addr2line -e
+   bootimg. */
+int main ()
+{
+    uint32_t off[KSTAT_IRQOFF_WORDS];
+    uint32_t top[KSTAT_IRQSOFF_TOP_WORDS];
+    uint32_t clock[KSTAT_CLOCK_WORDS];
+    int32_t i;
+
+    if (KSTAT_IRQOFF_WORDS != ece391_kstat (KSTAT_IRQOFF, off, KSTAT_IRQOFF_WORDS) ||
+        KSTAT_IRQSOFF_TOP_WORDS != ece391_kstat (KSTAT_IRQSOFF_TOP, top, KSTAT_IRQSOFF_TOP_WORDS) ||
+        KSTAT_CLOCK_WORDS != ece391_kstat (KSTAT_CLOCK, clock, KSTAT_CLOCK_WORDS)) {
+        ece391_fdputs (1, (uint8_t*)"kstat failed\n");
+        return 3;
+    }
+    tsc_mhz = clock[0] / 1000;
+    if (tsc_mhz == 0)
+        tsc_mhz = 1;
+
+    print_line ("pit     ", off[IRQ_PIT]);
+    print_line ("keyboard", off[IRQ_KEYBOARD]);
+    print_line ("rtc     ", off[IRQ_RTC]);
+
+    ece391_fdputs (1, (uint8_t*)"longest interrupts off sections:\n");
+    for (i = 0; i < KSTAT_IRQSOFF_TOP_WORDS; i += 3) {
+        if (top[i] == 0)
+            break;
+        ece391_print_num ("  cycles: ", top[i], 10);
+        ece391_print_num ("  us: ", top[i] / tsc_mhz, 10);
+        ece391_print_num ("  off at 0x", top[i + 1], 16);
+        ece391_print_num ("  on at 0x", top[i + 2], 16);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define MAX_JOBS 6
+#define COUNT 200000
+
+/* what counter does, minus the terminal */
+static void count_job (void)
+{
+    uint32_t i;
+    uint8_t buf[BUFSIZE];
+
+    for (i = 0; i < COUNT; i++)
+        ece391_itoa (i + 1, buf, 10);
+}
+
+/*
+ * "jobbench" runs 1..MAX_JOBS copies of "jobbench w" side by side in
+ * this terminal and reports how long each batch took, stopping once
+ * spawn runs out of process slots.
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    int32_t ids[MAX_JOBS];
+    int32_t n, i, started, status, failed;
+    uint32_t begin, end;
+
+    if (0 == ece391_getargs (buf, BUFSIZE) && 'w' == buf[0]) {
+        count_job ();
+        return 0;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"Background job throughput, counting to 200000 per job\n");
+
+    begin = ece391_kcycles ();
+    count_job ();
+    end = ece391_kcycles ();
+    ece391_print_num ("in process: ", end - begin, 10);
+    ece391_fdputs (1, (uint8_t*)" kcycles\n");
+
+    for (n = 1; n <= MAX_JOBS; n++) {
+        begin = ece391_kcycles ();
+        for (started = 0; started < n; started++)
+            if (-1 == (ids[started] = ece391_spawn ((uint8_t*)"jobbench w")))
+                break;
+
+        failed = 0;
+        for (i = 0; i < started; i++)
+            if (ids[i] != ece391_waitpid (ids[i], &status, 0) || 0 != status)
+                failed++;
+        end = ece391_kcycles ();
+
+        if (started < n) {
+            ece391_print_num ("out of process slots at ", n, 10);
+            ece391_fdputs (1, (uint8_t*)" jobs\n");
+            break;
+        }
+        ece391_print_num ("jobs: ", n, 10);
+        ece391_print_num ("  kcycles: ", end - begin, 10);
+        ece391_print_num ("  per job: ", (end - begin) / n, 10);
+        if (failed)
+            ece391_print_num ("  failed: ", failed, 10);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SAMPLES 16
+
+static int32_t print_samples (const char* label, int32_t which)
+{
+    uint32_t cycles[SAMPLES];
+    uint32_t min = 0xFFFFFFFF, max = 0, sum = 0;
+    int32_t i, n;
+
+    n = ece391_kstat (which, cycles, SAMPLES);
+    if (n <= 0)
+        return n;
+
+    ece391_fdputs (1, (uint8_t*)label);
+    for (i = 0; i < n; i++) {
+        ece391_print_num (" ", cycles[i], 10);
+        if (cycles[i] < min)
+            min = cycles[i];
+        if (cycles[i] > max)
+            max = cycles[i];
+        sum += cycles[i];
+    }
+    ece391_print_num ("\n  min: ", min, 10);
+    ece391_print_num ("  avg: ", sum / n, 10);
+    ece391_print_num ("  max: ", max, 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return n;
+}
+
+/* prints how many cycles the latest keyboard interrupts and the bottom
+   halves behind them took, the keys typed to start this count too */
+int main ()
+{
+    if (print_samples ("keyboard irq cycles:", KSTAT_KBD_IRQ) < 0 ||
+        print_samples ("keyboard bottom half cycles:", KSTAT_KBD_BH) < 0) {
+        ece391_fdputs (1, (uint8_t*)"kstat failed\n");
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SAMPLES 16
+#define EVENTS 8
+#define SCAN_Q 0x10
+
+/* puts the keyboard in raw mode and prints every key event with how
+   many cycles passed between its interrupt and this program seeing it,
+   then the kernel's own keypress to read samples.  q quits. */
+int main ()
+{
+    key_event_t ev[EVENTS];
+    uint32_t cycles[SAMPLES];
+    uint32_t now, sum = 0, max = 0;
+    int32_t i, n, quit = 0;
+
+    if (-1 == ece391_ioctl (0, KBD_SETMODE, KBD_RAW)) {
+        ece391_fdputs (1, (uint8_t*)"stdin is not the keyboard\n");
+        return 3;
+    }
+    ece391_fdputs (1, (uint8_t*)"raw keyboard, press q to quit\n");
+
+    while (!quit) {
+        n = ece391_read (0, ev, sizeof (ev));
+        asm volatile ("rdtsc" : "=a"(now) : : "edx");
+        if (n <= 0)
+            break;
+        for (i = 0; i < n / (int32_t)sizeof (key_event_t); i++) {
+            ece391_print_num (ev[i].pressed ? "press   " : "release ",
+                              ev[i].scancode, 16);
+            if (ev[i].ascii > ' ') {
+                uint8_t c[2] = {ev[i].ascii, '\0'};
+                ece391_fdputs (1, (uint8_t*)"  '");
+                ece391_fdputs (1, c);
+                ece391_fdputs (1, (uint8_t*)"'");
+            }
+            ece391_print_num ("  mods: ", ev[i].mods, 16);
+            ece391_print_num ("  cycles to read: ", now - ev[i].tsc_lo, 10);
+            ece391_fdputs (1, (uint8_t*)"\n");
+            if (ev[i].scancode == SCAN_Q && !ev[i].pressed)
+                quit = 1;
+        }
+    }
+
+    ece391_ioctl (0, KBD_SETMODE, KBD_COOKED);
+
+    n = ece391_kstat (KSTAT_KBD_READ, cycles, SAMPLES);
+    if (n <= 0)
+        return 0;
+    for (i = 0; i < n; i++) {
+        sum += cycles[i];
+        if (cycles[i] > max)
+            max = cycles[i];
+    }
+    ece391_print_num ("keypress to read, last ", n, 10);
+    ece391_print_num (" reads  avg: ", sum / n, 10);
+    ece391_print_num ("  max: ", max, 10);
+    ece391_fdputs (1, (uint8_t*)" cycles\n");
+    return 0;
+}
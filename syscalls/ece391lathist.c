@@ -0,0 +1,76 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define BAR_WIDTH 40
+#define IRQ_PIT 0
+#define IRQ_KEYBOARD 1
+#define IRQ_RTC 8
+
+/* one histogram, a bar per non-empty bucket scaled to the fullest */
+static void print_hist (const char* name, int32_t src)
+{
+    uint32_t h[LAT_WORDS];
+    uint32_t* buckets = h + 3;
+    uint32_t top = 0, len, i;
+    uint8_t bar[BAR_WIDTH + 2];
+    int32_t b;
+
+    if (LAT_WORDS != ece391_lathist (src, h, LAT_WORDS)) {
+        ece391_fdputs (1, (uint8_t*)"lathist failed, is LAT_HIST off?\n");
+        return;
+    }
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_print_num (": count ", h[0], 10);
+    if (h[0] == 0) {
+        ece391_fdputs (1, (uint8_t*)"\n");
+        return;
+    }
+    ece391_print_num ("  min ", h[1], 10);
+    ece391_print_num ("  max ", h[2], 10);
+    ece391_fdputs (1, (uint8_t*)" cycles\n");
+
+    for (b = 0; b < LAT_BUCKETS; b++)
+        if (buckets[b] > top)
+            top = buckets[b];
+    for (b = 0; b < LAT_BUCKETS; b++) {
+        if (buckets[b] == 0)
+            continue;
+        ece391_print_num ("  2^", b, 10);
+        ece391_print_num (b < 10 ? "  " : " ", buckets[b], 10);
+        len = (buckets[b] * BAR_WIDTH + top - 1) / top;
+        for (i = 0; i < len; i++)
+            bar[i] = '#';
+        bar[len] = '\n';
+        bar[len + 1] = '\0';
+        ece391_fdputs (1, (uint8_t*)" ");
+        ece391_fdputs (1, bar);
+    }
+}
+
+/* prints how long the pit, keyboard and rtc handlers and the context
+   switches took since boot or the last "lathist reset", as log2
+   histograms of TSC cycles */
+int main ()
+{
+    uint8_t args[BUFSIZE];
+
+    if (0 == ece391_getargs (args, BUFSIZE) &&
+        0 == ece391_strncmp (args, (uint8_t*)"reset", 6)) {
+        if (-1 == ece391_lathist (LAT_RESET, 0, 0)) {
+            ece391_fdputs (1, (uint8_t*)"lathist failed, is LAT_HIST off?\n");
+            return 3;
+        }
+        ece391_fdputs (1, (uint8_t*)"histograms cleared\n");
+        return 0;
+    }
+
+    print_hist ("pit", IRQ_PIT);
+    print_hist ("keyboard", IRQ_KEYBOARD);
+    print_hist ("rtc", IRQ_RTC);
+    print_hist ("context switch", LAT_SWITCH);
+
+    return 0;
+}
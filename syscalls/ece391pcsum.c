@@ -0,0 +1,73 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define DATA_SIZE 0x20000
+#define MAX_THREADS 8
+#define PASSES 8
+
+static uint8_t data[DATA_SIZE];
+static uint32_t partial[MAX_THREADS];
+static volatile uint32_t remaining;
+static uint32_t nthreads;
+
+/* every thread keeps its index in the first word of its TLS block */
+static uint32_t thread_index (void)
+{
+    uint32_t id;
+    asm volatile ("movl %%gs:0, %0" : "=r"(id));
+    return id;
+}
+
+static void worker (void* arg)
+{
+    uint32_t i, p, sum = 0;
+    uint32_t chunk = DATA_SIZE / nthreads;
+    uint32_t start;
+
+    asm volatile ("movw %w0, %%gs" : : "r"(TLS_SEL));
+    asm volatile ("movl %0, %%gs:0" : : "r"((uint32_t)arg));
+
+    start = thread_index () * chunk;
+    for (p = 0; p < PASSES; p++)
+        for (i = start; i < start + chunk; i++)
+            sum += data[i] * (i + 1);
+
+    partial[thread_index ()] = sum;
+    if (0 == __sync_sub_and_fetch (&remaining, 1))
+        ece391_futex ((uint32_t*)&remaining, FUTEX_WAKE, 1);
+}
+
+int main ()
+{
+    uint32_t i, left, sum, begin, end;
+
+    for (i = 0; i < DATA_SIZE; i++)
+        data[i] = (uint8_t)(i * 7 + (i >> 8));
+
+    ece391_fdputs (1, (uint8_t*)"Parallel checksum, 128KB x 8 passes\n");
+
+    for (nthreads = 1; nthreads <= MAX_THREADS; nthreads <<= 1) {
+        remaining = nthreads;
+        begin = ece391_kcycles ();
+        for (i = 0; i < nthreads; i++) {
+            if (-1 == ece391_thread_create (worker, (void*)i)) {
+                ece391_fdputs (1, (uint8_t*)"thread_create failed\n");
+                return 3;
+            }
+        }
+        while (0 != (left = remaining))
+            ece391_futex ((uint32_t*)&remaining, FUTEX_WAIT, left);
+        end = ece391_kcycles ();
+
+        for (sum = 0, i = 0; i < nthreads; i++)
+            sum += partial[i];
+        ece391_print_num ("threads: ", nthreads, 10);
+        ece391_print_num ("  checksum: ", sum, 16);
+        ece391_print_num ("  kcycles: ", end - begin, 10);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 4096
+#define TOTAL_BYTES 0x100000
+#define ROUNDS 256
+#define SAVED_STDIN 6
+#define SAVED_STDOUT 7
+
+static uint8_t data[BUFSIZE];
+static const int32_t sizes[] = {64, 256, 1024, 4096};
+
+static uint32_t cycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+/* run "pipebench <mode>" with stdin and stdout on the given fds */
+static int32_t start_child (const char* command, int32_t in, int32_t out)
+{
+    int32_t rval;
+
+    ece391_dup2 (0, SAVED_STDIN);
+    ece391_dup2 (1, SAVED_STDOUT);
+    ece391_dup2 (in, 0);
+    ece391_dup2 (out, 1);
+    rval = ece391_spawn ((uint8_t*)command);
+    ece391_dup2 (SAVED_STDIN, 0);
+    ece391_dup2 (SAVED_STDOUT, 1);
+    ece391_close (SAVED_STDIN);
+    ece391_close (SAVED_STDOUT);
+    return rval;
+}
+
+/* child: read stdin until every writer is gone */
+static void sink (void)
+{
+    while (0 < ece391_read (0, data, BUFSIZE))
+	;
+}
+
+/* child: send every byte straight back */
+static void echo (void)
+{
+    uint8_t c;
+    while (1 == ece391_read (0, &c, 1))
+	ece391_write (1, &c, 1);
+}
+
+static int32_t throughput (int32_t size)
+{
+    int32_t fds[2];
+    int32_t sent;
+    uint32_t begin, end;
+
+    if (-1 == ece391_pipe (fds, 0))
+	return -1;
+    if (-1 == start_child ("pipebench sink", fds[0], 1)) {
+	ece391_close (fds[0]);
+	ece391_close (fds[1]);
+	return -1;
+    }
+    ece391_close (fds[0]);
+
+    begin = ece391_kcycles ();
+    for (sent = 0; sent < TOTAL_BYTES; sent += size)
+	ece391_write (fds[1], data, size);
+    ece391_close (fds[1]);
+    end = ece391_kcycles ();
+    if (end == begin)
+	end++;
+
+    ece391_print_num ("write size: ", size, 10);
+    ece391_print_num ("  kcycles: ", end - begin, 10);
+    ece391_print_num ("  bytes/kcycle: ", TOTAL_BYTES / (end - begin), 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
+
+static int32_t latency (void)
+{
+    int32_t to_child[2], from_child[2];
+    int32_t i;
+    uint8_t c = 'x';
+    uint32_t begin, end;
+
+    if (-1 == ece391_pipe (to_child, 0))
+	return -1;
+    if (-1 == ece391_pipe (from_child, 0)) {
+	ece391_close (to_child[0]);
+	ece391_close (to_child[1]);
+	return -1;
+    }
+    i = start_child ("pipebench echo", to_child[0], from_child[1]);
+    ece391_close (to_child[0]);
+    ece391_close (from_child[1]);
+    if (-1 == i) {
+	ece391_close (to_child[1]);
+	ece391_close (from_child[0]);
+	return -1;
+    }
+
+    begin = cycles ();
+    for (i = 0; i < ROUNDS; i++) {
+	ece391_write (to_child[1], &c, 1);
+	ece391_read (from_child[0], &c, 1);
+    }
+    end = cycles ();
+    ece391_close (to_child[1]);
+    ece391_close (from_child[0]);
+
+    ece391_print_num ("1 byte round trip cycles: ", (end - begin) / ROUNDS, 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
+
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    uint32_t i;
+
+    if (0 == ece391_getargs (args, BUFSIZE)) {
+	if (0 == ece391_strcmp (args, (uint8_t*)"sink"))
+	    sink ();
+	else if (0 == ece391_strcmp (args, (uint8_t*)"echo"))
+	    echo ();
+	return 0;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"Pipe throughput, 1MB per write size\n");
+    for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+	if (-1 == throughput (sizes[i])) {
+	    ece391_fdputs (1, (uint8_t*)"could not start sink\n");
+	    return 3;
+	}
+    }
+
+    if (-1 == latency ()) {
+	ece391_fdputs (1, (uint8_t*)"could not start echo\n");
+	return 3;
+    }
+    return 0;
+}
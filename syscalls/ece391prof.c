@@ -0,0 +1,70 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define DEFAULT_HZ 1000
+
+/* reads a decimal number at *s and moves past it and the spaces after */
+static uint32_t parse_num (uint8_t** s)
+{
+    uint32_t value = 0;
+
+    while (**s >= '0' && **s <= '9') {
+        value = value * 10 + (**s - '0');
+        (*s)++;
+    }
+    while (**s == ' ')
+        (*s)++;
+    return value;
+}
+
+static int32_t stop (void)
+{
+    int32_t n = ece391_profile (PROF_STOP);
+
+    if (-1 == n) {
+        ece391_fdputs (1, (uint8_t*)"no profile running\n");
+        return 2;
+    }
+    ece391_print_num ("wrote ", n, 10);
+    ece391_fdputs (1, (uint8_t*)" samples to the serial port\n");
+    return 0;
+}
+
+/*
+ * "prof <hz> <command>" profiles the whole system while command runs,
+ * "prof <hz>" starts a run that "prof stop" ends.  The samples go to the
+ * serial port, run qemu with -serial file:prof.log and then
+ * "./profsym.sh prof.log" in student-distrib.
+ */
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    uint8_t* cmd = args;
+    uint32_t hz;
+
+    if (-1 == ece391_getargs (args, BUFSIZE))
+        args[0] = '\0';
+    if (0 == ece391_strncmp (args, (uint8_t*)"stop", 5))
+        return stop ();
+
+    hz = parse_num (&cmd);
+    if (cmd == args)
+        hz = DEFAULT_HZ;
+    if (-1 == ece391_profile (hz)) {
+        ece391_print_num ("can't profile at ", hz, 10);
+        ece391_fdputs (1, (uint8_t*)"Hz, is a run going already?\n");
+        return 3;
+    }
+    if (*cmd == '\0') {
+        ece391_print_num ("profiling at ", hz, 10);
+        ece391_fdputs (1, (uint8_t*)"Hz, \"prof stop\" ends it\n");
+        return 0;
+    }
+
+    if (-1 == ece391_execute (cmd))
+        ece391_fdputs (1, (uint8_t*)"no such command\n");
+    return stop ();
+}
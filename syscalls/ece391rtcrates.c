@@ -0,0 +1,89 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define READERS 4
+#define WINDOW_HZ 2
+#define WINDOW_TICKS 4
+
+static const int32_t rates[READERS] = {8, 32, 128, 1024};
+static int32_t fds[READERS];
+static volatile uint32_t counts[READERS];
+static volatile int32_t stop;
+static volatile uint32_t remaining;
+
+/* counts the ticks of one rtc fd until main says stop */
+static void reader (void* arg)
+{
+    int32_t i = (int32_t)arg, garbage;
+
+    while (!stop) {
+        ece391_read (fds[i], &garbage, 4);
+        counts[i]++;
+    }
+    if (0 == __sync_sub_and_fetch (&remaining, 1))
+        ece391_futex ((uint32_t*)&remaining, FUTEX_WAKE, 1);
+}
+
+/* every reader thread has its own rtc fd at its own rate, all of them
+   count ticks over the same window timed by a 2Hz fd.  Each count has
+   to be within one tick or 2% of rate * window. */
+int main ()
+{
+    uint32_t start[READERS], got, want, slack, left;
+    int32_t window, i, garbage, hz = WINDOW_HZ, failed = 0;
+
+    if (-1 == (window = ece391_open ((uint8_t*)"rtc"))) {
+        ece391_fdputs (1, (uint8_t*)"could not open rtc\n");
+        return 3;
+    }
+    ece391_write (window, &hz, 4);
+
+    for (i = 0; i < READERS; i++) {
+        fds[i] = ece391_open ((uint8_t*)"rtc");
+        if (-1 == fds[i] || -1 == ece391_write (fds[i], (void*)&rates[i], 4)) {
+            ece391_fdputs (1, (uint8_t*)"could not set up rtc fds\n");
+            return 3;
+        }
+    }
+
+    remaining = READERS;
+    for (i = 0; i < READERS; i++) {
+        if (-1 == ece391_thread_create (reader, (void*)i)) {
+            ece391_fdputs (1, (uint8_t*)"thread_create failed\n");
+            return 3;
+        }
+    }
+
+    /* start on a window tick so every reader is already running */
+    ece391_read (window, &garbage, 4);
+    for (i = 0; i < READERS; i++)
+        start[i] = counts[i];
+    for (i = 0; i < WINDOW_TICKS; i++)
+        ece391_read (window, &garbage, 4);
+
+    for (i = 0; i < READERS; i++) {
+        got = counts[i] - start[i];
+        want = rates[i] * WINDOW_TICKS / WINDOW_HZ;
+        slack = want / 50 > 1 ? want / 50 : 1;
+        ece391_print_num ("rate ", rates[i], 10);
+        ece391_print_num ("Hz  want ", want, 10);
+        ece391_print_num ("  got ", got, 10);
+        if (got + slack < want || got > want + slack) {
+            ece391_fdputs (1, (uint8_t*)"  FAIL\n");
+            failed = 1;
+        } else {
+            ece391_fdputs (1, (uint8_t*)"  ok\n");
+        }
+    }
+
+    stop = 1;
+    while (0 != (left = remaining))
+        ece391_futex ((uint32_t*)&remaining, FUTEX_WAIT, left);
+
+    for (i = 0; i < READERS; i++)
+        ece391_close (fds[i]);
+    ece391_close (window);
+    return failed;
+}
@@ -4,14 +4,145 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define SAVED_STDIN 6
+#define SAVED_STDOUT 7
+#define MAX_JOBS 8
+
+/* ids of the jobs started with &, -1 for a free entry */
+static int32_t jobs[MAX_JOBS] = {-1, -1, -1, -1, -1, -1, -1, -1};
+
+/* strip leading and trailing blanks in place */
+static uint8_t* trim (uint8_t* s)
+{
+    uint8_t* end;
+
+    while (' ' == *s)
+	s++;
+    end = s + ece391_strlen (s);
+    while (end > s && ' ' == end[-1])
+	*--end = '\0';
+    return s;
+}
+
+static uint8_t* find_bar (uint8_t* s)
+{
+    for (; '\0' != *s; s++)
+	if ('|' == *s)
+	    return s;
+    return 0;
+}
+
+/* strip a trailing '&' from cmd, returns 1 if there was one */
+static int32_t find_amp (uint8_t* cmd)
+{
+    int32_t len = ece391_strlen (cmd);
+
+    if (len > 0 && '&' == cmd[len - 1]) {
+	cmd[len - 1] = '\0';
+	return 1;
+    }
+    return 0;
+}
+
+static void print_job (int32_t id, const char* what)
+{
+    uint8_t num[BUFSIZE];
+
+    ece391_itoa (id, num, 10);
+    ece391_fdputs (1, (uint8_t*)"[");
+    ece391_fdputs (1, num);
+    ece391_fdputs (1, (uint8_t*)"] ");
+    ece391_fdputs (1, (uint8_t*)what);
+}
+
+/* spawn cmd in the background and remember it, returns 0 or -1 */
+static int32_t start_job (uint8_t* cmd)
+{
+    int32_t i, id;
+
+    if (-1 == (id = ece391_spawn (cmd)))
+	return -1;
+    for (i = 0; i < MAX_JOBS; i++) {
+	if (-1 == jobs[i]) {
+	    jobs[i] = id;
+	    break;
+	}
+    }
+    print_job (id, "started\n");
+    return 0;
+}
+
+/*
+ * collect every spawned child that halted: pipeline stages silently,
+ * background jobs with a note
+ */
+static void reap_jobs (void)
+{
+    int32_t i, id, status;
+
+    while (0 < (id = ece391_waitpid (-1, &status, WNOHANG))) {
+	for (i = 0; i < MAX_JOBS; i++) {
+	    if (id == jobs[i]) {
+		jobs[i] = -1;
+		print_job (id, 0 == status ? "done\n" : "exited abnormally\n");
+	    }
+	}
+    }
+}
+
+/*
+ * a | b | c: every stage but the last is spawned with stdout on a new
+ * pipe, the next stage reads that pipe on stdin.  The last stage is
+ * executed, so the shell waits for it as usual, or spawned as a job
+ * when the line ends in '&'.
+ */
+static int32_t run_pipeline (uint8_t* buf, int32_t background)
+{
+    uint8_t* stage = buf;
+    uint8_t* bar;
+    int32_t fds[2];
+    int32_t rval = -1;
+
+    ece391_dup2 (0, SAVED_STDIN);
+    ece391_dup2 (1, SAVED_STDOUT);
+
+    while (0 != (bar = find_bar (stage))) {
+	*bar = '\0';
+	if (-1 == ece391_pipe (fds, 0)) {
+	    ece391_fdputs (SAVED_STDOUT, (uint8_t*)"pipe failed\n");
+	    goto done;
+	}
+	ece391_dup2 (fds[1], 1);
+	ece391_close (fds[1]);
+	if (-1 == ece391_spawn (trim (stage)))
+	    ece391_fdputs (SAVED_STDOUT, (uint8_t*)"no such command\n");
+	ece391_dup2 (fds[0], 0);
+	ece391_close (fds[0]);
+	ece391_dup2 (SAVED_STDOUT, 1);
+	stage = bar + 1;
+    }
+    if (background)
+	rval = start_job (trim (stage));
+    else
+	rval = ece391_execute (trim (stage));
+
+done:
+    ece391_dup2 (SAVED_STDIN, 0);
+    ece391_dup2 (SAVED_STDOUT, 1);
+    ece391_close (SAVED_STDIN);
+    ece391_close (SAVED_STDOUT);
+    return rval;
+}
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt, rval, background;
     uint8_t buf[BUFSIZE];
+    uint8_t* cmd;
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+	reap_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -22,9 +153,17 @@ int main ()
 	buf[cnt] = '\0';
 	if (0 == ece391_strcmp (buf, (uint8_t*)"exit"))
 	    return 0;
-	if ('\0' == buf[0])
+	cmd = trim (buf);
+	background = find_amp (cmd);
+	cmd = trim (cmd);
+	if ('\0' == cmd[0])
 	    continue;
-	rval = ece391_execute (buf);
+	if (0 != find_bar (cmd))
+	    rval = run_pipeline (cmd, background);
+	else if (background)
+	    rval = start_job (cmd);
+	else
+	    rval = ece391_execute (cmd);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
 	else if (256 == rval)
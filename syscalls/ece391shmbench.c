@@ -0,0 +1,207 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define TOTAL_BYTES 0x4000000
+#define CHUNK 0x10000
+#define RING 0x200000
+#define HEADER 0x1000
+#define PIPE_READ 0x1000
+#define SAVED_STDIN 6
+#define SAVED_STDOUT 7
+
+/* control words at the start of the segment, the ring follows */
+typedef struct channel {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t ready;
+    volatile uint32_t sum;
+} channel_t;
+
+static channel_t* const ch = (channel_t*)SHM_START;
+static uint8_t* const ring = (uint8_t*)(SHM_START + HEADER);
+static uint32_t buf[CHUNK / 4];
+
+/* both transports move the same words, word i of the stream holds i */
+static void produce (uint32_t* dst, uint32_t offset, uint32_t nbytes)
+{
+    uint32_t i, first = offset / 4;
+    for (i = 0; i < nbytes / 4; i++)
+	dst[i] = first + i;
+}
+
+static uint32_t consume (const uint32_t* src, uint32_t nbytes)
+{
+    uint32_t i, sum = 0;
+    for (i = 0; i < nbytes / 4; i++)
+	sum += src[i];
+    return sum;
+}
+
+static int32_t map_channel (void)
+{
+    int32_t id = ece391_shm_create ((uint8_t*)"shmbench", HEADER + RING);
+    if (-1 == id || -1 == ece391_shm_map (id, (void*)SHM_START))
+	return -1;
+    return 0;
+}
+
+/* run "shmbench <mode>" with stdin and stdout on the given fds */
+static int32_t start_child (const char* command, int32_t in, int32_t out)
+{
+    int32_t rval;
+
+    ece391_dup2 (0, SAVED_STDIN);
+    ece391_dup2 (1, SAVED_STDOUT);
+    ece391_dup2 (in, 0);
+    ece391_dup2 (out, 1);
+    rval = ece391_spawn ((uint8_t*)command);
+    ece391_dup2 (SAVED_STDIN, 0);
+    ece391_dup2 (SAVED_STDOUT, 1);
+    ece391_close (SAVED_STDIN);
+    ece391_close (SAVED_STDOUT);
+    return rval;
+}
+
+/* child: drain the ring, the producer sleeps on tail while it is full */
+static void shm_consumer (void)
+{
+    uint32_t got, head, sum = 0;
+
+    if (-1 == map_channel ())
+	return;
+    ch->ready = 1;
+    ece391_futex ((uint32_t*)&ch->ready, FUTEX_WAKE, 1);
+
+    for (got = 0; got < TOTAL_BYTES; got += CHUNK) {
+	while ((head = ch->head) == got)
+	    ece391_futex ((uint32_t*)&ch->head, FUTEX_WAIT, head);
+	sum += consume ((uint32_t*)(ring + got % RING), CHUNK);
+	ch->sum = sum;
+	ch->tail = got + CHUNK;
+	ece391_futex ((uint32_t*)&ch->tail, FUTEX_WAKE, 1);
+    }
+    ece391_shm_unmap ((void*)SHM_START);
+}
+
+/* child: read everything from stdin, answer with the checksum */
+static void pipe_consumer (void)
+{
+    uint32_t got = 0, sum = 0;
+    int32_t cnt;
+
+    ece391_write (1, &sum, 4);
+    while (got < TOTAL_BYTES && 0 < (cnt = ece391_read (0, buf, PIPE_READ))) {
+	sum += consume (buf, cnt);
+	got += cnt;
+    }
+    ece391_write (1, &sum, 4);
+}
+
+static int32_t shm_stream (uint32_t* sum)
+{
+    uint32_t sent, tail, begin, end;
+
+    if (-1 == map_channel ())
+	return -1;
+    ch->head = ch->tail = ch->ready = 0;
+    if (-1 == ece391_spawn ((uint8_t*)"shmbench shm")) {
+	ece391_shm_unmap ((void*)SHM_START);
+	return -1;
+    }
+    while (0 == ch->ready)
+	ece391_futex ((uint32_t*)&ch->ready, FUTEX_WAIT, 0);
+
+    begin = ece391_kcycles ();
+    for (sent = 0; sent < TOTAL_BYTES; sent += CHUNK) {
+	while (sent - (tail = ch->tail) >= RING)
+	    ece391_futex ((uint32_t*)&ch->tail, FUTEX_WAIT, tail);
+	produce ((uint32_t*)(ring + sent % RING), sent, CHUNK);
+	ch->head = sent + CHUNK;
+	ece391_futex ((uint32_t*)&ch->head, FUTEX_WAKE, 1);
+    }
+    while ((tail = ch->tail) != TOTAL_BYTES)
+	ece391_futex ((uint32_t*)&ch->tail, FUTEX_WAIT, tail);
+    end = ece391_kcycles ();
+
+    *sum = ch->sum;
+    ece391_shm_unmap ((void*)SHM_START);
+    return end - begin;
+}
+
+static int32_t pipe_stream (uint32_t* sum)
+{
+    int32_t to_child[2], from_child[2];
+    uint32_t sent, begin, end;
+    int32_t rval;
+
+    if (-1 == ece391_pipe (to_child, 0))
+	return -1;
+    if (-1 == ece391_pipe (from_child, 0)) {
+	ece391_close (to_child[0]);
+	ece391_close (to_child[1]);
+	return -1;
+    }
+    rval = start_child ("shmbench pipe", to_child[0], from_child[1]);
+    ece391_close (to_child[0]);
+    ece391_close (from_child[1]);
+    if (-1 == rval || 4 != ece391_read (from_child[0], sum, 4)) {
+	ece391_close (to_child[1]);
+	ece391_close (from_child[0]);
+	return -1;
+    }
+
+    begin = ece391_kcycles ();
+    for (sent = 0; sent < TOTAL_BYTES; sent += CHUNK) {
+	produce (buf, sent, CHUNK);
+	ece391_write (to_child[1], buf, CHUNK);
+    }
+    ece391_read (from_child[0], sum, 4);
+    end = ece391_kcycles ();
+
+    ece391_close (to_child[1]);
+    ece391_close (from_child[0]);
+    return end - begin;
+}
+
+static void report (const char* label, int32_t kc, uint32_t sum)
+{
+    if (0 == kc)
+	kc = 1;
+    ece391_fdputs (1, (uint8_t*)label);
+    ece391_print_num ("  kcycles: ", kc, 10);
+    ece391_print_num ("  bytes/kcycle: ", TOTAL_BYTES / kc, 10);
+    ece391_print_num ("  checksum: ", sum, 16);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    uint8_t args[128];
+    uint32_t sum;
+    int32_t kc;
+
+    if (0 == ece391_getargs (args, 128)) {
+	if (0 == ece391_strcmp (args, (uint8_t*)"shm"))
+	    shm_consumer ();
+	else if (0 == ece391_strcmp (args, (uint8_t*)"pipe"))
+	    pipe_consumer ();
+	return 0;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"Streaming 64MB between two processes\n");
+
+    if (-1 == (kc = shm_stream (&sum))) {
+	ece391_fdputs (1, (uint8_t*)"shared memory setup failed\n");
+	return 3;
+    }
+    report ("shm: ", kc, sum);
+
+    if (-1 == (kc = pipe_stream (&sum))) {
+	ece391_fdputs (1, (uint8_t*)"pipe setup failed\n");
+	return 3;
+    }
+    report ("pipe:", kc, sum);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SAMPLES 200
+#define PERIOD_MS 10
+
+static volatile uint32_t count;
+static uint32_t lat[SAMPLES];
+
+/* low 32 bits of the TSC, plenty for one delivery */
+static uint32_t cycles (void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+/* cycles from the timer IRQ to the first thing the handler does */
+static void alarm_handler (int signum)
+{
+    uint32_t now = cycles ();
+    if (count < SAMPLES)
+        lat[count++] = now - SIG_IRQ_TSC (&signum);
+}
+
+int main ()
+{
+    uint32_t i, min, max, sum, spins = 0;
+
+    ece391_fdputs (1, (uint8_t*)"ALARM delivery latency, timer IRQ to handler\n");
+
+    if (-1 == ece391_set_handler (ALARM, alarm_handler) ||
+        -1 == ece391_alarm (PERIOD_MS)) {
+        ece391_fdputs (1, (uint8_t*)"could not set up the alarm\n");
+        return 3;
+    }
+
+    /* the handler interrupts this loop, no polling of any device */
+    while (count < SAMPLES)
+        spins++;
+    ece391_alarm (0);
+    ece391_set_handler (ALARM, 0);
+
+    min = max = sum = lat[0];
+    for (i = 1; i < SAMPLES; i++) {
+        if (lat[i] < min)
+            min = lat[i];
+        if (lat[i] > max)
+            max = lat[i];
+        sum += lat[i];
+    }
+
+    ece391_print_num ("signals: ", SAMPLES, 10);
+    ece391_print_num ("  min: ", min, 10);
+    ece391_print_num ("  avg: ", sum / SAMPLES, 10);
+    ece391_print_num ("  max: ", max, 10);
+    ece391_fdputs (1, (uint8_t*)" cycles\n");
+    ece391_print_num ("main loop iterations meanwhile: ", spins, 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
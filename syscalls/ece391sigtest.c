@@ -12,7 +12,7 @@ void alarm_sighandler (int signum);
 
 int main ()
 {
-    int32_t cnt;
+    int32_t cnt, handlers;
     uint8_t buf[BUFSIZE];
 
     if (0 != ece391_getargs (buf, BUFSIZE)) {
@@ -20,14 +20,18 @@ int main ()
 	return 3;
     }
 
-	if (buf[0] == '1') {
+	handlers = (buf[0] == '1');
+	if (handlers) {
 		ece391_fdputs(1, (uint8_t*)"Installing signal handlers\n");
 		ece391_set_handler(SEGFAULT, segfault_sighandler);
 		ece391_set_handler(ALARM, alarm_sighandler);
 	}
 
     ece391_fdputs (1, (uint8_t*)"Hi, what's your name? ");
-    if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
+    /* the alarm handler ends a read that is waiting, read again */
+    while (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1)) && handlers)
+	;
+    if (-1 == cnt) {
         ece391_fdputs (1, (uint8_t*)"Can't read name from keyboard.\n");
     return 3;
     }
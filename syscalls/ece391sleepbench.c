@@ -0,0 +1,101 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define SLEEPERS 8
+#define ROUNDS 10
+
+static uint32_t late_sum[SLEEPERS];
+static uint32_t late_max[SLEEPERS];
+static volatile uint32_t remaining;
+
+/* ns from begin to end, fine for anything under 4 seconds */
+static uint32_t elapsed_ns (ece391_timespec_t* begin, ece391_timespec_t* end)
+{
+    return (end->sec - begin->sec) * 1000000000 + end->nsec - begin->nsec;
+}
+
+/* sleeper i sleeps i * 3 + 1 ms at a time and notes how much longer
+   each sleep took than it asked for */
+static void sleeper (void* arg)
+{
+    int32_t i = (int32_t)arg, r;
+    uint32_t ns = (i * 3 + 1) * 1000000, late;
+    ece391_timespec_t begin, end;
+
+    for (r = 0; r < ROUNDS; r++) {
+        ece391_gettime (CLOCK_MONOTONIC, &begin);
+        ece391_sleep (ns);
+        ece391_gettime (CLOCK_MONOTONIC, &end);
+        late = elapsed_ns (&begin, &end) - ns;
+        late_sum[i] += late;
+        if (late > late_max[i])
+            late_max[i] = late;
+    }
+    if (0 == __sync_sub_and_fetch (&remaining, 1))
+        ece391_futex ((uint32_t*)&remaining, FUTEX_WAKE, 1);
+}
+
+/* has the kernel arm 1000 timers of its own and prints how late they
+   ran and what they did to the slowest pass over the timer wheel */
+static int32_t wheel_test ()
+{
+    uint32_t test[KSTAT_TIMER_TEST_WORDS];
+
+    if (KSTAT_TIMER_TEST_WORDS !=
+        ece391_kstat (KSTAT_TIMER_TEST, test, KSTAT_TIMER_TEST_WORDS)) {
+        ece391_fdputs (1, (uint8_t*)"kstat failed\n");
+        return 3;
+    }
+    ece391_print_num ("kernel timers: ", test[0], 10);
+    ece391_print_num ("  late avg: ", test[1], 10);
+    ece391_print_num ("us  max: ", test[2], 10);
+    ece391_print_num ("us\nwheel max cycles: ", test[3], 10);
+    ece391_print_num (" idle, ", test[4], 10);
+    ece391_fdputs (1, (uint8_t*)" with timers\n");
+    return 0;
+}
+
+/* runs a sleeper thread per duration at once, then prints how late
+   the sleeps woke and what the kernel's timer wheel costs per tick.
+   "sleepbench wheel" runs the kernel's own timer test instead */
+int main ()
+{
+    uint32_t timer[KSTAT_TIMER_WORDS], left;
+    uint8_t args[BUFSIZE];
+    int32_t i;
+
+    if (0 == ece391_getargs (args, BUFSIZE) &&
+        0 == ece391_strcmp (args, (uint8_t*)"wheel"))
+        return wheel_test ();
+
+    remaining = SLEEPERS;
+    for (i = 0; i < SLEEPERS; i++) {
+        if (-1 == ece391_thread_create (sleeper, (void*)i)) {
+            ece391_fdputs (1, (uint8_t*)"thread_create failed\n");
+            return 3;
+        }
+    }
+    while (0 != (left = remaining))
+        ece391_futex ((uint32_t*)&remaining, FUTEX_WAIT, left);
+
+    for (i = 0; i < SLEEPERS; i++) {
+        ece391_print_num ("sleep ", i * 3 + 1, 10);
+        ece391_print_num ("ms  late avg: ", late_sum[i] / ROUNDS / 1000, 10);
+        ece391_print_num ("us  max: ", late_max[i] / 1000, 10);
+        ece391_fdputs (1, (uint8_t*)"us\n");
+    }
+
+    if (KSTAT_TIMER_WORDS != ece391_kstat (KSTAT_TIMER, timer, KSTAT_TIMER_WORDS)) {
+        ece391_fdputs (1, (uint8_t*)"kstat failed\n");
+        return 3;
+    }
+    ece391_print_num ("timers pending: ", timer[0], 10);
+    ece391_print_num ("  wheel cycles: ", timer[1], 10);
+    ece391_print_num ("  max: ", timer[2], 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    return 0;
+}
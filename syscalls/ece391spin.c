@@ -0,0 +1,16 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* burns the cpu until Ctrl+C, a load for real-time tests */
+int main ()
+{
+    volatile uint32_t i = 0;
+
+    ece391_fdputs (1, (uint8_t*)"spinning, Ctrl+C stops\n");
+    while (1)
+        i++;
+
+    return 0;
+}
@@ -102,3 +102,19 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+/* Writes label and then value in the given radix to stdout */
+void ece391_print_num(const char* label, uint32_t value, int32_t radix)
+{
+    uint8_t buf[33];
+
+    ece391_fdputs(1, (const uint8_t*)label);
+    ece391_fdputs(1, ece391_itoa(value, buf, radix));
+}
+
+/* rdtsc in units of 1024 cycles, keeps the math in 32 bits */
+uint32_t ece391_kcycles(void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return (hi << 22) | (lo >> 10);
+}
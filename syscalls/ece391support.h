@@ -8,6 +8,8 @@ extern int32_t ece391_strcmp(const uint8_t* s1, const uint8_t* s2);
 extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
+extern void ece391_print_num(const char* label, uint32_t value, int32_t radix);
+extern uint32_t ece391_kcycles(void);
 
 #endif /* ECE391SUPPORT_H */
 
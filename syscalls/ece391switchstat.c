@@ -0,0 +1,41 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SAMPLES 16
+
+/* prints how many cycles the latest Alt+F terminal switches took */
+int main ()
+{
+    uint32_t cycles[SAMPLES];
+    uint32_t min = 0xFFFFFFFF, max = 0, sum = 0;
+    int32_t i, n;
+
+    n = ece391_kstat (KSTAT_SWITCH, cycles, SAMPLES);
+    if (n < 0) {
+        ece391_fdputs (1, (uint8_t*)"kstat failed\n");
+        return 3;
+    }
+    if (n == 0) {
+        ece391_fdputs (1, (uint8_t*)"no switches yet, press Alt+F1 and up\n");
+        return 0;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"terminal switch cycles:");
+    for (i = 0; i < n; i++) {
+        ece391_print_num (" ", cycles[i], 10);
+        if (cycles[i] < min)
+            min = cycles[i];
+        if (cycles[i] > max)
+            max = cycles[i];
+        sum += cycles[i];
+    }
+    ece391_print_num ("\nswitches: ", n, 10);
+    ece391_print_num ("  min: ", min, 10);
+    ece391_print_num ("  avg: ", sum / n, 10);
+    ece391_print_num ("  max: ", max, 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    return 0;
+}
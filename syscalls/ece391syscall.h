@@ -22,6 +22,277 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/*
+ * Threads share the caller's memory and open files.  The new thread runs
+ * entry(arg) on its own stack and halts when entry returns; halting the
+ * main thread ends the whole process, so only the main thread may
+ * execute.  Each thread's private 256-byte TLS block is reachable
+ * through %gs once it is loaded with TLS_SEL.
+ */
+extern int32_t ece391_thread_create (void (*entry)(void*), void* arg);
+extern int32_t ece391_futex (uint32_t* addr, int32_t op, int32_t val);
+
+/*
+ * fds[0] reads what is written to fds[1]; size 0 picks the largest
+ * buffer.  Reads return 0 once every write end is closed.  dup2 may
+ * replace stdin and stdout, which children inherit from execute and
+ * spawn.  spawn starts a program without waiting for it to halt.
+ */
+extern int32_t ece391_pipe (int32_t fds[2], int32_t size);
+extern int32_t ece391_dup2 (int32_t oldfd, int32_t newfd);
+extern int32_t ece391_spawn (const uint8_t* command);
+
+/*
+ * waitpid collects a spawned child (pid from spawn, -1 for any) once
+ * it halts and stores its halt status; with WNOHANG it returns 0
+ * instead of sleeping when none halted yet.  Returns -1 without such
+ * a child.  Children that are never collected are freed when their
+ * parent halts.
+ */
+extern int32_t ece391_waitpid (int32_t pid, int32_t* status, int32_t options);
+
+#define WNOHANG 1
+
+/*
+ * Shared memory segments are found by name and hold up to 4MB.  They
+ * are mapped on a 4MB boundary from SHM_START up to SHM_LIMIT and
+ * start out zeroed.  A segment goes away after its last unmap; halt
+ * unmaps everything.  futex works on words in shared memory too.
+ */
+extern int32_t ece391_shm_create (const uint8_t* name, int32_t size);
+extern int32_t ece391_shm_map (int32_t id, void* addr);
+extern int32_t ece391_shm_unmap (void* addr);
+
+/*
+ * Synchronous IPC with two-word messages passed in registers.  A
+ * server names its clients and is named by the id that spawn or
+ * thread_create returned.  ipc_call sends msg and blocks until the
+ * reply overwrites msg; it fails if the server halts first.
+ * ipc_reply_wait answers client (-1 for nobody), then waits for the
+ * next call and returns the caller's id with its message in msg.
+ */
+extern int32_t ece391_ipc_call (int32_t dest, uint32_t msg[2]);
+extern int32_t ece391_ipc_reply_wait (int32_t client, uint32_t msg[2]);
+
+/*
+ * poll waits until one of the fds is ready or timeout milliseconds
+ * pass (-1 waits forever, 0 never blocks), and returns how many
+ * entries have revents set.  Keyboard fds are readable once a line is
+ * entered and RTC fds once a tick came in since the last read.  With
+ * O_NONBLOCK set by fcntl, read and write return -1 instead of
+ * sleeping.
+ */
+struct pollfd {
+	int32_t fd;
+	int16_t events;
+	int16_t revents;
+};
+
+extern int32_t ece391_poll (struct pollfd* fds, int32_t nfds, int32_t timeout);
+extern int32_t ece391_fcntl (int32_t fd, int32_t cmd, int32_t arg);
+
+/*
+ * alarm sends ALARM every period_ms milliseconds, rounded up to 10ms
+ * ticks; 0 stops it.  Programs start with a 10 second alarm, which is
+ * ignored until a handler is installed.  A handler runs with signals
+ * masked on the interrupted stack, and finds above its signum the
+ * saved registers (ebx, ecx, edx, esi, edi, ebp, eax, ds, es, fs,
+ * vector, error code, eip, cs, eflags, esp, ss), which sigreturn puts
+ * back when it returns.  SIG_IRQ_TSC reads the low TSC word stamped
+ * when the signal was raised, for a timer signal the tick's IRQ.  A
+ * read, write, sleep, poll, waitpid or futex wait that is blocked when
+ * a signal comes returns -1, and the signal is delivered on the way
+ * out.
+ */
+extern int32_t ece391_alarm (int32_t period_ms);
+
+#define SIG_IRQ_TSC(signum_ptr) (((uint32_t*)(signum_ptr))[20])
+
+/*
+ * kstat copies up to n of the kernel's latest samples of a counter,
+ * oldest first, and returns how many it copied.  KSTAT_SWITCH keeps
+ * the cycles each of the last 16 Alt+F terminal switches took.
+ * KSTAT_SESSION gives, in bytes where it applies: terminals booted
+ * with, terminal sessions made so far, kernel heap the last session
+ * took, a session's kernel stack, its shell's program page, and the
+ * kernel heap in use.  KSTAT_KBD_IRQ keeps the cycles each of the
+ * last 16 keyboard interrupts took, KSTAT_KBD_BH the same for the
+ * bottom half that then handled the keys.  KSTAT_KBD_READ keeps the
+ * cycles from the keyboard interrupt of each of the last 16 lines,
+ * chars or events read to the read that took it.  KSTAT_CLOCK gives
+ * the TSC rate in kHz the kernel measured at boot and the wall clock
+ * seconds since 1970 it read then.  KSTAT_TIMER gives the kernel
+ * timers pending and the cycles the latest and the slowest pass over
+ * the timer wheel took.  KSTAT_IRQ gives the interrupts handled on
+ * each of the 16 IRQ lines since boot.  KSTAT_IDLE gives the ms the
+ * kernel spent halted with nothing to run and 1 if the PIT is one-shot
+ * (nohz), 0 if it ticks at 100Hz.  KSTAT_RT gives the calling thread's
+ * real-time jobs and deadline misses, and the ppm of the CPU all
+ * real-time threads reserve.  KSTAT_IRQOFF gives the most cycles an
+ * interrupt on each of the 16 IRQ lines kept interrupts off.
+ * KSTAT_IRQSOFF_TOP gives the 8 longest interrupts off sections in the
+ * kernel, longest first, each as its cycles and the kernel addresses
+ * right after the cli and right before the sti, all 0 when the kernel
+ * was built without IRQSOFF_TRACE.  KSTAT_TIMER_TEST arms 1000 kernel
+ * timers over the next second, waits for them and gives how many ran,
+ * the average and the most us late, and the slowest timer wheel pass
+ * in cycles with no timers and with them; it fails unless the kernel
+ * was built with TIMER_TEST, and while another process is running it
+ * or a real-time thread is admitted.
+ */
+extern int32_t ece391_kstat (int32_t which, uint32_t* buf, int32_t n);
+
+#define KSTAT_SWITCH 0
+#define KSTAT_SESSION 1
+#define KSTAT_SESSION_WORDS 6
+#define KSTAT_KBD_IRQ 2
+#define KSTAT_KBD_BH 3
+#define KSTAT_KBD_READ 4
+#define KSTAT_CLOCK 5
+#define KSTAT_CLOCK_WORDS 2
+#define KSTAT_TIMER 6
+#define KSTAT_TIMER_WORDS 3
+#define KSTAT_IRQ 7
+#define KSTAT_IRQ_WORDS 16
+#define KSTAT_IDLE 8
+#define KSTAT_IDLE_WORDS 2
+#define KSTAT_RT 9
+#define KSTAT_RT_WORDS 3
+#define KSTAT_IRQOFF 10
+#define KSTAT_IRQOFF_WORDS 16
+#define KSTAT_IRQSOFF_TOP 11
+#define KSTAT_IRQSOFF_TOP_WORDS 24
+#define KSTAT_TIMER_TEST 12
+#define KSTAT_TIMER_TEST_WORDS 5
+
+/*
+ * gettime fills ts with CLOCK_MONOTONIC, the time since boot, or
+ * CLOCK_REALTIME, the UTC time since 1970.  Both count off the TSC,
+ * which the kernel calibrates against the PIT at boot.
+ */
+typedef struct ece391_timespec {
+    uint32_t sec;
+    uint32_t nsec;
+} ece391_timespec_t;
+
+extern int32_t ece391_gettime (int32_t clock, ece391_timespec_t* ts);
+
+#define CLOCK_MONOTONIC 0
+#define CLOCK_REALTIME 1
+
+/*
+ * sleep blocks the caller for at least ns nanoseconds of
+ * CLOCK_MONOTONIC.  The kernel wakes it from its timer wheel, in 1ms
+ * steps checked on every PIT tick.
+ */
+extern int32_t ece391_sleep (uint64_t ns);
+
+/*
+ * sched_rt puts the calling thread in the real-time class: every
+ * period_us it is guaranteed budget_us of CPU time, earliest deadline
+ * first, ahead of every normal thread.  A job starts when the thread
+ * wakes up and ends when it blocks again, one that is still running at
+ * the end of its period is a deadline miss.  Periods go from 1ms to
+ * 1s.  Fails if all real-time threads together would reserve more than
+ * 90% of the CPU.  A period of 0 makes the thread normal again.
+ */
+extern int32_t ece391_sched_rt (uint32_t period_us, uint32_t budget_us);
+
+/*
+ * lathist copies up to n words of a latency histogram into buf, in TSC
+ * cycles: how many were counted, the shortest, the longest, then
+ * LAT_BUCKETS counts where bucket b holds the latencies from 2^b to
+ * 2^(b+1) - 1.  Sources 0 to 15 time the handler of that IRQ line,
+ * LAT_SWITCH times context switches.  LAT_RESET clears them all.
+ * Returns the words copied, -1 on a bad argument or if the kernel was
+ * built without LAT_HIST.
+ */
+extern int32_t ece391_lathist (int32_t src, uint32_t* buf, int32_t n);
+
+#define LAT_SWITCH 16
+#define LAT_RESET -1
+#define LAT_BUCKETS 32
+#define LAT_WORDS (3 + LAT_BUCKETS)
+
+/*
+ * profile starts the sampling profiler at hz samples a second, from
+ * PROF_MIN_HZ to PROF_MAX_HZ: every sample keeps the EIP the timer
+ * interrupt stopped, in the kernel or in a program.  PROF_STOP ends the
+ * run and writes it to the first serial port, where profsym.sh in
+ * student-distrib reads it back.  Returns 0 once started, the samples
+ * written once stopped, -1 for a bad rate, if a run is going already or
+ * none is to stop.
+ */
+extern int32_t ece391_profile (uint32_t hz);
+
+#define PROF_STOP 0
+#define PROF_MIN_HZ 10
+#define PROF_MAX_HZ 10000
+
+/*
+ * trace controls the kernel event trace: system calls with their
+ * arguments and return values, context switches, IRQs, page faults and
+ * program loads and halts, each with a TSC timestamp.  TRACE_ON starts
+ * recording into a ring of the last 4096 events, TRACE_OFF stops, and
+ * TRACE_DRAIN stops and writes the ring to the first serial port, where
+ * trace2json.sh in student-distrib turns it into a Chrome trace.
+ * Returns 0, the events written for TRACE_DRAIN, -1 for a bad command,
+ * during another drain or if the kernel was built without EVENT_TRACE.
+ */
+extern int32_t ece391_trace (int32_t cmd);
+
+#define TRACE_OFF 0
+#define TRACE_ON 1
+#define TRACE_DRAIN 2
+
+/*
+ * ioctl passes a device specific request to the driver behind fd.
+ * On the keyboard, KBD_SETMODE picks how the caller's terminal hands
+ * over input and drops what was queued: KBD_COOKED reads edited lines,
+ * KBD_CBREAK reads every char as it is typed with no echo, and KBD_RAW
+ * reads a key_event_t for every press and release.  The mode goes back
+ * to KBD_COOKED when the process that set it halts.
+ */
+extern int32_t ece391_ioctl (int32_t fd, int32_t request, int32_t arg);
+
+#define KBD_SETMODE 1
+#define KBD_GETMODE 2
+#define KBD_COOKED 0
+#define KBD_CBREAK 1
+#define KBD_RAW 2
+
+#define KEY_MOD_SHIFT 0x01
+#define KEY_MOD_CTRL 0x02
+#define KEY_MOD_ALT 0x04
+#define KEY_MOD_CAPS 0x08
+#define KEY_MOD_EXTENDED 0x10
+
+typedef struct key_event {
+    uint32_t tsc_lo;    /* TSC when the keyboard interrupt came in */
+    uint32_t tsc_hi;
+    uint8_t scancode;   /* set 1 scan code without the release bit */
+    uint8_t pressed;
+    uint8_t ascii;      /* char the key types, 0 if none */
+    uint8_t mods;
+} key_event_t;
+
+#define POLLIN 0x01
+#define POLLOUT 0x04
+#define POLLNVAL 0x20
+#define F_GETFL 3
+#define F_SETFL 4
+#define O_NONBLOCK 0x800
+
+#define SHM_START 0x08800000
+#define SHM_LIMIT 0x09800000
+
+#define TLS_SEL 0x07
+
+enum futex_ops {
+	FUTEX_WAIT = 0,
+	FUTEX_WAKE
+};
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
@@ -11,5 +11,27 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_THREAD_CREATE 11
+#define SYS_FUTEX 12
+#define SYS_PIPE 13
+#define SYS_DUP2 14
+#define SYS_SPAWN 15
+#define SYS_SHM_CREATE 16
+#define SYS_SHM_MAP 17
+#define SYS_SHM_UNMAP 18
+#define SYS_IPC_CALL 19
+#define SYS_IPC_REPLY_WAIT 20
+#define SYS_POLL 21
+#define SYS_FCNTL 22
+#define SYS_ALARM 23
+#define SYS_WAITPID 24
+#define SYS_KSTAT 25
+#define SYS_IOCTL 26
+#define SYS_GETTIME 27
+#define SYS_SLEEP 28
+#define SYS_SCHED_RT 29
+#define SYS_LATHIST 30
+#define SYS_PROFILE 31
+#define SYS_TRACE 32
 
 #endif /* ECE391SYSNUM_H */
@@ -0,0 +1,50 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define LINE 64
+#define TOTAL 0x10000
+#define SMALL 0x1000
+
+static uint8_t text[TOTAL];
+
+/* write len bytes of text to the terminal chunk bytes at a time */
+static uint32_t timed_write (uint32_t len, uint32_t chunk)
+{
+    uint32_t off, begin;
+
+    begin = ece391_kcycles ();
+    for (off = 0; off < len; off += chunk)
+        ece391_write (1, text + off, chunk);
+    return ece391_kcycles () - begin;
+}
+
+static void report (const char* what, uint32_t bytes, uint32_t k)
+{
+    ece391_print_num (what, bytes, 10);
+    ece391_print_num (" bytes in ", k, 10);
+    ece391_print_num (" kcycles, bytes per 1000 kcycles: ",
+                      bytes * 1000 / (k ? k : 1), 10);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    uint32_t i, big, line, one;
+
+    /* text lines of LINE-1 characters each, like a source listing */
+    for (i = 0; i < TOTAL; i++)
+        text[i] = (LINE - 1 == i % LINE) ? '\n' : 'a' + (i / LINE + i) % 26;
+
+    big = timed_write (TOTAL, BUFSIZE);
+    line = timed_write (TOTAL, LINE);
+    one = timed_write (SMALL, 1);
+
+    ece391_fdputs (1, (uint8_t*)"\nTerminal write throughput\n");
+    report ("1024 byte writes: ", TOTAL, big);
+    report ("  64 byte writes: ", TOTAL, line);
+    report ("   1 byte writes: ", SMALL, one);
+    return 0;
+}
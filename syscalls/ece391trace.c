@@ -0,0 +1,53 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+
+static int32_t drain (void)
+{
+    int32_t n = ece391_trace (TRACE_DRAIN);
+
+    if (-1 == n) {
+        ece391_fdputs (1, (uint8_t*)"trace failed, is EVENT_TRACE off?\n");
+        return 3;
+    }
+    ece391_print_num ("wrote ", n, 10);
+    ece391_fdputs (1, (uint8_t*)" events to the serial port\n");
+    return 0;
+}
+
+/*
+ * "trace on", "trace off" and "trace drain" drive the event trace by
+ * hand, "trace <command>" traces command from start to halt and drains.
+ * Run qemu with -serial file:trace.log, then "./trace2json.sh trace.log
+ * > trace.json" in student-distrib and open it in chrome://tracing.
+ */
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    int32_t cmd = -1;
+
+    if (-1 == ece391_getargs (args, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"usage: trace on|off|drain|<command>\n");
+        return 2;
+    }
+    if (0 == ece391_strcmp (args, (uint8_t*)"on"))
+        cmd = TRACE_ON;
+    else if (0 == ece391_strcmp (args, (uint8_t*)"off"))
+        cmd = TRACE_OFF;
+    else if (0 == ece391_strcmp (args, (uint8_t*)"drain"))
+        return drain ();
+
+    if (-1 == ece391_trace (cmd == -1 ? TRACE_ON : cmd)) {
+        ece391_fdputs (1, (uint8_t*)"trace failed, is EVENT_TRACE off?\n");
+        return 3;
+    }
+    if (cmd != -1)
+        return 0;
+
+    if (-1 == ece391_execute (args))
+        ece391_fdputs (1, (uint8_t*)"no such command\n");
+    return drain ();
+}